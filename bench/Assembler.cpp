@@ -0,0 +1,137 @@
+// Нагрузочный тест ассемблера на сгенерированном исходном коде из многих мегабайт.
+// Аргументы: число команд (по умолчанию 1000000), число команд на метку (8), число повторов (3), число потоков ассемблера
+// (1 - последовательное ассемблирование, 0 - по числу потоков процессора). При параллельном ассемблировании результат
+// сравнивается с последовательным.
+// Код содержит все виды аргументов, ссылки на метки вперёд и назад и комментарии. Выводится лучшее время ассемблирования,
+// скорость и прирост пикового RSS процесса за время первого ассемблирования (память ассемблера).
+#include <cstdint>
+#include <cstdlib>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <streambuf>
+#include <string>
+
+#include <sys/resource.h>
+
+#include "FUPM2EMU.hpp"
+
+// Поток ввода поверх строки без копирования.
+class InputBuffer : public std::streambuf
+{
+public:
+    explicit InputBuffer(const std::string& data)
+    {
+        char* begin = const_cast<char*>(data.data());
+        setg(begin, begin, begin + data.size());
+    }
+};
+
+// Пиковый RSS процесса в КиБ.
+static long peak_rss()
+{
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// Исходный код из instructions команд с меткой на каждые labels_every команд.
+static std::string generate(size_t instructions, size_t labels_every)
+{
+    static const char* ri[] = { "lc", "addi", "subi", "muli", "shli", "cmpi", "andi", "ori" };
+    static const char* rr[] = { "add", "sub", "mul", "mov", "loadr", "storer", "cmp" };
+    static const char* rm[] = { "load", "store", "load2", "store2", "call" };
+    static const char* me[] = { "jmp", "jne", "jeq", "jle", "jl", "jge", "jg", "calli" };
+
+    uint64_t seed = 88172645463325252ull;
+    auto random = [&seed](uint64_t limit)
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        return seed % limit;
+    };
+    auto reg = [&random]() { return "r" + std::to_string(random(16)); };
+
+    const size_t labels = instructions / labels_every + 1;
+    auto label = [&random, labels]() { return "label_" + std::to_string(random(labels)); };
+
+    std::string source;
+    source.reserve(instructions * 24);
+    for (size_t index = 0; index < instructions; ++index)
+    {
+        if (index % labels_every == 0) { source += "label_" + std::to_string(index / labels_every) + ":\n"; }
+
+        switch (random(8))
+        {
+            case 0: case 1: { source += std::string("    ") + ri[random(8)] + " " + reg() + " " + std::to_string(random(1 << 20)); break; }
+            case 2: case 3: { source += std::string("    ") + rr[random(7)] + " " + reg() + " " + reg() + " " + std::to_string(static_cast<int64_t>(random(65536)) - 32768); break; }
+            case 4:         { source += std::string("    ") + rm[random(5)] + " " + reg() + " " + label(); break; }
+            case 5: case 6: { source += std::string("    ") + me[random(8)] + " " + label(); break; }
+            default:        { source += "    lc " + reg() + " " + label(); break; }
+        }
+        source += (random(16) == 0) ? " ; comment\n" : "\n";
+    }
+    source += "label_" + std::to_string(labels - 1) + ":\n    halt r0 0\nend label_0\n";
+    return source;
+}
+
+int main(int argc, char* argv[])
+{
+    size_t instructions = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    size_t labels_every = (argc > 2) ? std::strtoull(argv[2], nullptr, 10) : 8;
+    size_t repeats = (argc > 3) ? std::strtoull(argv[3], nullptr, 10) : 3;
+    unsigned int threads = (argc > 4) ? static_cast<unsigned int>(std::strtoul(argv[4], nullptr, 10)) : 1;
+    if ((instructions == 0) || (instructions >= FUPM2EMU::State::memory_size) || (labels_every == 0) || (repeats == 0))
+    {
+        std::cerr << "Usage: " << argv[0] << " [instructions < " << FUPM2EMU::State::memory_size << "] [instructions per label] [repeats] [threads]" << std::endl;
+        return 1;
+    }
+
+    const std::string source = generate(instructions, labels_every);
+    FUPM2EMU::Emulator emulator;
+    std::cout << std::fixed << std::setprecision(2) << "[BENCHMARK]: Source: " << instructions << " instructions, "
+              << source.size() / (1024.0 * 1024.0) << " MiB" << std::endl;
+
+    double best = 0;
+    long growth = 0;
+    for (size_t repeat = 0; repeat < repeats; ++repeat)
+    {
+        emulator.reset();
+        InputBuffer input_buffer(source);
+        std::istream input_stream(&input_buffer);
+
+        long before = peak_rss();
+        auto start = std::chrono::steady_clock::now();
+        try { emulator.translator.assemble(input_stream, emulator.state, threads); }
+        catch (FUPM2EMU::Translator::Exception exception) { return 1; }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (repeat == 0) { growth = peak_rss() - before; }
+        if ((repeat == 0) || (seconds < best)) { best = seconds; }
+    }
+
+    std::cout << "[BENCHMARK]: Assembling time: " << 1000.0 * best << "ms (" << source.size() / (1024.0 * 1024.0) / best
+              << " MiB/s, " << instructions / best / 1e6 << " M instructions/s)" << std::endl
+              << "[BENCHMARK]: Peak RSS growth while assembling: " << growth << " KiB" << std::endl;
+
+    // Сравнение с последовательным ассемблированием: память, регистры и метки.
+    if (threads != 1)
+    {
+        FUPM2EMU::Emulator reference;
+        InputBuffer input_buffer(source);
+        std::istream input_stream(&input_buffer);
+        try { reference.translator.assemble(input_stream, reference.state); }
+        catch (FUPM2EMU::Translator::Exception exception) { return 1; }
+
+        bool same = (reference.state.memory == emulator.state.memory) && (reference.state.symbols == emulator.state.symbols) &&
+                    (reference.state.image_size == emulator.state.image_size);
+        for (size_t index = 0; index < FUPM2EMU::State::registers_number; ++index)
+        {
+            same = same && (reference.state.registers[index] == emulator.state.registers[index]);
+        }
+        std::cout << "[BENCHMARK]: Parallel result matches serial: " << (same ? "yes" : "no") << std::endl;
+        if (!same) { return 1; }
+    }
+    return 0;
+}
@@ -0,0 +1,77 @@
+// Точка входа для libFuzzer.
+// Программа задаётся переменной окружения FUPM2EMU_FUZZ_PROGRAM (файл ассемблерного кода) и ассемблируется один раз.
+// Входные данные фаззера подаются машине как поток ввода, вывод отбрасывается. Число команд за запуск ограничено
+// переменной FUPM2EMU_FUZZ_BUDGET (по умолчанию 1000000). После запуска восстанавливаются только изменённые страницы памяти.
+// Покрытие - карта рёбер между адресами команд машины (Executor::coverage) в секции дополнительных счётчиков libFuzzer.
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include <fstream>
+#include <streambuf>
+
+#include "FUPM2EMU.hpp"
+
+// Дополнительные счётчики покрытия, которые libFuzzer читает наравне со своими.
+__attribute__((section("__libfuzzer_extra_counters")))
+static uint8_t guest_coverage[FUPM2EMU::Executor::coverage_size];
+
+// Поток ввода поверх данных фаззера без копирования.
+class InputBuffer : public std::streambuf
+{
+public:
+    InputBuffer(const uint8_t* data, size_t size)
+    {
+        char* begin = reinterpret_cast<char*>(const_cast<uint8_t*>(data));
+        setg(begin, begin, begin + size);
+    }
+};
+
+static FUPM2EMU::Emulator* emulator = nullptr; // Рабочий эмулятор.
+static FUPM2EMU::State* prepared = nullptr;    // Исходное состояние.
+static uint64_t budget_limit = 1000000;        // Наибольшее число команд за запуск.
+
+extern "C" int LLVMFuzzerInitialize(int* argc, char*** argv)
+{
+    (void)argc;
+    (void)argv;
+
+    const char* program_path = std::getenv("FUPM2EMU_FUZZ_PROGRAM");
+    if (program_path == nullptr)
+    {
+        std::cerr << "[FUZZER ERROR]: FUPM2EMU_FUZZ_PROGRAM is not set." << std::endl;
+        std::exit(1);
+    }
+    if (const char* budget = std::getenv("FUPM2EMU_FUZZ_BUDGET")) { budget_limit = std::strtoull(budget, nullptr, 10); }
+
+    emulator = new FUPM2EMU::Emulator();
+    std::ifstream file_stream(program_path);
+    if (!file_stream.is_open())
+    {
+        std::cerr << "[FUZZER ERROR]: failed to open file: " << program_path << std::endl;
+        std::exit(1);
+    }
+    try { emulator->translator.assemble(file_stream, emulator->state); }
+    catch (FUPM2EMU::Translator::Exception exception) { std::exit(1); }
+
+    // Рабочее состояние совпадает с исходным, изменённых страниц нет.
+    prepared = new FUPM2EMU::State(emulator->state);
+    std::fill(emulator->state.dirty_pages.begin(), emulator->state.dirty_pages.end(), 0);
+
+    FUPM2EMU::Executor::coverage = guest_coverage;
+
+    // Сообщения об ошибках машины при фаззинге ожидаемы и только замедляют работу.
+    std::cerr.setstate(std::ios::badbit);
+    return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    InputBuffer input_buffer(data, size);
+    std::istream input_stream(&input_buffer);
+    std::ostream output_stream(nullptr);
+
+    uint64_t budget = budget_limit;
+    emulator->run(input_stream, output_stream, budget);
+    emulator->state.revert(*prepared);
+    return 0;
+}
@@ -0,0 +1,23 @@
+// Запуск точки входа фаззера на файлах без libFuzzer (для компиляторов без -fsanitize=fuzzer и воспроизведения падений).
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+extern "C" int LLVMFuzzerInitialize(int* argc, char*** argv);
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+int main(int argc, char* argv[])
+{
+    LLVMFuzzerInitialize(&argc, &argv);
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::ifstream file_stream(argv[i], std::ifstream::binary);
+        std::vector<uint8_t> data((std::istreambuf_iterator<char>(file_stream)), std::istreambuf_iterator<char>());
+        LLVMFuzzerTestOneInput(data.data(), data.size());
+        std::cout << "Executed " << argv[i] << " (" << data.size() << " bytes)" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,56 @@
+#ifndef FUPM2EMU_ASYNCWRITER_HPP
+#define FUPM2EMU_ASYNCWRITER_HPP
+
+#include <cstdint>            // Целочисленные типы фиксированной длины.
+#include <vector>             // vector.
+#include <streambuf>          // streambuf.
+#include <thread>             // thread.
+#include <atomic>             // atomic.
+#include <mutex>              // mutex.
+#include <condition_variable> // condition_variable.
+
+
+namespace FUPM2EMU
+{
+    ////////////////  AsyncWriter   ////////////////
+    // Асинхронный вывод (только POSIX): буфер потока вывода, байты из которого через кольцевой буфер (один писатель, один читатель)
+    // передаются отдельному потоку, записывающему их в файловый дескриптор крупными вызовами write().
+    // Исполнитель не ждёт медленного терминала или канала, пока в кольце есть место. Порядок байт сохраняется;
+    // flush() и деструктор дожидаются записи всех байт. Прерванная сигналом запись повторяется, на неблокирующем дескрипторе
+    // поток записи ждёт готовности (poll). Данные отбрасываются только при неустранимой ошибке (о ней сообщается один раз).
+    class AsyncWriter : public std::streambuf
+    {
+    public:
+        // Методы.
+        AsyncWriter(int descriptor, size_t capacity = 1 << 20);
+        ~AsyncWriter();
+
+    protected:
+        // Данные.
+        int descriptor;                  // Дескриптор вывода.
+        std::vector<char> ring;          // Кольцевой буфер (размер - степень двойки).
+        std::atomic<size_t> head;        // Позиция чтения (изменяет только поток записи).
+        std::atomic<size_t> tail;        // Позиция записи (изменяет только исполнитель).
+        std::atomic<bool> stopping;      // Запрос на завершение потока записи.
+        std::vector<char> local;         // Буфер исполнителя, переносимый в кольцо целиком.
+        std::mutex wake_mutex;           // Ожидание данных потоком записи.
+        std::condition_variable wake;    // Сигнал о появлении данных.
+        std::thread writer;              // Поток записи.
+        bool failed;                     // Была неустранимая ошибка записи (изменяет только поток записи).
+
+        // Перенос локального буфера в кольцо (ждёт, если места нет).
+        void publish();
+
+        // Цикл потока записи.
+        void drain();
+
+        // Интерфейс std::streambuf.
+        int_type overflow(int_type symbol) override;
+        int sync() override;
+
+    private:
+
+    };
+}
+
+#endif
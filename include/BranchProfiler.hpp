@@ -0,0 +1,103 @@
+#ifndef FUPM2EMU_BRANCHPROFILER_HPP
+#define FUPM2EMU_BRANCHPROFILER_HPP
+
+#include <cstdint>        // Целочисленные типы фиксированной длины.
+#include <vector>         // vector.
+#include <unordered_map>  // unordered_map.
+#include <iostream>       // ostream.
+
+#include "FUPM2EMU.hpp"
+
+
+namespace FUPM2EMU
+{
+    //////////////// BranchProfiler ////////////////
+    // Статистика условных переходов основного ядра (JNE, JEQ, JLE, JL, JGE, JG) по адресам команд и моделирование предсказателей:
+    // статического (назад - переход, вперёд - нет), двухбитных счётчиков по адресу и gshare (счётчики по адресу, сложенному
+    // с глобальной историей переходов). Таблицы предсказателей конечны, поэтому переходы могут мешать друг другу, как в процессоре.
+    class BranchProfiler
+    {
+    public:
+        // Предсказатели.
+        enum Predictor
+        {
+            STATIC,  // Назад - переход, вперёд - нет.
+            BIMODAL, // Двухбитный счётчик по адресу.
+            GSHARE,  // Двухбитный счётчик по адресу XOR глобальная история.
+            PREDICTORS_NUMBER,
+        };
+
+        // Методы.
+        explicit BranchProfiler(Executor& executor);
+        ~BranchProfiler();
+
+        // Подключение к исполнителю и отключение.
+        void start();
+        void stop();
+
+        // Условный переход по адресу address на target (taken - совершён).
+        inline void branch(uint32_t address, uint32_t target, bool taken);
+
+        // Вывод итогов и limit худших переходов ("[BRANCHES]: ...").
+        void print_summary(const State& state, std::ostream& output_stream, size_t limit = 5) const;
+
+        // Вывод всех переходов по убыванию числа промахов gshare.
+        void write_report(const State& state, std::ostream& output_stream) const;
+
+    protected:
+        // Статистика одного перехода.
+        struct Site
+        {
+            uint32_t target = 0;                             // Адрес перехода.
+            uint64_t taken = 0;                              // Совершён.
+            uint64_t not_taken = 0;                          // Не совершён.
+            uint64_t mispredictions[PREDICTORS_NUMBER] = {}; // Промахи каждого предсказателя.
+        };
+
+        static const uint8_t table_bits = 12;             // log2(размер таблиц счётчиков).
+        static const size_t table_size = 1 << table_bits; // Размер таблиц счётчиков.
+
+        // Предсказание двухбитного счётчика и его обновление.
+        static inline bool predict(uint8_t counter) { return counter >= 2; }
+        static inline void update(uint8_t& counter, bool taken);
+
+        // Сортировка переходов по убыванию числа промахов gshare.
+        std::vector<std::pair<uint32_t, Site>> ranked() const;
+
+        // Данные.
+        Executor& executor;                        // Исполнитель, сообщающий о переходах.
+        std::unordered_map<uint32_t, Site> sites;  // Переходы по адресам.
+        uint8_t bimodal[table_size];               // Счётчики BIMODAL.
+        uint8_t gshare[table_size];                // Счётчики GSHARE.
+        uint32_t history;                          // Глобальная история переходов (младший бит - последний).
+
+    private:
+
+    };
+
+    inline void BranchProfiler::update(uint8_t& counter, bool taken)
+    {
+        if (taken) { if (counter < 3) { ++counter; } }
+        else { if (counter > 0) { --counter; } }
+    }
+
+    inline void BranchProfiler::branch(uint32_t address, uint32_t target, bool taken)
+    {
+        Site& site = sites[address];
+        site.target = target;
+        ++(taken ? site.taken : site.not_taken);
+
+        if ((target <= address) != taken) { ++site.mispredictions[STATIC]; }
+
+        uint8_t& local = bimodal[address & (table_size - 1)];
+        if (predict(local) != taken) { ++site.mispredictions[BIMODAL]; }
+        update(local, taken);
+
+        uint8_t& global = gshare[(address ^ history) & (table_size - 1)];
+        if (predict(global) != taken) { ++site.mispredictions[GSHARE]; }
+        update(global, taken);
+        history = (history << 1) | (taken ? 1 : 0);
+    }
+}
+
+#endif
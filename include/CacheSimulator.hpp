@@ -0,0 +1,145 @@
+#ifndef FUPM2EMU_CACHESIMULATOR_HPP
+#define FUPM2EMU_CACHESIMULATOR_HPP
+
+#include <cstdint>        // Целочисленные типы фиксированной длины.
+#include <vector>         // vector.
+#include <unordered_map>  // unordered_map.
+#include <iostream>       // ostream.
+
+#include "FUPM2EMU.hpp"
+
+
+namespace FUPM2EMU
+{
+    //////////////// CacheSimulator ////////////////
+    // Модель наборно-ассоциативного кэша машины (общего для команд и данных, LRU, запись с размещением) и карта обращений к страницам.
+    // Обращения приходят из цикла интерпретатора основного ядра через Executor::SimulatedAccess: выборка команды, LOAD*, STORE*,
+    // PUSH, POP, CALL и RET. Обращения системных вызовов (ввод-вывод, файлы, CAS) в модель не попадают.
+    // Промахи и попадания приписываются адресу команды, выполнившей обращение (выборка - самой команде).
+    class CacheSimulator
+    {
+    public:
+        // Счётчики обращений.
+        struct Counts
+        {
+            uint64_t hits = 0;
+            uint64_t misses = 0;
+        };
+
+        // Методы.
+        // size, line - размер кэша и строки в байтах, ways - ассоциативность. Корректность проверяет valid().
+        CacheSimulator(Executor& executor, const State& state, size_t size, size_t line, size_t ways);
+        ~CacheSimulator();
+
+        // Размеры - степени двойки, строка не меньше слова, в кэше хотя бы один набор.
+        static bool valid(size_t size, size_t line, size_t ways);
+
+        // Подключение к исполнителю и отключение.
+        void start();
+        void stop();
+
+        // Обращения (address - адрес слова).
+        inline void fetch(size_t address);
+        inline void read(size_t address);
+        inline void write(size_t address);
+
+        // Вывод итогов ("[CACHE]: ...").
+        void print_summary(std::ostream& output_stream) const;
+
+        // Вывод отчёта: команды по убыванию числа промахов, затем обращения к каждой странице.
+        void write_report(const State& state, std::ostream& output_stream) const;
+
+    protected:
+        // Обращения к странице.
+        struct PageCounts
+        {
+            uint64_t fetches = 0;
+            uint64_t reads = 0;
+            uint64_t writes = 0;
+        };
+
+        static const uint8_t page_bits = PagedMemory::page_bits; // Размер страницы карты обращений (как у страниц памяти).
+
+        // Обращение к строке, содержащей слово. true - попадание.
+        inline bool access(size_t address);
+
+        // Данные.
+        Executor& executor;           // Исполнитель, передающий обращения.
+        const size_t mask;            // Маска адресного пространства машины.
+        const size_t size;            // Размер кэша (байт).
+        const size_t line;            // Размер строки (байт).
+        const size_t ways;            // Ассоциативность.
+        const size_t sets_number;     // Число наборов.
+        uint8_t line_shift;           // log2(число слов в строке).
+        std::vector<uint64_t> tags;   // Номер строки + 1 в каждом пути каждого набора (0 - путь пуст).
+        std::vector<uint64_t> stamps; // Время последнего обращения к пути.
+        uint64_t clock;               // Счётчик обращений (время для LRU).
+
+        Counts fetches, reads, writes;                         // Итоги по видам обращений.
+        std::unordered_map<uint32_t, Counts> instructions;     // Обращения по адресу команды.
+        Counts* instruction;                                   // Счётчики текущей команды.
+        std::unordered_map<uint32_t, PageCounts> pages;        // Обращения по номеру страницы.
+
+    private:
+
+    };
+
+    // Выборка команды начинает учёт обращений этой команды.
+    inline void CacheSimulator::fetch(size_t address)
+    {
+        address &= mask;
+        instruction = &instructions[static_cast<uint32_t>(address)];
+        ++pages[static_cast<uint32_t>(address >> page_bits)].fetches;
+
+        bool hit = access(address);
+        ++(hit ? fetches.hits : fetches.misses);
+        ++(hit ? instruction->hits : instruction->misses);
+    }
+
+    inline void CacheSimulator::read(size_t address)
+    {
+        address &= mask;
+        ++pages[static_cast<uint32_t>(address >> page_bits)].reads;
+
+        bool hit = access(address);
+        ++(hit ? reads.hits : reads.misses);
+        ++(hit ? instruction->hits : instruction->misses);
+    }
+
+    inline void CacheSimulator::write(size_t address)
+    {
+        address &= mask;
+        ++pages[static_cast<uint32_t>(address >> page_bits)].writes;
+
+        bool hit = access(address);
+        ++(hit ? writes.hits : writes.misses);
+        ++(hit ? instruction->hits : instruction->misses);
+    }
+
+    inline bool CacheSimulator::access(size_t address)
+    {
+        uint64_t line_number = address >> line_shift;
+        size_t set = static_cast<size_t>(line_number & (sets_number - 1));
+        uint64_t* set_tags = tags.data() + set * ways;
+        uint64_t* set_stamps = stamps.data() + set * ways;
+        ++clock;
+
+        size_t victim = 0;
+        for (size_t way = 0; way < ways; ++way)
+        {
+            if (set_tags[way] == line_number + 1)
+            {
+                set_stamps[way] = clock;
+                return true;
+            }
+            if (set_stamps[way] < set_stamps[victim]) { victim = way; }
+        }
+
+        // Пустые пути имеют нулевое время и вытесняются первыми.
+        set_tags[victim] = line_number + 1;
+        set_stamps[victim] = clock;
+        return false;
+    }
+}
+
+#endif
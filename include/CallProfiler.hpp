@@ -0,0 +1,87 @@
+#ifndef FUPM2EMU_CALLPROFILER_HPP
+#define FUPM2EMU_CALLPROFILER_HPP
+
+#include <cstdint>        // Целочисленные типы фиксированной длины.
+#include <vector>         // vector.
+#include <unordered_map>  // unordered_map.
+#include <iostream>       // ostream.
+
+#include "FUPM2EMU.hpp"
+
+
+namespace FUPM2EMU
+{
+    //////////////// CallProfiler ////////////////
+    // Профилировщик графа вызовов: теневой стек вызовов основного ядра. CALL/CALLI кладут кадр, RET снимает его,
+    // команды между соседними событиями приписываются вершине дерева вызовов на вершине теневого стека.
+    // Число команд берётся из счётчиков классов цикла интерпретатора, поэтому цикл платит только в ветвях CALL, CALLI и RET.
+    // Машина может менять SR напрямую (переходы через стек, сброс стека), поэтому каждый кадр помнит адрес ячейки
+    // с адресом возврата: кадры, ячейки которых уже сняты со стека, отбрасываются, а RET без подходящего кадра
+    // считается несоответствием и стек не меняет.
+    class CallProfiler
+    {
+    public:
+        // Методы.
+        CallProfiler(Executor& executor, const State& state); // Корень дерева - текущая команда state.
+        ~CallProfiler();
+
+        // Подключение к исполнителю и отключение.
+        void start();
+        void stop();
+
+        // События цикла интерпретатора (retired - число команд, выполненных циклом с момента входа в него).
+        void call(uint32_t target, uint32_t return_address, uint32_t stack, uint64_t retired); // stack - SR после записи адреса возврата.
+        void ret(uint32_t return_address, uint32_t stack, uint64_t retired);                    // stack - SR до снятия адреса возврата.
+        void pause(uint64_t retired);                                                           // Выход из цикла.
+
+        uint64_t calls_number() const;      // Число вызовов.
+        uint64_t mismatches_number() const; // Число несоответствий теневого стека и SR.
+
+        // Вывод исключительного числа команд каждого пути вызовов в формате folded stacks ("main;f;g число").
+        // Функция - метка ассемблера по адресу вызова (или ближайшая метка перед ним со смещением).
+        void write_folded(const State& state, std::ostream& output_stream) const;
+
+        // Вывод limit функций с наибольшим включительным числом команд ("[CALLGRAPH]: ...").
+        void print_summary(const State& state, std::ostream& output_stream, size_t limit = 10) const;
+
+    protected:
+        // Вершина дерева вызовов.
+        struct Node
+        {
+            uint32_t function;  // Адрес функции.
+            uint32_t parent;    // Родительская вершина (у корня - сам корень).
+            uint32_t depth;     // Глубина (у корня - 0).
+            uint64_t exclusive; // Команды, выполненные в этой вершине.
+            uint64_t calls;     // Число входов в вершину.
+        };
+
+        // Кадр теневого стека.
+        struct Frame
+        {
+            uint32_t caller;         // Вершина, в которую возвращает RET.
+            uint32_t return_address; // Записанный CALL адрес возврата.
+            uint32_t stack;          // Адрес ячейки с адресом возврата.
+        };
+
+        // Наибольшая глубина дерева: более глубокие вызовы (например, глубокая рекурсия) приписываются вершине на этой глубине.
+        static const uint32_t max_depth = 1024;
+
+        void attribute(uint64_t retired); // Приписывание команд с прошлого события текущей вершине.
+        void pop();                       // Снятие кадра.
+
+        // Данные.
+        Executor& executor;                              // Исполнитель, сообщающий о вызовах.
+        std::vector<Node> nodes;                         // Дерево вызовов (вершина 0 - корень).
+        std::unordered_map<uint64_t, uint32_t> children; // Родитель << 32 | функция -> вершина.
+        std::vector<Frame> frames;                       // Теневой стек.
+        uint32_t current;                                // Текущая вершина.
+        uint64_t last;                                   // Значение retired при прошлом событии.
+        uint64_t calls;                                  // Число вызовов.
+        uint64_t mismatches;                             // Число несоответствий.
+
+    private:
+
+    };
+}
+
+#endif
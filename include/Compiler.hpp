@@ -0,0 +1,65 @@
+#ifndef FUPM2EMU_COMPILER_HPP
+#define FUPM2EMU_COMPILER_HPP
+
+#include <cstdint>    // Целочисленные типы фиксированной длины.
+#include <vector>     // vector.
+#include <string>     // string.
+#include <iostream>   // file stream.
+
+#include "FUPM2EMU.hpp"
+
+
+namespace FUPM2EMU
+{
+    ////////////////    Compiler    ////////////////
+    // Статический транслятор состояния машины в исходный код на C++ (компиляция заранее).
+    // Результат - самостоятельная единица трансляции: регистры машины становятся локальными переменными, память - массивом слов,
+    // каждое слово образа - меткой внутри main(), а переходы по вычисляемым адресам (RET, CALL, запись в R15) идут через switch по адресу.
+    // Системные вызовы и сообщения об ошибках повторяют поведение Executor и Emulator::run.
+    // Ограничение: код, записанный программой в память во время выполнения, не транслируется (самомодифицирующийся код не поддерживается).
+    class Compiler
+    {
+    public:
+        // Коды исключений.
+        enum class Exception
+        {
+            OK,        // OK.
+            COMPILING, // Ошибка при компиляции.
+        };
+
+        // Методы.
+        Compiler();
+        ~Compiler();
+
+        // Трансляция состояния в исходный код на C++.
+        int compile(const State& state, std::ostream& output_stream) const;
+
+    protected:
+        // Участок памяти, транслируемый как код.
+        struct Range
+        {
+            size_t begin; // Первый адрес.
+            size_t end;   // Адрес за последним словом.
+        };
+
+        // Максимальная длина последовательности нулевых слов внутри одного участка.
+        static const size_t max_gap = 16;
+
+        // Поиск заполненных участков памяти.
+        std::vector<Range> find_ranges(const State& state) const;
+
+        // Трансляция одной команды.
+        void compile_command(uint32_t command, size_t address, const std::vector<Range>& ranges, std::ostream& output_stream) const;
+
+        // Переход на постоянный адрес: напрямую на метку, если адрес транслирован, иначе через диспетчер.
+        static std::string jump(size_t target, const std::vector<Range>& ranges);
+
+        // Имя регистра в сгенерированном коде.
+        static std::string reg(uint8_t code);
+
+    private:
+
+    };
+}
+
+#endif
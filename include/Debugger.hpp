@@ -0,0 +1,123 @@
+#ifndef FUPM2EMU_DEBUGGER_HPP
+#define FUPM2EMU_DEBUGGER_HPP
+
+#include <cstdint>    // Целочисленные типы фиксированной длины.
+#include <map>        // map.
+#include <vector>     // vector.
+#include <string>     // string.
+#include <atomic>     // atomic.
+#include <iostream>   // istream, ostream.
+
+#include <signal.h>   // sigaction, siginfo_t.
+
+#include "FUPM2EMU.hpp"
+
+
+namespace FUPM2EMU
+{
+    ////////////////    Debugger    ////////////////
+    // Отладчик основного ядра (только POSIX). Цикл интерпретатора не знает об отладчике и не платит за него:
+    // - точка останова - команда TRAP, записанная в память вместо отлаживаемой (исходное слово хранится в breakpoints).
+    //   Команда под точкой останова выполняется с исходным словом, после чего TRAP возвращается на место;
+    // - точка наблюдения (только плотная память) - защита от записи страницы хоста, содержащей слово. Запись в такую
+    //   страницу вызывает SIGSEGV: обработчик снимает защиту (запись завершается) и запрашивает Executor::interrupt,
+    //   поэтому ядро останавливается на ближайшем переходе назад или останове. Остановка - только если наблюдаемое слово
+    //   изменилось; запись в соседние слова той же страницы хоста пропускается. Системные вызовы, пишущие в защищённую
+    //   страницу из ядра ОС (чтение файла), завершаются ошибкой.
+    // Дополнительные ядра точки останова не обрабатывают (TRAP для них - неизвестная команда). Одновременно может работать
+    // только один отладчик.
+    class Debugger
+    {
+    public:
+        // Причины остановки.
+        enum class Stop
+        {
+            STEP,       // Выполнено заданное число команд.
+            BREAKPOINT, // Точка останова.
+            WATCHPOINT, // Изменилось наблюдаемое слово.
+            INTERRUPT,  // Запрос остановки (request_stop()).
+            HALT,       // Машина остановилась.
+            ERROR,      // Ошибка машины.
+        };
+
+        // Изменение наблюдаемого слова.
+        struct Change
+        {
+            uint32_t address; // Адрес слова.
+            uint32_t before;  // Прежнее значение.
+            uint32_t after;   // Новое значение.
+        };
+
+        // Данные.
+        std::vector<Change> changes; // Изменения наблюдаемых слов за последнее выполнение.
+
+        // Методы.
+        explicit Debugger(Emulator& emulator);
+        ~Debugger(); // Убирает точки останова и наблюдения из памяти.
+
+        // Интерактивная работа: команды читаются по строке из command_stream, ответы выводятся в console_stream.
+        // Машина использует input_stream и output_stream. Работа заканчивается командой quit или концом команд.
+        int interact(std::istream& command_stream, std::ostream& console_stream, std::istream& input_stream, std::ostream& output_stream);
+
+        // Выполнение не более steps команд (0 - без ограничения) до остановки.
+        Stop resume(std::istream& input_stream, std::ostream& output_stream, uint64_t steps = 0);
+
+        // Запрос остановки выполнения (из другого потока или обработчика сигнала).
+        void request_stop();
+
+        // Точки останова и наблюдения (false - уже есть / нет такой; точки наблюдения требуют плотной памяти).
+        bool set_breakpoint(uint32_t address);
+        bool remove_breakpoint(uint32_t address);
+        bool set_watchpoint(uint32_t address);
+        bool remove_watchpoint(uint32_t address);
+
+        // Память машины без точек останова: чтение возвращает исходные слова, запись под точкой останова меняет исходное слово.
+        uint32_t read(uint32_t address) const;
+        void write(uint32_t address, uint32_t value);
+
+        // Работает ли ещё машина (не было останова или ошибки).
+        bool running() const { return alive; }
+
+    protected:
+        static const uint32_t trap_word = static_cast<uint32_t>(TRAP) << 24; // Команда точки останова.
+
+        // Включение и снятие защиты страниц с наблюдаемыми словами.
+        void arm();
+        void disarm();
+
+        // Проверка наблюдаемых слов: изменения записываются в changes.
+        void collect_changes();
+
+        // Команды интерактивного режима.
+        bool parse_address(const std::string& text, uint32_t& address) const; // Число или метка.
+        void print_stop(Stop stop, std::ostream& console_stream) const;
+        void print_registers(std::ostream& console_stream) const;
+        void print_memory(uint32_t address, size_t count, std::ostream& console_stream) const;
+        void print_disassembly(uint32_t address, size_t count, std::ostream& console_stream) const;
+        void print_points(std::ostream& console_stream) const;
+
+        // Обработчик SIGSEGV.
+        static void handle(int signal_number, siginfo_t* information, void* context);
+
+        // Данные.
+        Emulator& emulator;                       // Отлаживаемый эмулятор.
+        std::map<uint32_t, uint32_t> breakpoints; // Исходные слова по адресам точек останова.
+        std::map<uint32_t, uint32_t> watchpoints; // Последние известные значения наблюдаемых слов.
+        std::vector<uint8_t*> pages;              // Защищаемые страницы хоста.
+        size_t page_size;                         // Размер страницы хоста.
+        const uint8_t* memory_begin;              // Память машины (границы для обработчика).
+        const uint8_t* memory_end;
+        volatile sig_atomic_t armed;              // Страницы защищены.
+        volatile sig_atomic_t faulted;            // Была запись в защищённую страницу.
+        std::atomic<bool> stop_requested{false};  // Запрошена остановка.
+        bool alive;                               // Машина не остановилась.
+        struct sigaction previous;                // Прежний обработчик SIGSEGV.
+
+        static Debugger* volatile active; // Работающий отладчик (используется обработчиком).
+
+    private:
+
+    };
+}
+
+#endif
@@ -4,7 +4,17 @@
 #include <cstdint>    // Целочисленные типы фиксированной длины.
 #include <vector>     // vector.
 #include <map>        // map.
+#include <unordered_map> // unordered_map.
+#include <string_view>   // string_view.
+#include <string>     // string.
 #include <iostream>   // file stream.
+#include <cstring>    // memcpy.
+#include <thread>     // thread.
+
+#include "Heap.hpp"
+#include "PagedMemory.hpp"
+#include <mutex>      // mutex.
+#include <atomic>     // atomic.
 
 
 // НЕБОЛЬШОЙ КОММЕНТАРИЙ КАСАТЕЛЬНО РАБОТЫ С ПАМЯТЬЮ.
@@ -66,7 +76,9 @@ namespace FUPM2EMU
         LOADR   = 68,
         LOADR2  = 69,
         STORER  = 70,
-        STORER2 = 71
+        STORER2 = 71,
+
+        TRAP    = 255 // Точка останова отладчика (подставляется вместо команды, не ассемблируется; без отладчика - неизвестная команда).
     };
 
     // Типы операций.
@@ -81,24 +93,42 @@ namespace FUPM2EMU
 
 
     ////////////////      State      ///////////////
+    // Настройки компиляции:
+    #define MEMORY_MOD          // Модульная адресация.
+    //#define MEMORY_EXCEPTIONS // Исключение при выходе за пределы адресного пространства.
+
     // Состояние машины: значение регистров, флагов, указатель на блок памяти.
     class State
     {
     public:
         // Константы.
-        static const uint8_t bytes_in_word = 4;                 // Число байт в машинном слове.
-        static const uint8_t bits_in_word  = bytes_in_word * 8; // Число бит в машинном слове.
-        static const uint8_t address_bits  = 20;                // Число бит в адресах.
-        static const size_t  memory_size   = 1 << address_bits; // Размер адресуемой памяти (в словах).
-        static const uint8_t registers_number = 16;             // Количество регистров.
-        static const uint8_t CIR = 15; // Current instruction register - номер текущей инструкции.
-        static const uint8_t SR  = 14; // Stack register - адрес стека.
+        static constexpr uint8_t bytes_in_word = 4;                 // Число байт в машинном слове.
+        static constexpr uint8_t bits_in_word  = bytes_in_word * 8; // Число бит в машинном слове.
+        static constexpr uint8_t address_bits  = 20;                // Число бит в адресах.
+        static constexpr size_t  memory_size   = 1 << address_bits; // Размер адресуемой памяти (в словах).
+        static constexpr uint8_t registers_number = 16;             // Количество регистров.
+        static constexpr uint8_t CIR = 15; // Current instruction register - номер текущей инструкции.
+        static constexpr uint8_t SR  = 14; // Stack register - адрес стека.
+        static constexpr uint8_t page_bits    = 10;                       // Число бит адреса слова внутри страницы.
+        static constexpr size_t  page_size    = 1 << page_bits;           // Размер страницы (в словах) для отслеживания изменений памяти.
+        static constexpr size_t  pages_number = memory_size >> page_bits; // Количество страниц.
+        static constexpr size_t  stack_reserve = 1 << 16;                // Число слов под стек, не выдаваемых распределителем памяти.
 
         // Коды исключений.
         enum class Exception
         {
-            OK,     // OK.
-            MEMORY, // Выход за пределы адресуемой памяти.
+            OK,         // OK.
+            MEMORY,     // Выход за пределы адресуемой памяти.
+            CHECKPOINT, // Повреждённый файл контрольных точек или несуществующая контрольная точка.
+            BACKEND,    // Операция не поддерживается разреженной памятью.
+            EXECUTABLE, // Повреждённый исполнимый файл или неподдерживаемая версия формата.
+        };
+
+        // Способ хранения памяти.
+        enum class Backend
+        {
+            DENSE,  // Один блок memory_size слов (адреса - address_bits бит).
+            SPARSE, // Разреженная память PagedMemory с задаваемой разрядностью адресов.
         };
 
         // Биты регистра флагов.
@@ -120,28 +150,253 @@ namespace FUPM2EMU
         // Данные состояния.
         int32_t registers[registers_number]; // Массив регистров (32 бита).
         uint8_t flags;                       // Регистр флагов (разрядность не задана спецификацией).
-        std::vector<uint8_t> memory;         // Память эмулируемой машины.
+        std::vector<uint8_t> memory;         // Память эмулируемой машины (плотная).
+        std::vector<uint8_t> dirty_pages;    // Страницы, изменённые после последней контрольной точки (1 - изменена).
+        std::vector<uint8_t> written_pages;  // Страницы, изменённые после clear() до последней контрольной точки или отката.
+        Heap heap;                           // Динамическая память между концом образа программы и стеком.
+        size_t image_size;                   // Размер образа программы в словах (начало динамической памяти).
+        Backend backend;                     // Способ хранения памяти.
+        size_t memory_words;                 // Размер адресного пространства в словах (memory_size для плотной памяти).
+        size_t address_mask;                 // memory_words - 1.
+        PagedMemory paged;                   // Память эмулируемой машины (разреженная).
+        std::map<uint32_t, std::string> symbols; // Имена адресов (метки ассемблера) для профилировщиков и отладчика.
 
         // Методы.
         State();
+        State(Backend init_backend, uint8_t init_address_bits); // Разрядность адресов плотной памяти всегда address_bits.
         ~State();
 
-        // Загрузка состояния из потока.
+        // Загрузка состояния из потока: исполнимого файла (по сигнатуре) или дампа регистров, флагов и памяти.
         int load(std::istream& input_stream);
 
-        // Удобные и сокращающие длину кода обёртки над read_word() и write_word(), работающие с memory.
+        // Запись исполнимого файла. Формат (слова - старшим байтом вперёд): сигнатура "FUPM2EXE", версия, точка входа (R15),
+        // начальный указатель стека (R14), размер образа в словах (начало динамической памяти), число сегментов; затем таблица
+        // сегментов (адрес, число слов, способ хранения, размер данных в байтах) и данные сегментов в порядке таблицы.
+        // Сегменты содержат только заполненные участки памяти. При compress сегмент, который сжимается, хранится в виде RLE
+        // по словам. Остальные регистры и флаги при загрузке исполнимого файла нулевые.
+        int save_executable(std::ostream& output_stream, bool compress = true) const;
+
+        // Сброс динамической памяти: образ программы занимает image_size первых слов.
+        void reset_heap(size_t init_image_size);
+
+        // Возврат к состоянию только что созданного State того же вида памяти (для повторного использования экземпляра).
+        // Плотная память обнуляется только на страницах, отмеченных в dirty_pages или written_pages, поэтому время очистки
+        // пропорционально объёму памяти, в который писала прошлая программа. В разреженной памяти выделенные страницы
+        // обнуляются, но не освобождаются, чтобы следующая программа не выделяла их заново.
+        void clear();
+
+        // Возврат к состоянию origin: копируются регистры, флаги и только изменённые страницы памяти.
+        // Текущее состояние должно быть копией origin, изменённой только через отмечающие страницы записи.
+        int revert(const State& origin);
+
+        // Инкрементальные контрольные точки. Файл контрольных точек - цепочка записей, каждая из которых содержит регистры,
+        // флаги и только страницы памяти, изменённые после предыдущей записи.
+        int save_checkpoint(std::ostream& output_stream);               // Дописать в поток запись и считать все страницы неизменёнными.
+        int restore_checkpoint(std::istream& input_stream, size_t index); // Восстановить состояние, применив записи с нулевой по index.
+
+        // Имя адреса: ближайшая метка не после него (with_offset - "метка+смещение") или адрес, если такой метки нет.
+        std::string symbolize(uint32_t address, bool with_offset = true) const;
+
+        // Удобные и сокращающие длину кода обёртки над read_word() и write_word() (read_paged() и write_paged()).
         inline uint32_t get_word(size_t address) const;
         inline void set_word(uint32_t value, size_t address);
 
+        // Запись count слов, уже приведённых к порядку байт памяти машины (старшим байтом вперёд), начиная с address.
+        // Копируется блоками; страницы отмечаются, как при set_word().
+        void store_words(const uint32_t* words, size_t address, size_t count);
+
+        // Чтение и запись слова в блоке памяти. Позволяют исполнителю держать указатели на память в локальных переменных.
+        // Запись отмечает страницу в dirty_pages.
+        static inline uint32_t read_word(const uint8_t* memory, size_t address);
+        static inline void write_word(uint8_t* memory, uint8_t* dirty_pages, uint32_t value, size_t address);
+
+        // Перестановка байт слова между порядком памяти машины и порядком хоста.
+        static inline uint32_t from_big_endian(uint32_t value);
+
+        // Чтение и запись слова в разреженной памяти. Адрес приводится к адресному пространству маской.
+        static inline uint32_t read_paged(const PagedMemory& paged, size_t mask, size_t address);
+        static inline void write_paged(PagedMemory& paged, size_t mask, uint32_t value, size_t address);
+
+        // Атомарные операции над словом памяти (последовательная согласованность). Возвращают прежнее значение слова.
+        static inline uint32_t compare_exchange_word(uint8_t* memory, uint8_t* dirty_pages, uint32_t expected, uint32_t desired, size_t address);
+        static inline uint32_t fetch_add_word(uint8_t* memory, uint8_t* dirty_pages, uint32_t addend, size_t address);
+
     protected:
+        // Исключение BACKEND, если память не плотная.
+        void require_dense(const char* operation) const;
+
+        // Адрес слова для атомарных операций.
+        static inline uint32_t* word_pointer(uint8_t* memory, size_t address);
+
+        // Чтение и запись слова в потоке (старшим байтом вперёд).
+        static bool read_stream_word(std::istream& input_stream, uint32_t& value);
+        static void write_stream_word(std::ostream& output_stream, uint32_t value);
+
+        // Маркер записи в файле контрольных точек.
+        static const uint32_t checkpoint_marker = 0x434B5032; // "CKP2" (записи с состоянием распределителя памяти).
+
+        // Исполнимый файл.
+        static const char executable_signature[8];           // "FUPM2EXE".
+        static const uint32_t executable_version = 1;        // Версия формата.
+        static const size_t segment_gap = 16;                // Число нулевых слов, разделяющее сегменты.
+        static const uint32_t rle_run = 0x80000000;          // Бит серии в заголовке пакета RLE (иначе - число слов без сжатия).
+
+        // Способ хранения сегмента.
+        enum SegmentEncoding
+        {
+            RAW = 0, // Слова как есть (читаются прямо в память машины).
+            RLE = 1, // Пакеты: серия (заголовок с rle_run и одно слово) или заголовок с числом слов и сами слова.
+        };
+
+        // Загрузка исполнимого файла (сигнатура уже прочитана).
+        int load_executable(std::istream& input_stream);
+
+        // Чтение count слов из потока прямо в память начиная с address (false - поток кончился раньше).
+        bool read_memory(std::istream& input_stream, size_t address, size_t count);
+
+        // Сжатие слов сегмента в пакеты RLE.
+        static void compress_segment(const std::vector<uint32_t>& words, std::vector<uint32_t>& packed);
 
     private:
 
     };
 
 
+    // Обращения к памяти встраиваются везде, где используются, поэтому определены в заголовке.
+    inline uint32_t State::get_word(size_t address) const
+    {
+        if (backend == Backend::DENSE) { return read_word(memory.data(), address); }
+        return read_paged(paged, address_mask, address);
+    }
+    inline void State::set_word(uint32_t value, size_t address)
+    {
+        if (backend == Backend::DENSE) { write_word(memory.data(), dirty_pages.data(), value, address); }
+        else { write_paged(paged, address_mask, value, address); }
+    }
+
+    inline uint32_t State::read_word(const uint8_t* memory, size_t address)
+    {
+        // Адресация по модулю.
+        #ifdef MEMORY_MOD
+        address %= memory_size;
+        #endif
+
+        // Исключение при выходе за пределы адресного пространства.
+        #ifdef MEMORY_EXCEPTIONS
+        if (address > memory_size) { throw Exception::MEMORY; }
+        #endif
+
+        // Слово хранится в памяти старшим байтом вперёд. Чтение одним обращением вместо четырёх побайтовых.
+        uint32_t value;
+        std::memcpy(&value, memory + address * bytes_in_word, sizeof(value));
+        return from_big_endian(value);
+    }
+    inline void State::write_word(uint8_t* memory, uint8_t* dirty_pages, uint32_t value, size_t address)
+    {
+        // Адресация по модулю.
+        #ifdef MEMORY_MOD
+        address %= memory_size;
+        #endif
+
+        // Исключение при выходе за пределы адресного пространства.
+        #ifdef MEMORY_EXCEPTIONS
+        if (address > memory_size) { throw Exception::MEMORY; }
+        #endif
+
+        value = from_big_endian(value); // Преобразование симметрично.
+        std::memcpy(memory + address * bytes_in_word, &value, sizeof(value));
+        dirty_pages[address >> page_bits] = 1;
+    }
+
+    inline uint32_t State::read_paged(const PagedMemory& paged, size_t mask, size_t address)
+    {
+        // Исключение при выходе за пределы адресного пространства.
+        #ifdef MEMORY_EXCEPTIONS
+        if (address > mask) { throw Exception::MEMORY; }
+        #endif
+        address &= mask;
+
+        const uint8_t* page = paged.find(address);
+        if (page == nullptr) { return 0; } // Невыделенная страница заполнена нулями.
+
+        uint32_t value;
+        std::memcpy(&value, page + (address & (PagedMemory::page_words - 1)) * bytes_in_word, sizeof(value));
+        return from_big_endian(value);
+    }
+    inline void State::write_paged(PagedMemory& paged, size_t mask, uint32_t value, size_t address)
+    {
+        // Исключение при выходе за пределы адресного пространства.
+        #ifdef MEMORY_EXCEPTIONS
+        if (address > mask) { throw Exception::MEMORY; }
+        #endif
+        address &= mask;
+
+        value = from_big_endian(value);
+        std::memcpy(paged.obtain(address) + (address & (PagedMemory::page_words - 1)) * bytes_in_word, &value, sizeof(value));
+    }
+
+    inline uint32_t State::compare_exchange_word(uint8_t* memory, uint8_t* dirty_pages, uint32_t expected, uint32_t desired, size_t address)
+    {
+        uint32_t* pointer = word_pointer(memory, address);
+        uint32_t observed = from_big_endian(expected);
+        __atomic_compare_exchange_n(pointer, &observed, from_big_endian(desired), false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+        dirty_pages[(pointer - reinterpret_cast<uint32_t*>(memory)) >> page_bits] = 1;
+        return from_big_endian(observed);
+    }
+    inline uint32_t State::fetch_add_word(uint8_t* memory, uint8_t* dirty_pages, uint32_t addend, size_t address)
+    {
+        // Слово хранится старшим байтом вперёд, поэтому сложение выполняется циклом сравнения с обменом.
+        uint32_t* pointer = word_pointer(memory, address);
+        uint32_t observed = __atomic_load_n(pointer, __ATOMIC_SEQ_CST);
+        while (!__atomic_compare_exchange_n(pointer, &observed, from_big_endian(from_big_endian(observed) + addend), true,
+                                            __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) { }
+        dirty_pages[(pointer - reinterpret_cast<uint32_t*>(memory)) >> page_bits] = 1;
+        return from_big_endian(observed);
+    }
+    inline uint32_t* State::word_pointer(uint8_t* memory, size_t address)
+    {
+        // Адресация по модулю.
+        #ifdef MEMORY_MOD
+        address %= memory_size;
+        #endif
+
+        // Исключение при выходе за пределы адресного пространства.
+        #ifdef MEMORY_EXCEPTIONS
+        if (address > memory_size) { throw Exception::MEMORY; }
+        #endif
+
+        // Блок памяти выделяется с выравниванием не меньше слова.
+        return reinterpret_cast<uint32_t*>(memory + address * bytes_in_word);
+    }
+
+    // Перестановка байт слова между порядком памяти машины (старший байт вперёд) и порядком хоста.
+    inline uint32_t State::from_big_endian(uint32_t value)
+    {
+        #if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+        return __builtin_bswap32(value);
+        #elif defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+        return value;
+        #else
+        uint8_t bytes[bytes_in_word];
+        std::memcpy(bytes, &value, sizeof(value));
+        return (static_cast<uint32_t>(bytes[0]) << 24) |
+               (static_cast<uint32_t>(bytes[1]) << 16) |
+               (static_cast<uint32_t>(bytes[2]) << 8)  |
+                static_cast<uint32_t>(bytes[3]);
+        #endif
+    }
+
+
+    class CallProfiler;
+    class CacheSimulator;
+    class BranchProfiler;
+
     ////////////////    Executor    ////////////////
     // Исполнитель машинных команд.
+    // Многоядерность: основное ядро использует регистры и флаги State, дополнительные ядра (системный вызов SPAWN) - собственные
+    // регистры и флаги и отдельные потоки хоста; память у всех ядер общая.
+    // Модель памяти: обычные LOAD/STORE слова не разрываются (слово выровнено), но не упорядочены между ядрами. CAS и FETCHADD атомарны
+    // на уровне слова и последовательно согласованы; SPAWN и JOIN упорядочивают все обращения до них. Ввод-вывод ядер сериализуется.
     class Executor
     {
     public:
@@ -160,7 +415,47 @@ namespace FUPM2EMU
             TERMINATE, // Штатное завершение.
             WARNING,   // Не описанная в спецификации потенциально опасная работа.
             ERROR,     // Критическая ошибка.
+            BREAK,     // Остановка основного ядра для отладчика: команда TRAP (только при debugging) или запрос interrupt.
+        };
+
+        // Данные.
+        std::string sandbox;   // Каталог хоста для файловых системных вызовов (пустая строка - файловые вызовы запрещены).
+        // Статистика выполненных команд всех ядер по классам операций (команда, вызвавшая исключение, тоже учитывается).
+        // Ведётся всегда: каждая ветвь цикла интерпретатора увеличивает локальный счётчик своего класса, счётчики переносятся сюда
+        // при выходе из цикла.
+        struct Statistics
+        {
+            enum Class
+            {
+                ALU,         // Целочисленная арифметика, логика, сравнения, LC, MOV.
+                DOUBLE,      // Вещественная арифметика, сравнение и преобразования.
+                JUMP,        // Безусловные переходы, вызовы и возвраты (всегда выполняются).
+                CONDITIONAL, // Условные переходы.
+                MEMORY,      // Загрузки и выгрузки.
+                STACK,       // PUSH и POP.
+                SYSTEM,      // SYSCALL, HALT и неизвестные коды операций.
+                CLASSES_NUMBER,
+            };
+
+            uint64_t classes[CLASSES_NUMBER] = {}; // Число команд каждого класса.
+            uint64_t taken = 0;                    // Выполненные (совершённые) условные переходы.
+
+            uint64_t retired() const;                                                    // Всего команд.
+            uint64_t branches_taken() const { return classes[JUMP] + taken; }            // Совершённые переходы.
+            uint64_t branches_not_taken() const { return classes[CONDITIONAL] - taken; } // Несовершённые условные переходы.
         };
+        Statistics statistics;
+
+        bool sampling = false; // Публикация выполняемой команды основного ядра в sample (для профилировщика по сигналу).
+        volatile uint32_t sample = 0; // Адрес выполняемой команды (код операции профилировщик берёт из памяти при выводе).
+        CallProfiler* call_profiler = nullptr; // Профилировщик графа вызовов основного ядра (задаётся до запуска).
+        BranchProfiler* branch_profiler = nullptr; // Статистика условных переходов основного ядра (задаётся до запуска).
+        CacheSimulator* cache_simulator = nullptr; // Модель кэша для обращений основного ядра (задаётся до запуска).
+        // Запрос остановки основного ядра (может устанавливаться из обработчика сигнала или другого потока). Проверяется
+        // только на переходах назад (JMP, Jcc, CALL, CALLI, RET), поэтому цикл без запроса не платит за проверку на каждой
+        // команде, а любой бесконечный цикл всё равно остановится. Ядро возвращает BREAK; сбрасывает запрос тот, кто его установил.
+        std::atomic<bool> interrupt{false};
+        bool debugging = false; // Подключён отладчик: TRAP останавливает основное ядро (иначе это неизвестная команда - ошибка).
 
         // Методы.
         Executor();
@@ -169,6 +464,29 @@ namespace FUPM2EMU
         // Выполнение команды.
         inline ReturnCode step(State& state, std::istream& input_stream, std::ostream& output_stream);
 
+        // Выполнение команд до останова.
+        ReturnCode run(State& state, std::istream& input_stream, std::ostream& output_stream);
+
+        // Выполнение не более budget команд. Из budget вычитается число выполненных команд; при исчерпании возвращается OK.
+        // Бюджет ограничивает всю машину: при возврате дополнительные ядра останавливаются (кроме остановки для отладчика).
+        ReturnCode run(State& state, std::istream& input_stream, std::ostream& output_stream, uint64_t& budget);
+
+        // Остановка дополнительных ядер на ближайшем переходе назад и ожидание их завершения.
+        void stop_cores();
+
+        // Подготовка к новой программе (повторное использование экземпляра): дополнительные ядра останавливаются, файлы
+        // машины закрываются, запрос interrupt сбрасывается. Статистика выполненных команд сохраняется.
+        void reset();
+
+        // Наибольшее число ядер, включая основное.
+        static const size_t cores_number = 16;
+
+        #ifdef FUPM2EMU_FUZZING
+        // Карта покрытия рёбер (предыдущая команда, текущая команда) для фаззера. Задаётся до запуска.
+        static const size_t coverage_size = 1 << 16;
+        static uint8_t* coverage;
+        #endif
+
     protected:
         // Коды испключений при выполнении операции.
         enum class OperationException
@@ -180,6 +498,143 @@ namespace FUPM2EMU
             REGOVERFLOW, // Переполнение регистра.
         };
 
+        // Способы доступа интерпретатора к памяти создаются от состояния и исполнителя.
+        // Доступ интерпретатора к плотной памяти.
+        struct DenseAccess
+        {
+            uint8_t* const memory;      // Память машины.
+            uint8_t* const dirty_pages; // Отметки изменённых страниц.
+
+            DenseAccess(State& state, Executor&) : memory(state.memory.data()), dirty_pages(state.dirty_pages.data()) {}
+            inline uint32_t fetch(size_t address) { return State::read_word(memory, address); }
+            inline uint32_t read(size_t address) const { return State::read_word(memory, address); }
+            inline void write(uint32_t value, size_t address) const { State::write_word(memory, dirty_pages, value, address); }
+        };
+        // Доступ интерпретатора к разреженной памяти. Страница выбираемых команд запоминается отдельно от кэша PagedMemory:
+        // обращения к данным на других страницах не вытесняют её, а сама копия остаётся в регистрах цикла.
+        struct PagedAccess
+        {
+            PagedMemory& paged;                  // Память машины.
+            const size_t mask;                   // Маска адресного пространства.
+            size_t code_index = SIZE_MAX;        // Номер страницы выбираемых команд.
+            const uint8_t* code_page = nullptr;  // Страница выбираемых команд (только выделенная: страницы не освобождаются).
+
+            PagedAccess(State& state, Executor&) : paged(state.paged), mask(state.address_mask) {}
+            inline uint32_t fetch(size_t address)
+            {
+                #ifdef MEMORY_EXCEPTIONS
+                if (address > mask) { throw State::Exception::MEMORY; }
+                #endif
+                address &= mask;
+                if ((address >> PagedMemory::page_bits) != code_index)
+                {
+                    const uint8_t* page = paged.find(address);
+                    if (page == nullptr) { return 0; }
+                    code_index = address >> PagedMemory::page_bits;
+                    code_page = page;
+                }
+                uint32_t value;
+                std::memcpy(&value, code_page + (address & (PagedMemory::page_words - 1)) * State::bytes_in_word, sizeof(value));
+                return State::from_big_endian(value);
+            }
+            inline uint32_t read(size_t address) const { return State::read_paged(paged, mask, address); }
+            inline void write(uint32_t value, size_t address) const { State::write_paged(paged, mask, value, address); }
+        };
+        // Доступ с моделью кэша: каждое обращение сначала передаётся cache_simulator, затем выполняется через Memory.
+        // Используется только вариантами цикла с моделью кэша, обычные варианты её не содержат.
+        template <typename Memory>
+        struct SimulatedAccess
+        {
+            Memory memory;              // Память машины.
+            CacheSimulator& simulator;  // Модель кэша.
+
+            SimulatedAccess(State& state, Executor& executor);
+            inline uint32_t fetch(size_t address);
+            inline uint32_t read(size_t address) const;
+            inline void write(uint32_t value, size_t address) const;
+        };
+
+        // Основной цикл интерпретатора (single_step - выполнение одной команды, limited - не более budget команд,
+        // sampled - публикация команды в sample, traced - события вызовов и условных переходов для call_profiler и branch_profiler, Memory - способ доступа к памяти).
+        // Регистры и флаги ядра передаются отдельно от памяти (state).
+        template <bool single_step, bool limited, bool sampled, bool traced, typename Memory>
+        ReturnCode execute(State& state, int32_t* context_registers, uint8_t& context_flags,
+                           std::istream& input_stream, std::ostream& output_stream, uint64_t& budget);
+
+        // Системный вызов. Работает непосредственно с регистрами и флагами ядра.
+        ReturnCode syscall(State& state, int32_t* registers, uint8_t flags, uint8_t R1, int32_t imm20,
+                           std::istream& input_stream, std::ostream& output_stream);
+
+        // Дополнительное ядро.
+        struct Core
+        {
+            int32_t registers[State::registers_number]; // Регистры ядра.
+            uint8_t flags = 0;                          // Флаги ядра.
+            std::thread thread;                         // Поток хоста, выполняющий ядро.
+            ReturnCode result = ReturnCode::OK;         // Код завершения (действителен после JOIN).
+            bool used = false;                          // Занято ли ядро (до JOIN).
+            size_t parent = 0;                          // Номер запустившего ядра: только оно может ожидать это ядро.
+        };
+
+        // Выполнение основного ядра с ожиданием дополнительных после останова.
+        template <bool single_step, bool limited>
+        ReturnCode run_main(State& state, std::istream& input_stream, std::ostream& output_stream, uint64_t& budget);
+
+        // Выбор варианта цикла интерпретатора по sampling, профилировщикам переходов и cache_simulator.
+        template <bool single_step, bool limited, typename Memory>
+        ReturnCode dispatch(State& state, std::istream& input_stream, std::ostream& output_stream, uint64_t& budget);
+
+        // Ожидание всех дополнительных ядер.
+        void join_cores();
+
+        // Номер ядра по его регистрам (0 - основное ядро).
+        size_t core_id(const State& state, const int32_t* registers) const;
+
+        // Файловые системные вызовы. Файл машины - последовательность слов, хранящихся старшим байтом вперёд, как и в памяти,
+        // поэтому данные передаются между файлом и State::memory одним вызовом read()/write() без преобразования.
+        static const size_t files_number = 64;                                  // Наибольшее число открытых файлов.
+        int32_t open_file(State& state, uint32_t path_address, int32_t mode);   // Открытие файла по пути из памяти машины.
+        int32_t transfer_file(State& state, int32_t handle, uint32_t address, int32_t count, bool reading); // Чтение или запись слов.
+        int file_descriptor(int32_t handle) const;                              // Дескриптор хоста (-1, если файл не открыт).
+
+        // Выполнение дополнительного ядра в его потоке.
+        ReturnCode run_core(State& state, Core& core, std::istream& input_stream, std::ostream& output_stream);
+
+        // Данные.
+        Core cores[cores_number]; // Дополнительные ядра (cores[0] не используется: это основное ядро).
+        std::mutex cores_mutex;   // Защита таблицы ядер.
+        std::mutex io_mutex;      // Сериализация ввода-вывода ядер.
+        std::atomic<size_t> running_cores{0}; // Число запущенных и ещё не ожидавшихся дополнительных ядер.
+        std::atomic<bool> stopping{false};    // Запрос остановки дополнительных ядер (проверяется ими на переходах назад).
+        int files[files_number];  // Дескрипторы открытых файлов машины (-1 - свободно).
+
+        // Сообщение об исключении операции и преобразование его в исключение исполнителя.
+        static void report(OperationException exception);
+
+        // Работа с вещественным числом в паре регистров без приведения указателей.
+        static inline double get_double(const int32_t* registers, uint8_t reg);
+        static inline void set_double(int32_t* registers, uint8_t reg, double value);
+
+        // Ленивый регистр флагов: CMP/CMPI/CMPD запоминают операнды, предикаты вычисляются только при переходах,
+        // а сами флаги - только при выгрузке в состояние (системные вызовы, исключения, выход).
+        struct LazyFlags
+        {
+            uint8_t flags; // Регистр флагов на момент загрузки (биты, не относящиеся к сравнению, сохраняются).
+            int32_t left;  // Левый операнд последнего сравнения.
+            int32_t right; // Правый операнд последнего сравнения.
+            bool compared; // Было ли сравнение после загрузки.
+
+            inline void load(uint8_t init_flags);
+            inline uint8_t store() const;
+
+            inline void compare(int32_t init_left, int32_t init_right);
+            inline void compare(double init_left, double init_right);
+
+            inline bool equal() const;
+            inline bool less() const;
+            inline bool less_equal() const;
+        };
+
     private:
 
     };
@@ -210,9 +665,20 @@ namespace FUPM2EMU
         // Ассемблирование кода из файла.
         int assemble(std::istream& input_stream, State& state) const;
 
+        // Параллельное ассемблирование: исходный код читается целиком, делится по границам строк на threads частей, которые
+        // ассемблируются в отдельных потоках, и собирается в state. Результат совпадает с assemble(). threads = 0 - по числу
+        // потоков процессора, threads = 1 - обычное ассемблирование.
+        int assemble(std::istream& input_stream, State& state, unsigned int threads) const;
+
         // Дизассемблирование состояния в файл.
         int disassemble(const State& state, std::ostream& output_sream) const;
 
+        // Дизассемблирование одного слова: команда с аргументами или число, если операции с таким кодом нет.
+        std::string disassemble(uint32_t word) const;
+
+        // Имя операции по её коду (число, если операции с таким кодом нет).
+        std::string operation_name(uint8_t code) const;
+
     protected:
         // Данные для трансляции.
         std::map<std::string, OPERATION_CODE> op_code; // Отображение из имени операции в её код.
@@ -223,6 +689,12 @@ namespace FUPM2EMU
         std::map<OPERATION_CODE, OPERATION_TYPE> code_type; // Отображение из кода операции в её тип.
         std::map<int, std::string> code_reg; // Отображение из кода регистра в его имя.
 
+        std::unordered_map<std::string, std::pair<OPERATION_CODE, OPERATION_TYPE>> op_lookup; // Код и тип операции по имени (ассемблирование).
+        std::unordered_map<std::string, int> reg_lookup;                                      // Код регистра по имени (ассемблирование).
+
+        // Чтение лексем исходного кода блоками из потока или из памяти.
+        class TokenReader;
+
         // Структура для обработки исключений при ассемблировании.
         struct AssemblingException
         {
@@ -248,6 +720,24 @@ namespace FUPM2EMU
             AssemblingException(size_t init_address, Code init_code);
         };
 
+        // Число из десятичных цифр (false - в лексеме есть не цифры, то есть это метка). Число больше INT32_MAX - исключение code
+        // по адресу address.
+        static bool parse_unsigned(std::string_view token, uint32_t& value, size_t address, AssemblingException::Code code);
+
+        // Короткий непосредственный операнд: знак и цифры до первой не цифры, как у std::stoi.
+        static int32_t parse_signed(std::string_view token, size_t address);
+
+        // Разбор лексем: комментарии, директивы и команды. Объявления и использования меток, директивы word и end и запись
+        // команд передаются output (последовательно - в память машины, при параллельном ассемблировании - в буфер части).
+        template <typename Output>
+        void assemble_tokens(TokenReader& reader, Output& output) const;
+
+        // Последовательное ассемблирование (исключение AssemblingException при ошибке).
+        void assemble_serial(TokenReader& reader, State& state) const;
+
+        // Сообщение об ошибке ассемблирования.
+        static void report(const AssemblingException& exception);
+
     private:
 
     };
@@ -265,11 +755,27 @@ namespace FUPM2EMU
 
         // Методы.
         Emulator();
+        Emulator(State::Backend backend, uint8_t address_bits); // Память выбранного вида с разрядностью адресов address_bits.
         ~Emulator();
 
+        // Повторное использование экземпляра: нулевое состояние машины (регистры, флаги, память, символы) и загрузка образа
+        // в нулевое состояние. Обнуляются только страницы, в которые писала прошлая программа. Ядра и файлы прошлой
+        // программы не переживают reset(): ядра останавливаются, файлы закрываются (Executor::reset()).
+        void reset();
+        int reload(std::istream& image_stream);
+
         int run(std::istream& input_stream, std::ostream& output_stream); // Выполнить текущее состояние.
 
+        // Выполнить текущее состояние, дописывая контрольную точку в checkpoint_stream каждые interval команд и при останове.
+        int run(std::istream& input_stream, std::ostream& output_stream, std::ostream& checkpoint_stream, uint64_t interval);
+
+        // Выполнить не более budget команд (из budget вычитается число выполненных). Возвращает TERMINATE при останове,
+        // ERROR при ошибке и OK при исчерпании бюджета.
+        Executor::ReturnCode run(std::istream& input_stream, std::ostream& output_stream, uint64_t& budget);
+
     protected:
+        // Сообщение о критической ошибке исполнителя.
+        static void report(Executor::Exception exception);
 
     private:
 
@@ -0,0 +1,49 @@
+#ifndef FUPM2EMU_FORKSERVER_HPP
+#define FUPM2EMU_FORKSERVER_HPP
+
+#include <cstdint>    // Целочисленные типы фиксированной длины.
+#include <string>     // string.
+#include <iostream>   // file stream.
+
+#include "FUPM2EMU.hpp"
+
+
+namespace FUPM2EMU
+{
+    ////////////////   ForkServer   ////////////////
+    // Сервер запусков (только POSIX): программа загружается или ассемблируется один раз, после чего на каждый запрос из
+    // управляющего канала создаётся дочерний процесс (fork), наследующий подготовленное состояние эмулятора при копировании при записи.
+    // Запрос - строка "<входной файл> <выходной файл>"; строка "quit" завершает работу. Если управляющий файл - именованный канал,
+    // после закрытия всех пишущих сторон он открывается заново.
+    // На каждый запрос в поток отчёта выводится строка "<входной файл> <код завершения> <число выполненных команд>".
+    // Код завершения: 0 - останов, 1 - ошибка машины, 128 + N - процесс завершён сигналом N.
+    class ForkServer
+    {
+    public:
+        // Коды исключений.
+        enum class Exception
+        {
+            OK,      // OK.
+            CONTROL, // Не удалось открыть управляющий канал.
+        };
+
+        // Методы.
+        ForkServer(Emulator& emulator);
+        ~ForkServer();
+
+        // Обработка запросов из управляющего канала до строки "quit" или конца файла.
+        int serve(const std::string& control_path, std::ostream& report_stream);
+
+    protected:
+        // Данные.
+        Emulator& emulator; // Эмулятор с подготовленным состоянием.
+
+        // Выполнение одного запроса в дочернем процессе. Возвращает код завершения, число команд - через instructions.
+        int run_child(const std::string& input_path, const std::string& output_path, uint64_t& instructions);
+
+    private:
+
+    };
+}
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef FUPM2EMU_GDBSERVER_HPP
+#define FUPM2EMU_GDBSERVER_HPP
+
+#include <cstdint>    // Целочисленные типы фиксированной длины.
+#include <string>     // string.
+#include <iostream>   // istream, ostream.
+
+#include "FUPM2EMU.hpp"
+#include "Debugger.hpp"
+
+
+namespace FUPM2EMU
+{
+    ////////////////   GdbServer    ////////////////
+    // Сервер протокола удалённой отладки GDB (RSP, только POSIX): ожидает одно подключение на порту TCP 127.0.0.1 или
+    // UNIX-сокете и управляет основным ядром через Debugger. Машина стоит перед первой командой до подключения.
+    // Регистры: r0-r13, sp (SR), pc (CIR), flags - по 32 бита, старший байт первым. Адреса протокола байтовые: слово N
+    // занимает байты 4N..4N+3 (старший байт первым), поэтому sp и pc передаются умноженными на 4. Точки останова (Z0)
+    // ставятся на слова, точки наблюдения за записью (Z2) - на все слова диапазона. Ctrl-C во время выполнения
+    // останавливает машину через Executor::interrupt, то есть на ближайшем переходе назад.
+    // После отсоединения (D) или разрыва соединения точки убираются и программа выполняется дальше обычным интерпретатором.
+    class GdbServer
+    {
+    public:
+        // Коды исключений.
+        enum class Exception
+        {
+            OK,     // OK.
+            SOCKET, // Не удалось открыть сокет или дождаться подключения.
+        };
+
+        // Методы.
+        GdbServer(Emulator& emulator);
+        ~GdbServer();
+
+        // Отладка через одно подключение к address: номер порта TCP или путь UNIX-сокета.
+        int serve(const std::string& address, std::istream& input_stream, std::ostream& output_stream);
+
+    protected:
+        static const uint8_t registers_number = State::registers_number + 1; // Регистры протокола (с флагами).
+        static const size_t packet_size = 0x4000;                            // Наибольший размер пакета.
+
+        // Открытие слушающего сокета и ожидание подключения. Возвращает дескриптор соединения или -1.
+        int accept_client(const std::string& address);
+
+        // Обмен пакетами. false - соединение разорвано.
+        int next_byte();
+        bool receive(std::string& packet);
+        bool send(const std::string& payload);
+
+        // Обработка пакета. Возвращает ответ (отсоединение и завершение отмечаются в detached и killed).
+        std::string handle(const std::string& packet, Debugger& debugger, std::istream& input_stream, std::ostream& output_stream);
+
+        // Выполнение с ожиданием Ctrl-C от клиента (steps = 0 - до остановки) и ответ об остановке.
+        std::string resume(Debugger& debugger, std::istream& input_stream, std::ostream& output_stream, uint64_t steps);
+
+        // Регистр протокола и его запись.
+        uint32_t get_register(size_t index) const;
+        void set_register(size_t index, uint32_t value);
+
+        // Данные.
+        Emulator& emulator;    // Отлаживаемый эмулятор.
+        int connection;        // Дескриптор соединения.
+        std::string received;  // Принятые, но не разобранные байты.
+        size_t position;       // Позиция разбора в received.
+        bool acknowledge;      // Подтверждение пакетов ('+'), до QStartNoAckMode.
+        bool detached;         // Клиент отсоединился.
+        bool killed;           // Клиент завершил отладку (k): программа не продолжается.
+
+    private:
+
+    };
+}
+
+#endif
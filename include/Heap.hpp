@@ -0,0 +1,99 @@
+#ifndef FUPM2EMU_HEAP_HPP
+#define FUPM2EMU_HEAP_HPP
+
+#include <cstdint>        // Целочисленные типы фиксированной длины.
+#include <vector>         // vector.
+#include <iostream>       // file stream.
+
+
+namespace FUPM2EMU
+{
+    ////////////////      Heap      ////////////////
+    // Распределитель динамической памяти машины (системные вызовы MALLOC, FREE, REALLOC).
+    // Управляет участком адресов [begin, end) между концом образа программы и стеком. Блоки имеют размеры-степени двойки
+    // (классы размеров); освобождённые блоки хранятся в списках своего класса и выдаются повторно без слияния, новые -
+    // отрезаются от вершины. Все служебные данные хранятся на стороне хоста, память машины распределитель не читает и не пишет.
+    // Занятые блоки хранятся в хеш-таблице с открытой адресацией: служебные данные растут с числом блоков, а не с размером
+    // участка (один большой блок разреженной памяти - одна ячейка). Ячейки не выделяются по одной, а ёмкость таблицы
+    // сохраняется при reset() и копировании, поэтому после прогрева выделения машины не выделяют память хоста.
+    class Heap
+    {
+    public:
+        // Статистика распределений.
+        struct Statistics
+        {
+            uint64_t allocations   = 0; // Успешные выделения (включая перенос при REALLOC).
+            uint64_t releases      = 0; // Освобождения.
+            uint64_t reallocations = 0; // Вызовы REALLOC.
+            uint64_t in_place      = 0; // REALLOC без переноса блока.
+            uint64_t failures      = 0; // Неудачные выделения.
+            size_t blocks          = 0; // Занятые блоки.
+            size_t used            = 0; // Занято слов (с округлением до класса).
+            size_t peak            = 0; // Наибольшее значение used.
+        };
+
+        // Данные.
+        Statistics statistics;
+
+        // Методы.
+        Heap();
+        ~Heap();
+
+        // Начало работы с участком [begin, end). Все блоки считаются свободными, статистика обнуляется.
+        void reset(size_t begin, size_t end);
+
+        // Выделение блока из size слов. Возвращает адрес или 0, если места нет.
+        uint32_t allocate(size_t size);
+
+        // Освобождение блока. Возвращает false, если по адресу нет занятого блока.
+        bool release(uint32_t address);
+
+        // Вместимость занятого блока в словах (0, если блока нет).
+        size_t capacity(uint32_t address) const;
+
+        // Проверка, помещается ли новый размер в занятый блок (тогда блок не переносится).
+        bool resize(uint32_t address, size_t size);
+
+        // Вывод статистики.
+        void print_statistics(std::ostream& output_stream) const;
+
+        // Сохранение всего состояния распределителя (участок, занятые и свободные блоки, статистика) в последовательность слов
+        // и восстановление из неё (контрольные точки). load() возвращает false при повреждённых данных, состояние тогда не меняется.
+        void save(std::vector<uint32_t>& words) const;
+        bool load(const std::vector<uint32_t>& words);
+
+    protected:
+        static const uint8_t min_class = 2;          // Наименьший блок - 4 слова.
+        static const uint8_t classes_number = 32;    // Число классов размеров.
+        static const uint32_t no_block = 0xFFFFFFFF; // Адрес пустой ячейки таблицы (блок не может начинаться с последнего слова).
+
+        // Ячейка таблицы занятых блоков.
+        struct Block
+        {
+            uint32_t address;    // Начало блока.
+            uint8_t block_class; // Класс размера.
+        };
+
+        // Класс размера для size слов.
+        static uint8_t size_class(size_t size);
+
+        // Работа с таблицей занятых блоков. find_block() возвращает номер ячейки или blocks.size(), если блока нет.
+        size_t find_block(uint32_t address) const;
+        void insert_block(uint32_t address, uint8_t block_class);
+        void erase_block(size_t index);
+        size_t home(uint32_t address) const; // Начальная ячейка поиска.
+
+        // Данные.
+        size_t begin;                                     // Начало участка.
+        size_t end;                                       // Конец участка.
+        size_t top;                                       // Начало ещё не выданной части участка.
+        std::vector<uint32_t> free_blocks[classes_number]; // Свободные блоки по классам.
+        std::vector<Block> blocks;                        // Таблица занятых блоков (размер - степень двойки или 0).
+        size_t blocks_used;                               // Занятые ячейки таблицы.
+
+    private:
+
+    };
+}
+
+#endif
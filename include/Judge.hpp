@@ -0,0 +1,79 @@
+#ifndef FUPM2EMU_JUDGE_HPP
+#define FUPM2EMU_JUDGE_HPP
+
+#include <cstdint>    // Целочисленные типы фиксированной длины.
+#include <vector>     // vector.
+#include <string>     // string.
+#include <iostream>   // file stream.
+
+#include "FUPM2EMU.hpp"
+
+
+namespace FUPM2EMU
+{
+    ////////////////     Judge      ////////////////
+    // Проверка программы на наборе тестов. Тест - пара файлов <имя>.in и <имя>.out в одном каталоге.
+    // Тесты выполняются параллельно в рабочих потоках; каждый поток держит свой эмулятор с копией подготовленного состояния
+    // и перед каждым тестом откатывает её (State::revert: только изменённые страницы). Ввод и вывод машины - буферы в памяти,
+    // число выполняемых команд ограничено. Ошибка машины в тесте даёт вердикт "Runtime error", проверка продолжается.
+    class Judge
+    {
+    public:
+        // Коды исключений.
+        enum class Exception
+        {
+            OK,        // OK.
+            DIRECTORY, // Каталог тестов не найден или пуст.
+        };
+
+        // Вердикты.
+        enum class Verdict
+        {
+            OK,             // Вывод совпал с ожидаемым.
+            WRONG_ANSWER,   // Вывод не совпал с ожидаемым.
+            RUNTIME_ERROR,  // Ошибка машины.
+            LIMIT_EXCEEDED, // Превышено число команд.
+        };
+
+        // Данные.
+        uint64_t instruction_limit = 1000000000; // Наибольшее число команд в одном тесте.
+        bool ignore_whitespace = true;           // Сравнивать вывод с точностью до пробельных символов.
+        unsigned int threads_number = 0;         // Число рабочих потоков (0 - по числу ядер).
+
+        // Методы.
+        Judge();
+        ~Judge();
+
+        // Запуск состояния на всех тестах каталога и вывод сводной таблицы. Возвращает число не пройденных тестов.
+        int judge(const State& state, const std::string& directory, std::ostream& report_stream) const;
+
+    protected:
+        // Тест и результат его выполнения.
+        struct Case
+        {
+            std::string name;      // Имя теста.
+            std::string input;     // Входные данные.
+            std::string expected;  // Ожидаемый вывод.
+            Verdict verdict = Verdict::OK;
+            uint64_t instructions = 0; // Число выполненных команд.
+            double time = 0.0;         // Время выполнения (мс).
+        };
+
+        // Чтение тестов из каталога.
+        std::vector<Case> load_cases(const std::string& directory) const;
+
+        // Выполнение одного теста на эмуляторе потока.
+        void run_case(Emulator& emulator, const State& state, Case& test_case) const;
+
+        // Сравнение вывода с ожидаемым.
+        bool compare(const std::string& output, const std::string& expected) const;
+
+        // Название вердикта в таблице.
+        static const char* verdict_name(Verdict verdict);
+
+    private:
+
+    };
+}
+
+#endif
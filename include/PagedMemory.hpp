@@ -0,0 +1,79 @@
+#ifndef FUPM2EMU_PAGEDMEMORY_HPP
+#define FUPM2EMU_PAGEDMEMORY_HPP
+
+#include <cstdint>    // Целочисленные типы фиксированной длины.
+#include <vector>     // vector.
+#include <memory>     // unique_ptr.
+
+
+namespace FUPM2EMU
+{
+    ////////////////  PagedMemory   ////////////////
+    // Разреженная память: двухуровневая таблица страниц, страницы выделяются при первой записи.
+    // Чтение из невыделенной страницы возвращает нули и страницу не выделяет, поэтому объём занятой памяти хоста
+    // пропорционален числу страниц, в которые была запись. Последняя использованная страница запоминается (аналог TLB),
+    // так что последовательные обращения к одной странице не проходят по таблице.
+    // Слова в странице хранятся так же, как в плотной памяти State::memory (старшим байтом вперёд).
+    class PagedMemory
+    {
+    public:
+        // Константы.
+        static const uint8_t page_bits  = 10;               // Число бит адреса слова внутри страницы.
+        static const size_t  page_words = 1 << page_bits;   // Размер страницы в словах.
+        static const size_t  page_bytes = page_words * 4;   // Размер страницы в байтах.
+        static const uint8_t table_bits = 10;               // Число бит индекса страницы во второй ступени таблицы.
+        static const size_t  table_size = 1 << table_bits;  // Размер таблицы второй ступени.
+
+        // Методы.
+        PagedMemory();
+        PagedMemory(uint8_t address_bits);
+        PagedMemory(const PagedMemory& other);
+        PagedMemory& operator=(const PagedMemory& other);
+        ~PagedMemory();
+
+        // Страница, содержащая слово по адресу (адрес уже приведён к адресному пространству). nullptr - страница не выделена.
+        inline const uint8_t* find(size_t address) const;
+
+        // Страница, содержащая слово по адресу, с выделением при необходимости.
+        inline uint8_t* obtain(size_t address);
+
+        // Обнуление всех выделенных страниц. Страницы не освобождаются, поэтому повторное использование экземпляра
+        // не выделяет память хоста под уже тронутые страницы.
+        void clear();
+
+        // Число выделенных страниц.
+        size_t pages_allocated() const;
+
+    protected:
+        // Страница и таблица второй ступени.
+        struct Page { uint8_t bytes[page_bytes]; };
+        struct Table { std::unique_ptr<Page> pages[table_size]; };
+
+        // Медленный путь: обход таблицы.
+        uint8_t* lookup(size_t page_index, bool allocate) const;
+
+        // Данные.
+        std::vector<std::unique_ptr<Table>> directory; // Первая ступень таблицы.
+        mutable size_t cached_index;                  // Номер последней использованной страницы.
+        mutable uint8_t* cached_page;                 // Последняя использованная страница (nullptr - нет).
+
+    private:
+
+    };
+
+
+    inline const uint8_t* PagedMemory::find(size_t address) const
+    {
+        size_t page_index = address >> page_bits;
+        if ((cached_page != nullptr) && (page_index == cached_index)) { return cached_page; }
+        return lookup(page_index, false);
+    }
+    inline uint8_t* PagedMemory::obtain(size_t address)
+    {
+        size_t page_index = address >> page_bits;
+        if ((cached_page != nullptr) && (page_index == cached_index)) { return cached_page; }
+        return lookup(page_index, true);
+    }
+}
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef FUPM2EMU_PERFCOUNTERS_HPP
+#define FUPM2EMU_PERFCOUNTERS_HPP
+
+#include <cstdint>    // Целочисленные типы фиксированной длины.
+#include <string>     // string.
+#include <iostream>   // ostream.
+
+
+namespace FUPM2EMU
+{
+    ////////////////  PerfCounters  ////////////////
+    // Счётчики производительности хоста (только Linux, perf_event_open) для участка между start() и stop().
+    // Каждый счётчик открывается отдельно: недоступные (виртуальная машина, контейнер, perf_event_paranoid) пропускаются,
+    // остальные работают. Считаются только события пользовательского режима процесса и созданных им позже потоков.
+    // При мультиплексировании значения масштабируются по доле времени, в течение которой счётчик был активен.
+    class PerfCounters
+    {
+    public:
+        // Счётчики.
+        enum class Counter
+        {
+            CYCLES,        // Такты.
+            INSTRUCTIONS,  // Выполненные команды хоста.
+            BRANCH_MISSES, // Неверно предсказанные переходы.
+            L1D_MISSES,    // Промахи чтения кэша данных первого уровня.
+            LLC_MISSES,    // Промахи кэша последнего уровня.
+            TASK_CLOCK,    // Процессорное время (нс, программный счётчик).
+            PAGE_FAULTS,   // Страничные отказы (программный счётчик).
+            COUNTERS_NUMBER,
+        };
+        static const size_t counters_number = static_cast<size_t>(Counter::COUNTERS_NUMBER);
+
+        // Методы.
+        PerfCounters();
+        ~PerfCounters();
+
+        bool hardware_available() const; // Открыт ли хотя бы один аппаратный счётчик.
+        const std::string& error() const; // Причина недоступности аппаратных счётчиков.
+
+        void start(); // Сброс и запуск счётчиков.
+        void stop();  // Останов счётчиков и чтение значений.
+
+        // Значение счётчика после stop(). false - счётчик недоступен.
+        bool value(Counter counter, uint64_t& result) const;
+
+        // Вывод значений ("[BENCHMARK]: ..."); guest_instructions != 0 - нормирование на команду машины.
+        void print(std::ostream& output_stream, uint64_t guest_instructions) const;
+
+    protected:
+        // Данные.
+        int descriptors[counters_number]; // Дескрипторы счётчиков (-1 - недоступен).
+        uint64_t values[counters_number]; // Значения после stop().
+        std::string open_error;           // Ошибка открытия первого аппаратного счётчика.
+
+    private:
+
+    };
+}
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef FUPM2EMU_SAMPLINGPROFILER_HPP
+#define FUPM2EMU_SAMPLINGPROFILER_HPP
+
+#include <cstdint>    // Целочисленные типы фиксированной длины.
+#include <iostream>   // ostream.
+
+#include <time.h>     // timer_t.
+
+#include "FUPM2EMU.hpp"
+
+
+namespace FUPM2EMU
+{
+    //////////////// SamplingProfiler ////////////////
+    // Профилировщик по выборкам (только POSIX): таймер реального времени посылает SIGPROF с заданной частотой,
+    // обработчик читает опубликованный исполнителем адрес команды из Executor::sample и увеличивает его счётчик.
+    // Таблица счётчиков имеет постоянный размер и заполняется без выделения памяти (обработчик сигнала не может вызывать malloc).
+    // Точность счёта команд не нужна, поэтому цикл интерпретатора платит только за одну запись адреса в память на команду:
+    // запись пары (код операции, адрес) обходилась около 15% времени даже при одной выборке в секунду. Код операции читается
+    // из памяти машины при выводе, поэтому для изменявшего себя кода показывается последняя записанная команда.
+    // Выборки относятся к основному ядру: пока оно ждёт дополнительные (JOIN), время приписывается этой команде.
+    // Одновременно может работать только один профилировщик.
+    class SamplingProfiler
+    {
+    public:
+        // Методы.
+        SamplingProfiler(Executor& executor, unsigned int frequency = 1000);
+        ~SamplingProfiler();
+
+        // Запуск и останов выборки. start() включает Executor::sampling, stop() выключает.
+        bool start();
+        void stop();
+
+        // Число выборок и число выборок, не поместившихся в таблицу.
+        uint64_t samples_number() const;
+        uint64_t dropped_number() const;
+
+        // Вывод гистограммы в формате folded stacks ("функция;операция@адрес число" - одна строка на адрес).
+        // Функция - ближайшая метка ассемблера не после адреса.
+        void write_folded(const State& state, const Translator& translator, std::ostream& output_stream) const;
+
+    protected:
+        // Ячейка таблицы: адрес из Executor::sample + 1 (0 - ячейка свободна) и число выборок.
+        struct Entry
+        {
+            uint64_t key;
+            uint64_t count;
+        };
+
+        // Размер таблицы (степень двойки) и длина поиска свободной ячейки.
+        static const size_t table_size = 1 << 16;
+        static const size_t max_probes = 64;
+
+        // Обработчик SIGPROF.
+        static void handle(int signal_number);
+
+        // Данные.
+        Executor& executor;     // Исполнитель, публикующий команды.
+        unsigned int frequency; // Частота выборки (Гц).
+        Entry* table;           // Таблица счётчиков.
+        timer_t timer;          // Таймер выборки.
+        bool timer_created;     // Создан ли таймер.
+        volatile uint64_t samples; // Число выборок.
+        volatile uint64_t dropped; // Выборки, для которых не нашлось ячейки.
+
+        static SamplingProfiler* volatile active; // Работающий профилировщик (используется обработчиком).
+
+    private:
+
+    };
+}
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef FUPM2EMU_H
+#define FUPM2EMU_H
+
+#include <stddef.h>   // size_t.
+#include <stdint.h>   // Целочисленные типы фиксированной длины.
+
+
+////////////////  C API libfupm2emu  ////////////////
+// Экземпляр содержит состояние машины, исполнитель и транслятор. Экземпляры независимы и могут работать в разных потоках
+// (один поток на экземпляр в каждый момент). После первого запуска экземпляр не выделяет память при выполнении, поэтому
+// экземпляры создаются один раз и используются повторно: fupm2emu_load() и fupm2emu_assemble() заменяют всё состояние машины.
+// Разреженная память при этом обнуляется без освобождения страниц: память хоста выделяется только под страницы, в которые
+// не писала ни одна из прошлых программ экземпляра.
+// Ввод-вывод машины идёт через функции обратного вызова: без функции ввода машина видит конец ввода, без функции вывода
+// её вывод отбрасывается.
+
+#if defined(_WIN32)
+    #if defined(FUPM2EMU_BUILDING_LIBRARY)
+        #define FUPM2EMU_API __declspec(dllexport)
+    #else
+        #define FUPM2EMU_API
+    #endif
+#else
+    #define FUPM2EMU_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Коды результата.
+enum
+{
+    FUPM2EMU_OK       =  0, // Успех; после выполнения - бюджет исчерпан, машина может продолжить работу.
+    FUPM2EMU_HALTED   =  1, // Машина остановилась (HALT или системный вызов EXIT).
+    FUPM2EMU_ERROR    = -1, // Ошибка машины (неверный регистр, адрес, деление на ноль...).
+    FUPM2EMU_INVALID  = -2, // Неверный аргумент.
+    FUPM2EMU_ASSEMBLE = -3, // Ошибка ассемблирования.
+    FUPM2EMU_LOAD     = -4, // Ошибка загрузки образа.
+};
+
+// Число регистров (R14 - указатель стека, R15 - номер текущей команды).
+#define FUPM2EMU_REGISTERS 16
+
+typedef struct fupm2emu fupm2emu;
+
+// Чтение не более size байт ввода машины в buffer. Возвращает число прочитанных байт (0 - конец ввода).
+typedef size_t (*fupm2emu_read_callback)(void* context, char* buffer, size_t size);
+
+// Запись size байт вывода машины. Возвращает число записанных байт (меньше size - ошибка).
+typedef size_t (*fupm2emu_write_callback)(void* context, const char* buffer, size_t size);
+
+// Создание экземпляра с плотной памятью (address_bits = 0) или разреженной памятью из 2^address_bits слов (10..32).
+// NULL - ошибка.
+FUPM2EMU_API fupm2emu* fupm2emu_create(unsigned int address_bits);
+FUPM2EMU_API void fupm2emu_destroy(fupm2emu* emulator);
+
+// Функции ввода-вывода (NULL - нет ввода / вывод отбрасывается). context передаётся обеим функциям.
+FUPM2EMU_API int fupm2emu_set_io(fupm2emu* emulator, fupm2emu_read_callback read, fupm2emu_write_callback write, void* context);
+
+// Замена состояния машины образом: исполнимым файлом или дампом регистров, флагов и памяти (форматы файлов --load).
+FUPM2EMU_API int fupm2emu_load(fupm2emu* emulator, const void* image, size_t size);
+
+// Замена состояния машины результатом ассемблирования исходного кода.
+FUPM2EMU_API int fupm2emu_assemble(fupm2emu* emulator, const char* source, size_t length);
+
+// Выполнение. budget = NULL - до останова, иначе не более *budget команд (из *budget вычитается число выполненных).
+// Перед возвратом вывод машины передаётся функции вывода.
+FUPM2EMU_API int fupm2emu_run(fupm2emu* emulator, uint64_t* budget);
+
+// Регистры и флаги.
+FUPM2EMU_API int fupm2emu_get_registers(const fupm2emu* emulator, int32_t registers[FUPM2EMU_REGISTERS], uint8_t* flags);
+FUPM2EMU_API int fupm2emu_set_register(fupm2emu* emulator, unsigned int index, int32_t value);
+
+// Память: count слов начиная с address (адреса берутся по модулю адресного пространства).
+FUPM2EMU_API int fupm2emu_read_memory(const fupm2emu* emulator, uint32_t address, uint32_t* words, size_t count);
+FUPM2EMU_API int fupm2emu_write_memory(fupm2emu* emulator, uint32_t address, const uint32_t* words, size_t count);
+
+// Число команд, выполненных экземпляром с момента создания.
+FUPM2EMU_API uint64_t fupm2emu_retired(const fupm2emu* emulator);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,159 @@
+; Та же нагрузка, что и в heap_syscalls.asm, на распределителе на ассемблере: список свободных блоков с заголовками,
+; поиск первого подходящего блока, без слияния соседних блоков.
+slots:
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+freehead:
+    word
+
+; malloc_asm: r0 - размер в словах, результат в r0 (0 - нет памяти). Портит r1-r5.
+malloc_asm:
+    addi r0 1
+    cmpi r0 2
+    jge m_search
+    lc r0 2
+m_search:
+    lc r1 64
+    load r2 64
+m_loop:
+    cmpi r2 0
+    jeq m_fail
+    loadr r3 r2 0
+    cmp r3 r0 0
+    jge m_found
+    mov r1 r2 0
+    addi r1 1
+    loadr r2 r2 1
+    jmp m_loop
+m_found:
+    mov r4 r3 0
+    sub r4 r0 0
+    cmpi r4 2
+    jl m_take
+    mov r5 r2 0
+    add r5 r0 0
+    storer r4 r5 0
+    loadr r4 r2 1
+    storer r4 r5 1
+    storer r5 r1 0
+    storer r0 r2 0
+    jmp m_return
+m_take:
+    loadr r4 r2 1
+    storer r4 r1 0
+m_return:
+    mov r0 r2 0
+    addi r0 1
+    ret 0
+m_fail:
+    lc r0 0
+    ret 0
+
+; free_asm: r0 - адрес блока. Блок добавляется в начало списка свободных. Портит r1.
+free_asm:
+    subi r0 1
+    load r1 64
+    storer r1 r0 1
+    store r0 64
+    ret 0
+
+main:
+    lc r0 2000
+    store r0 64
+    lc r1 500000
+    storer r1 r0 0
+    lc r1 0
+    storer r1 r0 1
+    lc r10 0
+loop:
+    cmpi r10 200000
+    jge done
+    mov r11 r10 0
+    andi r11 63
+    loadr r0 r11 0
+    cmpi r0 0
+    jeq noalloc
+    calli free_asm
+noalloc:
+    mov r0 r10 0
+    muli r0 7
+    andi r0 31
+    addi r0 1
+    calli malloc_asm
+    storer r0 r11 0
+    storer r10 r0 0
+    addi r10 1
+    jmp loop
+
+done:
+    load r0 63
+    loadr r0 r0 0
+    syscall r0 102
+    lc r0 10
+    syscall r0 105
+    lc r0 0
+    syscall r0 0
+
+end main
@@ -0,0 +1,101 @@
+; Нагрузка на распределитель памяти: 64 живых блока размером 1-32 слова, 200000 пар FREE/MALLOC (системные вызовы).
+slots:
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+    word
+freehead:
+    word
+
+main:
+    lc r10 0
+loop:
+    cmpi r10 200000
+    jge done
+    mov r11 r10 0
+    andi r11 63
+    loadr r0 r11 0
+    cmpi r0 0
+    jeq noalloc
+    syscall r0 131
+noalloc:
+    mov r0 r10 0
+    muli r0 7
+    andi r0 31
+    addi r0 1
+    syscall r0 130
+    storer r0 r11 0
+    storer r10 r0 0
+    addi r10 1
+    jmp loop
+
+done:
+    load r0 63
+    loadr r0 r0 0
+    syscall r0 102
+    lc r0 10
+    syscall r0 105
+    lc r0 0
+    syscall r0 0
+
+end main
@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include "AsyncWriter.hpp"
+
+namespace FUPM2EMU
+{
+    ////////////////  AsyncWriter   ////////////////
+    // PUBLIC:
+    AsyncWriter::AsyncWriter(int descriptor, size_t capacity) : descriptor(descriptor), head(0), tail(0), stopping(false), failed(false)
+    {
+        // Ёмкость округляется вверх до степени двойки: позиции приводятся к индексам маской.
+        size_t size = 1;
+        while (size < capacity) { size <<= 1; }
+        ring.resize(size);
+
+        local.resize(4096);
+        setp(local.data(), local.data() + local.size());
+
+        writer = std::thread([this]() { drain(); });
+    }
+    AsyncWriter::~AsyncWriter()
+    {
+        sync();
+        stopping.store(true, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex);
+        }
+        wake.notify_one();
+        writer.join();
+    }
+
+    // PROTECTED:
+
+    void AsyncWriter::publish()
+    {
+        const char* data = pbase();
+        size_t size = pptr() - pbase();
+        size_t mask = ring.size() - 1;
+
+        while (size != 0)
+        {
+            size_t current_tail = tail.load(std::memory_order_relaxed);
+            size_t free_space = ring.size() - (current_tail - head.load(std::memory_order_acquire));
+            if (free_space == 0)
+            {
+                // Кольцо заполнено: поток записи отстаёт от исполнителя.
+                wake.notify_one();
+                std::this_thread::yield();
+                continue;
+            }
+
+            // Копирование до конца кольца или до конца свободного места.
+            size_t offset = current_tail & mask;
+            size_t chunk = std::min(std::min(size, free_space), ring.size() - offset);
+            std::copy(data, data + chunk, ring.data() + offset);
+            tail.store(current_tail + chunk, std::memory_order_release);
+
+            data += chunk;
+            size -= chunk;
+        }
+
+        setp(local.data(), local.data() + local.size());
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex);
+        }
+        wake.notify_one();
+    }
+
+    void AsyncWriter::drain()
+    {
+        size_t mask = ring.size() - 1;
+
+        while (true)
+        {
+            size_t current_head = head.load(std::memory_order_relaxed);
+            size_t current_tail = tail.load(std::memory_order_acquire);
+
+            if (current_head == current_tail)
+            {
+                if (stopping.load(std::memory_order_acquire) && (tail.load(std::memory_order_acquire) == current_head)) { return; }
+
+                // Данных нет: ожидание сигнала (с ограничением по времени на случай пропущенного сигнала).
+                std::unique_lock<std::mutex> lock(wake_mutex);
+                wake.wait_for(lock, std::chrono::milliseconds(10), [&]()
+                {
+                    return (tail.load(std::memory_order_acquire) != current_head) || stopping.load(std::memory_order_acquire);
+                });
+                continue;
+            }
+
+            // Запись непрерывного участка кольца одним вызовом.
+            size_t offset = current_head & mask;
+            size_t chunk = std::min(current_tail - current_head, ring.size() - offset);
+            ssize_t written = write(descriptor, ring.data() + offset, chunk);
+            if (written < 0)
+            {
+                if (errno == EINTR) { continue; } // Прервано сигналом (например, профилировщика по выборкам).
+                if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+                {
+                    // Неблокирующий дескриптор: ожидание готовности к записи.
+                    struct pollfd descriptor_state;
+                    descriptor_state.fd = descriptor;
+                    descriptor_state.events = POLLOUT;
+                    descriptor_state.revents = 0;
+                    if ((poll(&descriptor_state, 1, -1) >= 0) || (errno == EINTR)) { continue; }
+                }
+
+                // Неустранимая ошибка: данные отбрасываются, чтобы не остановить исполнитель.
+                if (!failed)
+                {
+                    failed = true;
+                    std::cerr << "[ASYNC OUTPUT ERROR]: failed to write machine's output: " << std::strerror(errno) << std::endl;
+                }
+                written = static_cast<ssize_t>(chunk);
+            }
+            head.store(current_head + written, std::memory_order_release);
+        }
+    }
+
+    AsyncWriter::int_type AsyncWriter::overflow(int_type symbol)
+    {
+        publish();
+        if (!traits_type::eq_int_type(symbol, traits_type::eof()))
+        {
+            *pptr() = traits_type::to_char_type(symbol);
+            pbump(1);
+        }
+        return traits_type::not_eof(symbol);
+    }
+
+    int AsyncWriter::sync()
+    {
+        publish();
+
+        // Сброс завершён, когда поток записи дошёл до конца данных.
+        while (head.load(std::memory_order_acquire) != tail.load(std::memory_order_relaxed)) { std::this_thread::yield(); }
+        return 0;
+    }
+
+    // PRIVATE:
+}
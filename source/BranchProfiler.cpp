@@ -0,0 +1,101 @@
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <vector>
+
+#include "BranchProfiler.hpp"
+
+namespace FUPM2EMU
+{
+    //////////////// BranchProfiler ////////////////
+    // PUBLIC:
+    BranchProfiler::BranchProfiler(Executor& executor) :
+        executor(executor), history(0)
+    {
+        // Счётчики начинают со слабого "не совершён".
+        std::memset(bimodal, 1, sizeof(bimodal));
+        std::memset(gshare, 1, sizeof(gshare));
+    }
+    BranchProfiler::~BranchProfiler()
+    {
+        stop();
+    }
+
+    void BranchProfiler::start()
+    {
+        executor.branch_profiler = this;
+    }
+
+    void BranchProfiler::stop()
+    {
+        if (executor.branch_profiler == this) { executor.branch_profiler = nullptr; }
+    }
+
+    void BranchProfiler::print_summary(const State& state, std::ostream& output_stream, size_t limit) const
+    {
+        static const char* names[PREDICTORS_NUMBER] = { "Static BTFN", "2-bit counters", "gshare" };
+
+        uint64_t taken = 0, executed = 0;
+        uint64_t mispredictions[PREDICTORS_NUMBER] = {};
+        for (const auto& site : sites)
+        {
+            taken += site.second.taken;
+            executed += site.second.taken + site.second.not_taken;
+            for (size_t predictor = 0; predictor < PREDICTORS_NUMBER; ++predictor)
+            {
+                mispredictions[predictor] += site.second.mispredictions[predictor];
+            }
+        }
+
+        output_stream << std::fixed << std::setprecision(2);
+        output_stream << "[BRANCHES]: " << executed << " conditional branches at " << sites.size() << " sites";
+        if (executed != 0) { output_stream << ", " << 100.0 * taken / executed << "% taken"; }
+        output_stream << std::endl;
+        for (size_t predictor = 0; predictor < PREDICTORS_NUMBER; ++predictor)
+        {
+            output_stream << "[BRANCHES]: " << names[predictor] << ": " << mispredictions[predictor] << " mispredictions";
+            if (executed != 0) { output_stream << " (" << 100.0 * mispredictions[predictor] / executed << "%)"; }
+            output_stream << std::endl;
+        }
+
+        std::vector<std::pair<uint32_t, Site>> sorted = ranked();
+        for (size_t index = 0; (index < sorted.size()) && (index < limit); ++index)
+        {
+            const Site& site = sorted[index].second;
+            output_stream << "[BRANCHES]: " << state.symbolize(sorted[index].first) << " -> " << state.symbolize(site.target) << ": "
+                          << site.taken << " taken, " << site.not_taken << " not taken, " << site.mispredictions[GSHARE]
+                          << " gshare mispredictions" << std::endl;
+        }
+        output_stream << std::defaultfloat;
+    }
+
+    void BranchProfiler::write_report(const State& state, std::ostream& output_stream) const
+    {
+        output_stream << "# address symbol target_symbol taken not_taken static_misses two_bit_misses gshare_misses" << std::endl;
+        for (const auto& entry : ranked())
+        {
+            const Site& site = entry.second;
+            output_stream << entry.first << " " << state.symbolize(entry.first) << " " << state.symbolize(site.target) << " "
+                          << site.taken << " " << site.not_taken << " " << site.mispredictions[STATIC] << " "
+                          << site.mispredictions[BIMODAL] << " " << site.mispredictions[GSHARE] << std::endl;
+        }
+    }
+
+    // PROTECTED:
+
+    std::vector<std::pair<uint32_t, BranchProfiler::Site>> BranchProfiler::ranked() const
+    {
+        std::vector<std::pair<uint32_t, Site>> sorted(sites.begin(), sites.end());
+        std::sort(sorted.begin(), sorted.end(), [](const std::pair<uint32_t, Site>& left, const std::pair<uint32_t, Site>& right)
+        {
+            if (left.second.mispredictions[GSHARE] != right.second.mispredictions[GSHARE])
+            {
+                return left.second.mispredictions[GSHARE] > right.second.mispredictions[GSHARE];
+            }
+            return left.first < right.first;
+        });
+        return sorted;
+    }
+
+    // PRIVATE:
+}
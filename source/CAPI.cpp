@@ -0,0 +1,250 @@
+#include <streambuf>
+#include <istream>
+#include <ostream>
+#include <new>
+
+#include "FUPM2EMU.hpp"
+#include "fupm2emu.h"
+
+namespace
+{
+    ////////////////  CallbackInput  ////////////////
+    // Буфер потока ввода машины, заполняемый функцией обратного вызова.
+    class CallbackInput : public std::streambuf
+    {
+    public:
+        fupm2emu_read_callback read = nullptr; // Функция ввода (nullptr - конец ввода).
+        void* context = nullptr;               // Её контекст.
+
+        // Отбросить прочитанные, но не использованные машиной байты.
+        void discard() { setg(buffer, buffer, buffer); }
+
+    protected:
+        char buffer[4096]; // Буфер ввода (выделяется вместе с экземпляром).
+
+        int_type underflow() override
+        {
+            if (gptr() < egptr()) { return traits_type::to_int_type(*gptr()); }
+            if (read == nullptr) { return traits_type::eof(); }
+
+            size_t count = read(context, buffer, sizeof(buffer));
+            if (count == 0) { return traits_type::eof(); }
+            if (count > sizeof(buffer)) { count = sizeof(buffer); }
+            setg(buffer, buffer, buffer + count);
+            return traits_type::to_int_type(*gptr());
+        }
+    };
+
+    ////////////////  CallbackOutput ////////////////
+    // Буфер потока вывода машины, передаваемый функции обратного вызова при заполнении и flush().
+    class CallbackOutput : public std::streambuf
+    {
+    public:
+        fupm2emu_write_callback write = nullptr; // Функция вывода (nullptr - вывод отбрасывается).
+        void* context = nullptr;                 // Её контекст.
+
+        CallbackOutput() { setp(buffer, buffer + sizeof(buffer)); }
+
+    protected:
+        char buffer[4096]; // Буфер вывода (выделяется вместе с экземпляром).
+
+        // Передача накопленных байт. false - функция вывода записала не всё.
+        bool publish()
+        {
+            size_t count = static_cast<size_t>(pptr() - pbase());
+            setp(buffer, buffer + sizeof(buffer));
+            if ((count == 0) || (write == nullptr)) { return true; }
+            return write(context, buffer, count) == count;
+        }
+
+        int_type overflow(int_type symbol) override
+        {
+            if (!publish()) { return traits_type::eof(); }
+            if (!traits_type::eq_int_type(symbol, traits_type::eof()))
+            {
+                *pptr() = traits_type::to_char_type(symbol);
+                pbump(1);
+            }
+            return traits_type::not_eof(symbol);
+        }
+
+        int sync() override
+        {
+            return publish() ? 0 : -1;
+        }
+    };
+
+    ////////////////  MemoryInput   ////////////////
+    // Поток чтения из блока памяти без копирования.
+    class MemoryInput : public std::streambuf
+    {
+    public:
+        MemoryInput(const char* data, size_t size)
+        {
+            char* begin = const_cast<char*>(data);
+            setg(begin, begin, begin + size);
+        }
+    };
+}
+
+// Экземпляр C API: эмулятор и постоянные потоки ввода-вывода (создаются один раз, поэтому выполнение не выделяет память).
+struct fupm2emu
+{
+    FUPM2EMU::Emulator machine;   // Эмулятор.
+    CallbackInput input_buffer;   // Буфер ввода машины.
+    CallbackOutput output_buffer; // Буфер вывода машины.
+    std::istream input;           // Поток ввода машины.
+    std::ostream output;          // Поток вывода машины.
+
+    fupm2emu() : input(&input_buffer), output(&output_buffer) {}
+    fupm2emu(FUPM2EMU::State::Backend backend, uint8_t address_bits) :
+        machine(backend, address_bits), input(&input_buffer), output(&output_buffer) {}
+};
+
+extern "C"
+{
+    fupm2emu* fupm2emu_create(unsigned int address_bits)
+    {
+        if ((address_bits != 0) && ((address_bits < 10) || (address_bits > 32))) { return nullptr; }
+        try
+        {
+            if (address_bits == 0) { return new fupm2emu(); }
+            return new fupm2emu(FUPM2EMU::State::Backend::SPARSE, static_cast<uint8_t>(address_bits));
+        }
+        catch (...) { return nullptr; }
+    }
+
+    void fupm2emu_destroy(fupm2emu* emulator)
+    {
+        delete emulator;
+    }
+
+    int fupm2emu_set_io(fupm2emu* emulator, fupm2emu_read_callback read, fupm2emu_write_callback write, void* context)
+    {
+        if (emulator == nullptr) { return FUPM2EMU_INVALID; }
+
+        emulator->output.flush();
+        emulator->input_buffer.read = read;
+        emulator->input_buffer.context = context;
+        emulator->input_buffer.discard();
+        emulator->input.clear();
+        emulator->output_buffer.write = write;
+        emulator->output_buffer.context = context;
+        emulator->output.clear();
+        return FUPM2EMU_OK;
+    }
+
+    int fupm2emu_load(fupm2emu* emulator, const void* image, size_t size)
+    {
+        if ((emulator == nullptr) || ((image == nullptr) && (size != 0))) { return FUPM2EMU_INVALID; }
+        try
+        {
+            MemoryInput buffer(static_cast<const char*>(image), size);
+            std::istream stream(&buffer);
+            if (emulator->machine.reload(stream) != 0) { return FUPM2EMU_LOAD; }
+        }
+        catch (...) { return FUPM2EMU_LOAD; }
+
+        emulator->input_buffer.discard();
+        emulator->input.clear();
+        return FUPM2EMU_OK;
+    }
+
+    int fupm2emu_assemble(fupm2emu* emulator, const char* source, size_t length)
+    {
+        if ((emulator == nullptr) || ((source == nullptr) && (length != 0))) { return FUPM2EMU_INVALID; }
+        try
+        {
+            emulator->machine.reset();
+            MemoryInput buffer(source, length);
+            std::istream stream(&buffer);
+            if (emulator->machine.translator.assemble(stream, emulator->machine.state) != 0) { return FUPM2EMU_ASSEMBLE; }
+        }
+        catch (...) { return FUPM2EMU_ASSEMBLE; }
+
+        emulator->input_buffer.discard();
+        emulator->input.clear();
+        return FUPM2EMU_OK;
+    }
+
+    int fupm2emu_run(fupm2emu* emulator, uint64_t* budget)
+    {
+        if (emulator == nullptr) { return FUPM2EMU_INVALID; }
+
+        FUPM2EMU::Executor::ReturnCode return_code = FUPM2EMU::Executor::ReturnCode::OK;
+        try
+        {
+            if (budget != nullptr)
+            {
+                return_code = emulator->machine.run(emulator->input, emulator->output, *budget);
+            }
+            else
+            {
+                while (return_code == FUPM2EMU::Executor::ReturnCode::OK)
+                {
+                    return_code = emulator->machine.executor.run(emulator->machine.state, emulator->input, emulator->output);
+                }
+            }
+        }
+        catch (...) { return_code = FUPM2EMU::Executor::ReturnCode::ERROR; }
+        emulator->output.flush();
+
+        switch (return_code)
+        {
+            case FUPM2EMU::Executor::ReturnCode::OK:        { return FUPM2EMU_OK; }
+            case FUPM2EMU::Executor::ReturnCode::TERMINATE: { return FUPM2EMU_HALTED; }
+            default:                                        { return FUPM2EMU_ERROR; }
+        }
+    }
+
+    int fupm2emu_get_registers(const fupm2emu* emulator, int32_t registers[FUPM2EMU_REGISTERS], uint8_t* flags)
+    {
+        if (emulator == nullptr) { return FUPM2EMU_INVALID; }
+
+        const FUPM2EMU::State& state = emulator->machine.state;
+        if (registers != nullptr)
+        {
+            for (size_t index = 0; index < FUPM2EMU_REGISTERS; ++index) { registers[index] = state.registers[index]; }
+        }
+        if (flags != nullptr) { *flags = state.flags; }
+        return FUPM2EMU_OK;
+    }
+
+    int fupm2emu_set_register(fupm2emu* emulator, unsigned int index, int32_t value)
+    {
+        if ((emulator == nullptr) || (index >= FUPM2EMU_REGISTERS)) { return FUPM2EMU_INVALID; }
+
+        emulator->machine.state.registers[index] = value;
+        return FUPM2EMU_OK;
+    }
+
+    int fupm2emu_read_memory(const fupm2emu* emulator, uint32_t address, uint32_t* words, size_t count)
+    {
+        if ((emulator == nullptr) || ((words == nullptr) && (count != 0))) { return FUPM2EMU_INVALID; }
+
+        const FUPM2EMU::State& state = emulator->machine.state;
+        for (size_t index = 0; index < count; ++index)
+        {
+            words[index] = state.get_word((address + index) & state.address_mask);
+        }
+        return FUPM2EMU_OK;
+    }
+
+    int fupm2emu_write_memory(fupm2emu* emulator, uint32_t address, const uint32_t* words, size_t count)
+    {
+        if ((emulator == nullptr) || ((words == nullptr) && (count != 0))) { return FUPM2EMU_INVALID; }
+
+        FUPM2EMU::State& state = emulator->machine.state;
+        for (size_t index = 0; index < count; ++index)
+        {
+            state.set_word(words[index], (address + index) & state.address_mask);
+        }
+        return FUPM2EMU_OK;
+    }
+
+    uint64_t fupm2emu_retired(const fupm2emu* emulator)
+    {
+        if (emulator == nullptr) { return 0; }
+        return emulator->machine.executor.statistics.retired();
+    }
+}
@@ -0,0 +1,90 @@
+#include <algorithm>
+#include <iomanip>
+#include <map>
+
+#include "CacheSimulator.hpp"
+
+namespace FUPM2EMU
+{
+    //////////////// CacheSimulator ////////////////
+    // PUBLIC:
+    CacheSimulator::CacheSimulator(Executor& executor, const State& state, size_t size, size_t line, size_t ways) :
+        executor(executor), mask(state.address_mask), size(size), line(line), ways(ways), sets_number(size / (line * ways)),
+        line_shift(0), tags(size / line, 0), stamps(size / line, 0), clock(0), instruction(nullptr)
+    {
+        for (size_t words = line / State::bytes_in_word; words > 1; words >>= 1) { ++line_shift; }
+    }
+    CacheSimulator::~CacheSimulator()
+    {
+        stop();
+    }
+
+    bool CacheSimulator::valid(size_t size, size_t line, size_t ways)
+    {
+        auto power_of_two = [](size_t value) { return (value != 0) && ((value & (value - 1)) == 0); };
+        return power_of_two(size) && power_of_two(line) && power_of_two(ways) &&
+               (line >= State::bytes_in_word) && (size >= line * ways);
+    }
+
+    void CacheSimulator::start()
+    {
+        executor.cache_simulator = this;
+    }
+
+    void CacheSimulator::stop()
+    {
+        if (executor.cache_simulator == this) { executor.cache_simulator = nullptr; }
+    }
+
+    void CacheSimulator::print_summary(std::ostream& output_stream) const
+    {
+        output_stream << "[CACHE]: " << size << " bytes, " << line << "-byte lines, " << ways << " ways, "
+                      << sets_number << " sets" << std::endl;
+
+        auto print = [&output_stream](const char* name, const Counts& counts)
+        {
+            uint64_t total = counts.hits + counts.misses;
+            output_stream << "[CACHE]: " << name << ": " << total << " accesses, " << counts.misses << " misses";
+            if (total != 0) { output_stream << " (" << 100.0 * counts.misses / total << "%)"; }
+            output_stream << std::endl;
+        };
+        output_stream << std::fixed << std::setprecision(2);
+        print("Fetches", fetches);
+        print("Reads", reads);
+        print("Writes", writes);
+        output_stream << std::defaultfloat;
+    }
+
+    void CacheSimulator::write_report(const State& state, std::ostream& output_stream) const
+    {
+        std::vector<std::pair<uint32_t, Counts>> sorted(instructions.begin(), instructions.end());
+        std::sort(sorted.begin(), sorted.end(), [](const std::pair<uint32_t, Counts>& left, const std::pair<uint32_t, Counts>& right)
+        {
+            if (left.second.misses != right.second.misses) { return left.second.misses > right.second.misses; }
+            return left.first < right.first;
+        });
+
+        output_stream << std::fixed << std::setprecision(2);
+        output_stream << "# address symbol accesses misses miss_rate%" << std::endl;
+        for (const auto& entry : sorted)
+        {
+            uint64_t total = entry.second.hits + entry.second.misses;
+            output_stream << entry.first << " " << state.symbolize(entry.first) << " " << total << " " << entry.second.misses << " "
+                          << 100.0 * entry.second.misses / total << std::endl;
+        }
+        output_stream << std::defaultfloat;
+
+        // Страницы - по возрастанию адреса.
+        std::map<uint32_t, PageCounts> ordered(pages.begin(), pages.end());
+        output_stream << std::endl << "# page first_address fetches reads writes" << std::endl;
+        for (const auto& page : ordered)
+        {
+            output_stream << page.first << " " << (static_cast<uint64_t>(page.first) << page_bits) << " " << page.second.fetches
+                          << " " << page.second.reads << " " << page.second.writes << std::endl;
+        }
+    }
+
+    // PROTECTED:
+
+    // PRIVATE:
+}
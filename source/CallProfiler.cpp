@@ -0,0 +1,183 @@
+#include <algorithm>
+#include <map>
+#include <string>
+
+#include "CallProfiler.hpp"
+
+namespace FUPM2EMU
+{
+    //////////////// CallProfiler ////////////////
+    // PUBLIC:
+    CallProfiler::CallProfiler(Executor& executor, const State& state) :
+        executor(executor), current(0), last(0), calls(0), mismatches(0)
+    {
+        nodes.push_back({ static_cast<uint32_t>(state.registers[State::CIR]), 0, 0, 0, 1 });
+    }
+    CallProfiler::~CallProfiler()
+    {
+        stop();
+    }
+
+    void CallProfiler::start()
+    {
+        executor.call_profiler = this;
+    }
+
+    void CallProfiler::stop()
+    {
+        if (executor.call_profiler == this) { executor.call_profiler = nullptr; }
+    }
+
+    void CallProfiler::call(uint32_t target, uint32_t return_address, uint32_t stack, uint64_t retired)
+    {
+        attribute(retired);
+        ++calls;
+
+        // Кадры, ячейки которых оказались не ниже новой вершины стека, покинуты без RET.
+        while (!frames.empty() && (frames.back().stack <= stack))
+        {
+            pop();
+            ++mismatches;
+        }
+        frames.push_back({ current, return_address, stack });
+
+        if (nodes[current].depth < max_depth)
+        {
+            uint64_t key = (static_cast<uint64_t>(current) << 32) | target;
+            auto child = children.find(key);
+            if (child == children.end())
+            {
+                uint32_t index = static_cast<uint32_t>(nodes.size());
+                nodes.push_back({ target, current, nodes[current].depth + 1, 0, 0 });
+                child = children.emplace(key, index).first;
+            }
+            current = child->second;
+        }
+        ++nodes[current].calls;
+    }
+
+    void CallProfiler::ret(uint32_t return_address, uint32_t stack, uint64_t retired)
+    {
+        attribute(retired);
+
+        while (!frames.empty() && (frames.back().stack < stack))
+        {
+            pop();
+            ++mismatches;
+        }
+
+        // RET без своего CALL (переход через стек) не меняет теневой стек. Изменённый адрес возврата - тоже несоответствие,
+        // но кадр при этом покидается.
+        if (frames.empty() || (frames.back().stack != stack))
+        {
+            ++mismatches;
+            return;
+        }
+        if (frames.back().return_address != return_address) { ++mismatches; }
+        pop();
+    }
+
+    void CallProfiler::pause(uint64_t retired)
+    {
+        attribute(retired);
+        last = 0;
+    }
+
+    uint64_t CallProfiler::calls_number() const
+    {
+        return calls;
+    }
+
+    uint64_t CallProfiler::mismatches_number() const
+    {
+        return mismatches;
+    }
+
+    void CallProfiler::write_folded(const State& state, std::ostream& output_stream) const
+    {
+        // Имена вершин вычисляются в порядке создания: родитель всегда создан раньше потомка.
+        std::vector<std::string> paths(nodes.size());
+        for (size_t index = 0; index < nodes.size(); ++index)
+        {
+            const Node& node = nodes[index];
+            std::string name = state.symbolize(node.function);
+            paths[index] = (index == 0) ? name : paths[node.parent] + ";" + name;
+        }
+
+        // Разные вершины могут дать одинаковый путь (вызов по адресу без метки), поэтому строки объединяются.
+        std::map<std::string, uint64_t> lines;
+        for (size_t index = 0; index < nodes.size(); ++index)
+        {
+            if (nodes[index].exclusive != 0) { lines[paths[index]] += nodes[index].exclusive; }
+        }
+        for (const auto& line : lines)
+        {
+            output_stream << line.first << " " << line.second << std::endl;
+        }
+    }
+
+    void CallProfiler::print_summary(const State& state, std::ostream& output_stream, size_t limit) const
+    {
+        // Включительное число команд вершины - сумма исключительных по её поддереву (потомки создаются позже родителей).
+        std::vector<uint64_t> inclusive(nodes.size());
+        for (size_t index = nodes.size(); index-- > 0;)
+        {
+            inclusive[index] += nodes[index].exclusive;
+            if (index != 0) { inclusive[nodes[index].parent] += inclusive[index]; }
+        }
+
+        struct Function
+        {
+            uint64_t inclusive = 0;
+            uint64_t exclusive = 0;
+            uint64_t calls = 0;
+        };
+        std::map<uint32_t, Function> functions;
+        for (size_t index = 0; index < nodes.size(); ++index)
+        {
+            const Node& node = nodes[index];
+            Function& function = functions[node.function];
+            function.exclusive += node.exclusive;
+            function.calls += node.calls;
+
+            // Рекурсивные вызовы уже учтены во включительном числе внешнего вызова той же функции.
+            bool recursive = false;
+            for (size_t ancestor = index; ancestor != 0;)
+            {
+                ancestor = nodes[ancestor].parent;
+                if (nodes[ancestor].function == node.function) { recursive = true; break; }
+            }
+            if (!recursive) { function.inclusive += inclusive[index]; }
+        }
+
+        std::vector<std::pair<uint32_t, Function>> sorted(functions.begin(), functions.end());
+        std::sort(sorted.begin(), sorted.end(), [](const std::pair<uint32_t, Function>& left, const std::pair<uint32_t, Function>& right)
+        {
+            return left.second.inclusive > right.second.inclusive;
+        });
+
+        output_stream << "[CALLGRAPH]: " << calls << " calls, " << mismatches << " stack mismatches" << std::endl;
+        for (size_t index = 0; (index < sorted.size()) && (index < limit); ++index)
+        {
+            const Function& function = sorted[index].second;
+            output_stream << "[CALLGRAPH]: " << state.symbolize(sorted[index].first) << ": " << function.inclusive << " inclusive, "
+                          << function.exclusive << " exclusive, " << function.calls << " calls" << std::endl;
+        }
+    }
+
+    // PROTECTED:
+
+    void CallProfiler::attribute(uint64_t retired)
+    {
+        nodes[current].exclusive += retired - last;
+        last = retired;
+    }
+
+    void CallProfiler::pop()
+    {
+        current = frames.back().caller;
+        frames.pop_back();
+    }
+
+    // PRIVATE:
+}
@@ -0,0 +1,423 @@
+#include <sstream>
+
+#include "Compiler.hpp"
+
+namespace FUPM2EMU
+{
+    ////////////////    Compiler    ////////////////
+    // PUBLIC:
+    Compiler::Compiler()
+    {
+        // ...
+    }
+    Compiler::~Compiler()
+    {
+        // ...
+    }
+
+    int Compiler::compile(const State& state, std::ostream& output_stream) const
+    {
+        // Сгенерированный код хранит память массивом memory_size слов.
+        if (state.backend != State::Backend::DENSE)
+        {
+            std::cerr << "[COMPILER ERROR]: sparse memory can not be compiled." << std::endl;
+            throw Exception::COMPILING;
+        }
+
+        std::vector<Range> ranges = find_ranges(state);
+
+        // Системные вызовы ядер, файлов и динамической памяти не транслируются: без них программа вывела бы не то же,
+        // что эмулятор, поэтому компиляция прерывается до записи результата.
+        for (const Range& range : ranges)
+        {
+            for (size_t address = range.begin; address < range.end; ++address)
+            {
+                uint32_t command = state.get_word(address);
+                if (((command >> 24) & 0xFF) != SYSCALL) { continue; }
+
+                uint32_t code = command & 0xFFFFF;
+                if (((code >= 110) && (code <= 113)) || ((code >= 120) && (code <= 125)) || ((code >= 130) && (code <= 132)))
+                {
+                    std::cerr << "[COMPILER ERROR]: system call " << code << " at address " << address << " can not be compiled." << std::endl;
+                    throw Exception::COMPILING;
+                }
+            }
+        }
+
+        // Начальные операнды сравнения, эквивалентные регистру флагов (см. Executor::LazyFlags).
+        bool equality = state.flags & State::FlagsBits::EQUALITY;
+        bool majority = state.flags & State::FlagsBits::MAJORITY;
+        int32_t left  = (equality || majority) ? 0 : 1;
+        int32_t right = (!equality && majority) ? 1 : 0;
+
+        // Пролог: заголовки, память и вспомогательные функции.
+        output_stream <<
+R"(// FUPM2 machine state translated to C++ by FUPM2EMU.
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+static const uint32_t memory_size = )" << State::memory_size << R"(u;
+static uint32_t memory[memory_size]; // Memory as native words (addressing modulo memory size).
+
+[[maybe_unused]] static inline uint32_t& word(uint32_t address) { return memory[address % memory_size]; }
+
+[[maybe_unused]] static inline double get_double(int32_t low, int32_t high)
+{
+    int32_t pair[2] = { low, high };
+    double value;
+    std::memcpy(&value, pair, sizeof(value));
+    return value;
+}
+
+[[maybe_unused]] static inline void set_double(int32_t& low, int32_t& high, double value)
+{
+    int32_t pair[2];
+    std::memcpy(pair, &value, sizeof(value));
+    low = pair[0];
+    high = pair[1];
+}
+
+[[maybe_unused]] static inline void compare_double(int32_t& left, int32_t& right, double a, double b)
+{
+    left = ((a < b) || (a == b)) ? 0 : 1;
+    right = (a < b) ? 1 : 0;
+}
+
+[[maybe_unused]] static int fault(const char* message, bool machine)
+{
+    std::cerr << "[EXECUTION ERROR]: " << message << std::endl;
+    if (machine) { std::cerr << "[EMULATOR ERROR]: emulated machine has thrown an exception." << std::endl; }
+    else { std::cerr << "[EMULATOR ERROR]: machine state has become invalid." << std::endl; }
+    std::cerr << "FUPM2EMU has encountered a critical error. Shutting down." << std::endl;
+    return 0;
+}
+)";
+
+        // Образ памяти: только заполненные участки.
+        for (size_t index = 0; index < ranges.size(); ++index)
+        {
+            output_stream << std::endl << "static const uint32_t image_" << index << "[] =" << std::endl << "{";
+            for (size_t address = ranges[index].begin; address < ranges[index].end; ++address)
+            {
+                if ((address - ranges[index].begin) % 8 == 0) { output_stream << std::endl << "    "; }
+                output_stream << state.get_word(address) << "u, ";
+            }
+            output_stream << std::endl << "};" << std::endl;
+        }
+
+        // Точка входа: загрузка образа и начального состояния.
+        output_stream << std::endl << "int main()" << std::endl << "{" << std::endl;
+        for (size_t index = 0; index < ranges.size(); ++index)
+        {
+            output_stream << "    std::memcpy(memory + " << ranges[index].begin << ", image_" << index << ", sizeof(image_" << index << "));" << std::endl;
+        }
+        output_stream << std::endl;
+        for (uint8_t code = 0; code < State::CIR; ++code)
+        {
+            output_stream << "    [[maybe_unused]] int32_t " << reg(code) << " = " << state.registers[code] << ";" << std::endl;
+        }
+        output_stream << "    [[maybe_unused]] int32_t left = " << left << ", right = " << right << "; // Operands of the last comparison." << std::endl
+                      << "    uint32_t target = " << static_cast<uint32_t>(state.registers[State::CIR]) << "u; // Computed jump target." << std::endl
+                      << std::endl;
+
+        // Диспетчер переходов по вычисляемым адресам.
+        output_stream << "dispatch:" << std::endl
+                      << "    switch (target % memory_size)" << std::endl
+                      << "    {" << std::endl;
+        for (size_t index = 0; index < ranges.size(); ++index)
+        {
+            for (size_t address = ranges[index].begin; address < ranges[index].end; ++address)
+            {
+                output_stream << "        case " << address << ": goto L_" << address << ";" << std::endl;
+            }
+        }
+        output_stream << "        default:" << std::endl
+                      << "        {" << std::endl
+                      << "            if (!memory[target % memory_size]) { return 0; } // HALT." << std::endl
+                      << "            std::cerr << \"[COMPILED PROGRAM ERROR]: jump to code that was not translated: \" << target % memory_size << std::endl;" << std::endl
+                      << "            return 1;" << std::endl
+                      << "        }" << std::endl
+                      << "    }" << std::endl;
+
+        // Команды.
+        for (size_t index = 0; index < ranges.size(); ++index)
+        {
+            for (size_t address = ranges[index].begin; address < ranges[index].end; ++address)
+            {
+                output_stream << std::endl << "L_" << address << ":" << std::endl;
+                compile_command(state.get_word(address), address, ranges, output_stream);
+            }
+
+            // Выход за конец участка.
+            output_stream << "    " << jump(ranges[index].end, ranges) << std::endl;
+        }
+
+        output_stream << "}" << std::endl;
+        return 0;
+    }
+
+    // PROTECTED:
+
+    std::vector<Compiler::Range> Compiler::find_ranges(const State& state) const
+    {
+        std::vector<Range> ranges;
+        size_t address = 0;
+
+        while (address < State::memory_size)
+        {
+            // Пропуск нулевых слов.
+            while ((address < State::memory_size) && !state.get_word(address)) { ++address; }
+            if (address >= State::memory_size) { break; }
+
+            // Участок продолжается, пока нулевых слов подряд не больше max_gap.
+            Range range = { address, address + 1 };
+            size_t gap = 0;
+            for (++address; (address < State::memory_size) && (gap <= max_gap); ++address)
+            {
+                if (state.get_word(address)) { range.end = address + 1; gap = 0; }
+                else { ++gap; }
+            }
+            address = range.end;
+
+            ranges.push_back(range);
+        }
+
+        return ranges;
+    }
+
+    void Compiler::compile_command(uint32_t command, size_t address, const std::vector<Range>& ranges, std::ostream& output_stream) const
+    {
+        // Разбор команды так же, как в Executor.
+        OPERATION_CODE operation = static_cast<OPERATION_CODE>((command >> 24) & 0xFF);
+        uint8_t R1 = (command >> 20) & 0xF;
+        uint8_t R2 = (command >> 16) & 0xF;
+        int32_t imm16 = command & 0x0FFFF;
+        int32_t imm20 = command & 0xFFFFF;
+
+        const std::string r1  = reg(R1);
+        const std::string r2  = reg(R2);
+        const std::string r1n = reg((R1 + 1) % State::registers_number); // Вторые регистры пар (проверка выхода за пределы - ниже).
+        const std::string r2n = reg((R2 + 1) % State::registers_number);
+        const std::string SR  = reg(State::SR);
+
+        const std::string invalid_register = "return fault(\"access to an invalid register.\", false);";
+        const std::string division_by_zero = "return fault(\"division by zero.\", true);";
+        const std::string register_overflow = "return fault(\"register overflow.\", true);";
+
+        bool pair_r1 = false;  // Команда использует пару R1, R1 + 1.
+        bool pair_r2 = false;  // Команда использует пару R2, R2 + 1.
+        bool writes_r1 = false; // Команда записывает R1 (и R1 + 1 для пар).
+        std::ostringstream body;
+
+        switch (operation)
+        {
+            // СИСТЕМНОЕ.
+            case HALT: { body << "return 0;"; break; }
+            case SYSCALL:
+            {
+                switch (imm20)
+                {
+                    case 0:   { body << "return 0;"; break; }
+                    case 100: { body << "std::cin >> " << r1 << ";"; writes_r1 = true; break; }
+                    case 101:
+                    {
+                        pair_r1 = true; writes_r1 = true;
+                        body << "double input = 0.0; std::cin >> input; set_double(" << r1 << ", " << r1n << ", input);";
+                        break;
+                    }
+                    case 102: { body << "std::cout << " << r1 << ";"; break; }
+                    case 103: { pair_r1 = true; body << "std::cout << get_double(" << r1 << ", " << r1n << ");"; break; }
+                    case 105: { body << "std::cout.put(static_cast<uint8_t>(" << r1 << "));"; break; }
+                    case 106: { body << r1 << " = static_cast<int32_t>(getchar());"; writes_r1 = true; break; }
+                    // Неспецифицированный код - исполнитель останавливается без сообщения (непереводимые коды отсеяны в compile()).
+                    default:  { body << "return 0;"; break; }
+                }
+                break;
+            }
+
+            // ЦЕЛОЧИСЛЕННАЯ АРИФМЕТИКА.
+            case ADD:  { body << r1 << " += " << r2 << " + " << imm16 << ";"; writes_r1 = true; break; }
+            case ADDI: { body << r1 << " += " << imm20 << ";"; writes_r1 = true; break; }
+            case SUB:  { body << r1 << " -= " << r2 << " + " << imm16 << ";"; writes_r1 = true; break; }
+            case SUBI: { body << r1 << " -= " << imm20 << ";"; writes_r1 = true; break; }
+            case MUL:
+            case MULI:
+            {
+                pair_r1 = true; writes_r1 = true;
+                body << "int64_t product = static_cast<int64_t>(" << r1 << ") * static_cast<int64_t>("
+                     << ((operation == MUL) ? (r2 + " + " + std::to_string(imm16)) : std::to_string(imm20)) << "); "
+                     << r1 << " = static_cast<int32_t>(product & UINT32_MAX); "
+                     << r1n << " = static_cast<int32_t>((product >> 32) & UINT32_MAX);";
+                break;
+            }
+            case DIV:
+            case DIVI:
+            {
+                pair_r1 = true; writes_r1 = true;
+                std::string divider = (operation == DIV) ? r2 : std::to_string(imm20);
+                body << "if (!" << divider << ") { " << division_by_zero << " } "
+                     << "int64_t divident = static_cast<int64_t>(" << r1 << " | (static_cast<int64_t>(" << r1n << ") << 32)); "
+                     << "int64_t divider = static_cast<int64_t>(" << divider << "); "
+                     << "int64_t product = divident / divider; "
+                     << "if (product > UINT32_MAX) { " << division_by_zero << " } "
+                     << "int64_t remainder = divident % divider; "
+                     << r1 << " = static_cast<int32_t>(product & UINT32_MAX); "
+                     << r1n << " = static_cast<int32_t>(remainder & UINT32_MAX);";
+                break;
+            }
+
+            // КОПИРОВАНИЕ В РЕГИСТРЫ.
+            case LC:  { body << r1 << " = " << imm20 << ";"; writes_r1 = true; break; }
+            case MOV: { body << r1 << " = " << r2 << " + " << imm16 << ";"; writes_r1 = true; break; }
+
+            // СДВИГИ И ЛОГИЧЕСКИЕ ОПЕРАЦИИ.
+            case SHL:  { body << r1 << " <<= " << r2 << " + " << imm16 << ";"; writes_r1 = true; break; }
+            case SHLI: { body << r1 << " <<= " << imm20 << ";"; writes_r1 = true; break; }
+            case SHR:  { body << r1 << " >>= " << r2 << " + " << imm16 << ";"; writes_r1 = true; break; }
+            case SHRI: { body << r1 << " >>= " << imm20 << ";"; writes_r1 = true; break; }
+            case AND:  { body << r1 << " &= " << r2 << " + " << imm16 << ";"; writes_r1 = true; break; }
+            case ANDI: { body << r1 << " &= " << imm20 << ";"; writes_r1 = true; break; }
+            case OR:   { body << r1 << " |= " << r2 << " + " << imm16 << ";"; writes_r1 = true; break; }
+            case ORI:  { body << r1 << " |= " << imm20 << ";"; writes_r1 = true; break; }
+            case XOR:  { body << r1 << " ^= " << r2 << " + " << imm16 << ";"; writes_r1 = true; break; }
+            case XORI: { body << r1 << " ^= " << imm20 << ";"; writes_r1 = true; break; }
+            case NOT:  { body << r1 << " = ~(" << r1 << ");"; writes_r1 = true; break; }
+
+            // ВЕЩЕСТВЕННАЯ АРИФМЕТИКА.
+            case ADDD:
+            case SUBD:
+            case MULD:
+            case DIVD:
+            {
+                pair_r1 = true; pair_r2 = true; writes_r1 = true;
+                const char* sign = (operation == ADDD) ? " + " : (operation == SUBD) ? " - " : (operation == MULD) ? " * " : " / ";
+                body << "set_double(" << r1 << ", " << r1n << ", get_double(" << r1 << ", " << r1n << ")" << sign
+                     << "get_double(" << r2 << ", " << r2n << "));";
+                break;
+            }
+            case ITOD:
+            {
+                pair_r1 = true; writes_r1 = true;
+                body << "set_double(" << r1 << ", " << r1n << ", static_cast<double>(" << r2 << "));";
+                break;
+            }
+            case DTOI:
+            {
+                pair_r2 = true; writes_r1 = true;
+                body << "double value = get_double(" << r2 << ", " << r2n << "); "
+                     << "if ((value > static_cast<double>(INT32_MAX)) || (value < static_cast<double>(-INT32_MAX))) { " << register_overflow << " } "
+                     << r1 << " = static_cast<int32_t>(value);";
+                break;
+            }
+
+            // СРАВНЕНИЕ.
+            case CMP:  { body << "left = " << r1 << "; right = " << r2 << ";"; break; }
+            case CMPI: { body << "left = " << r1 << "; right = " << imm20 << ";"; break; }
+            case CMPD:
+            {
+                pair_r1 = true; pair_r2 = true;
+                body << "compare_double(left, right, get_double(" << r1 << ", " << r1n << "), get_double(" << r2 << ", " << r2n << "));";
+                break;
+            }
+
+            // СТЕК.
+            case PUSH: { body << "--" << SR << "; word(" << SR << ") = " << r1 << " + " << imm20 << ";"; break; }
+            case POP:  { body << r1 << " = word(" << SR << ") + " << imm20 << "; ++" << SR << ";"; writes_r1 = true; break; }
+
+            // ФУНКЦИИ.
+            case CALL:
+            {
+                body << "--" << SR << "; word(" << SR << ") = " << address + 1 << "u; "
+                     << "target = " << r1 << " + " << imm20 << "; goto dispatch;";
+                break;
+            }
+            case CALLI:
+            {
+                body << "--" << SR << "; word(" << SR << ") = " << address + 1 << "u; " << jump(imm20, ranges);
+                break;
+            }
+            case RET:
+            {
+                body << "target = word(" << SR << "); ++" << SR << "; " << SR << " += " << imm20 << "; goto dispatch;";
+                break;
+            }
+
+            // ПЕРЕХОДЫ.
+            case JMP: { body << jump(imm20, ranges); break; }
+            case JNE: { body << "if (left != right) " << jump(imm20, ranges); break; }
+            case JEQ: { body << "if (left == right) " << jump(imm20, ranges); break; }
+            case JLE: { body << "if (left <= right) " << jump(imm20, ranges); break; }
+            case JL:  { body << "if (left < right) "  << jump(imm20, ranges); break; }
+            case JGE: { body << "if (left >= right) " << jump(imm20, ranges); break; }
+            case JG:  { body << "if (left > right) "  << jump(imm20, ranges); break; }
+
+            // РАБОТА С ПАМЯТЬЮ.
+            case LOAD:   { body << r1 << " = word(" << imm20 << "u);"; writes_r1 = true; break; }
+            case STORE:  { body << "word(" << imm20 << "u) = " << r1 << ";"; break; }
+            case LOAD2:
+            {
+                pair_r1 = true; writes_r1 = true;
+                body << r1 << " = word(" << imm20 << "u); " << r1n << " = word(" << imm20 + 1 << "u);";
+                break;
+            }
+            case STORE2:
+            {
+                pair_r1 = true;
+                body << "word(" << imm20 << "u) = " << r1 << "; word(" << imm20 + 1 << "u) = " << r1n << ";";
+                break;
+            }
+            case LOADR:  { body << r1 << " = word(" << r2 << " + " << imm16 << ");"; writes_r1 = true; break; }
+            case STORER: { body << "word(" << r2 << " + " << imm16 << ") = " << r1 << ";"; break; }
+            case LOADR2:
+            {
+                pair_r1 = true; writes_r1 = true;
+                body << r1 << " = word(" << r2 << " + " << imm16 << "); " << r1n << " = word(" << r2 << " + " << imm16 + 1 << ");";
+                break;
+            }
+            case STORER2:
+            {
+                pair_r1 = true;
+                body << "word(" << r2 << " + " << imm16 << ") = " << r1 << "; word(" << r2 << " + " << imm16 + 1 << ") = " << r1n << ";";
+                break;
+            }
+
+            // Неизвестный код операции - исполнитель останавливается без сообщения (ReturnCode::ERROR), так же и здесь.
+            default: { body << "return 0;"; break; }
+        }
+
+        // Выход за пределы существующих регистров известен заранее.
+        if ((pair_r1 && (R1 + 1 >= State::registers_number)) || (pair_r2 && (R2 + 1 >= State::registers_number)))
+        {
+            output_stream << "    " << invalid_register << std::endl;
+            return;
+        }
+
+        // R15 читается как адрес текущей команды, а его запись - переход.
+        bool uses_cir = (R1 == State::CIR) || (R2 == State::CIR) || (pair_r1 && (R1 + 1 == State::CIR)) || (pair_r2 && (R2 + 1 == State::CIR));
+        bool writes_cir = writes_r1 && ((R1 == State::CIR) || (pair_r1 && (R1 + 1 == State::CIR)));
+
+        output_stream << "    { ";
+        if (uses_cir) { output_stream << "[[maybe_unused]] int32_t " << reg(State::CIR) << " = " << address << "; "; }
+        output_stream << body.str();
+        if (writes_cir) { output_stream << " target = " << reg(State::CIR) << " + 1; goto dispatch;"; }
+        output_stream << " }" << std::endl;
+    }
+
+    std::string Compiler::jump(size_t target, const std::vector<Range>& ranges)
+    {
+        for (size_t index = 0; index < ranges.size(); ++index)
+        {
+            if ((target >= ranges[index].begin) && (target < ranges[index].end)) { return "goto L_" + std::to_string(target) + ";"; }
+        }
+        return "{ target = " + std::to_string(target) + "u; goto dispatch; }";
+    }
+
+    std::string Compiler::reg(uint8_t code)
+    {
+        return "r" + std::to_string(code);
+    }
+
+    // PRIVATE:
+}
@@ -0,0 +1,507 @@
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "Debugger.hpp"
+
+namespace FUPM2EMU
+{
+    ////////////////    Debugger    ////////////////
+    Debugger* volatile Debugger::active = nullptr;
+
+    // PUBLIC:
+    Debugger::Debugger(Emulator& emulator) :
+        emulator(emulator), page_size(static_cast<size_t>(sysconf(_SC_PAGESIZE))), memory_begin(nullptr), memory_end(nullptr),
+        armed(0), faulted(0), alive(true)
+    {
+        std::memset(&previous, 0, sizeof(previous));
+        emulator.executor.debugging = true;
+        if (active != nullptr) { return; }
+        active = this;
+
+        struct sigaction action;
+        std::memset(&action, 0, sizeof(action));
+        action.sa_sigaction = &Debugger::handle;
+        action.sa_flags = SA_SIGINFO | SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGSEGV, &action, &previous);
+    }
+    Debugger::~Debugger()
+    {
+        disarm();
+        for (const auto& breakpoint : breakpoints) { emulator.state.set_word(breakpoint.second, breakpoint.first); }
+        breakpoints.clear();
+        emulator.executor.interrupt.store(false); // Неисполненный запрос остановки не должен остановить обычное выполнение.
+        emulator.executor.debugging = false;      // Оставшаяся в памяти команда TRAP снова считается неизвестной.
+
+        if (active == this)
+        {
+            sigaction(SIGSEGV, &previous, nullptr);
+            active = nullptr;
+        }
+    }
+
+    int Debugger::interact(std::istream& command_stream, std::ostream& console_stream, std::istream& input_stream, std::ostream& output_stream)
+    {
+        State& state = emulator.state;
+
+        console_stream << "[DEBUGGER]: Stopped before the first instruction. Type \"help\" for the list of commands." << std::endl;
+        print_disassembly(static_cast<uint32_t>(state.registers[State::CIR]) & state.address_mask, 1, console_stream);
+
+        std::string line;
+        while (std::getline(command_stream, line))
+        {
+            std::istringstream arguments(line);
+            std::string command;
+            if (!(arguments >> command)) { continue; }
+
+            // Аргументы команды: адрес (число или метка) и число.
+            std::string where;
+            uint32_t address = static_cast<uint32_t>(state.registers[State::CIR]) & state.address_mask;
+            bool has_address = false;
+            if (arguments >> where)
+            {
+                if (!parse_address(where, address))
+                {
+                    console_stream << "[DEBUGGER]: Unknown address \"" << where << "\"." << std::endl;
+                    continue;
+                }
+                has_address = true;
+            }
+            uint64_t count = 0;
+            arguments >> count;
+
+            if ((command == "quit") || (command == "q")) { break; }
+            else if ((command == "help") || (command == "h"))
+            {
+                console_stream << "[DEBUGGER]: Commands:\n"
+                               << "    break, b <address>            Set a breakpoint (address is a number or a label).\n"
+                               << "    delete <address>              Remove a breakpoint.\n"
+                               << "    watch, w <address>            Stop when the word at the address changes.\n"
+                               << "    unwatch <address>             Remove a watchpoint.\n"
+                               << "    continue, c                   Run until a breakpoint, a watchpoint or halt.\n"
+                               << "    step, s [n]                   Execute n instructions (1 by default).\n"
+                               << "    registers, r                  Print registers and flags.\n"
+                               << "    memory, x <address> [n]       Print n words of memory (8 by default).\n"
+                               << "    disassemble, d [address] [n]  Disassemble n words (around the current instruction by default).\n"
+                               << "    info, i                       List breakpoints and watchpoints.\n"
+                               << "    quit, q                       Leave the debugger." << std::endl;
+            }
+            else if ((command == "break") || (command == "b") || (command == "delete") || (command == "watch") || (command == "w") || (command == "unwatch"))
+            {
+                if (!has_address)
+                {
+                    console_stream << "[DEBUGGER]: \"" << command << "\" expects an address." << std::endl;
+                    continue;
+                }
+
+                bool done = false;
+                const char* what = "";
+                if ((command == "break") || (command == "b")) { done = set_breakpoint(address); what = "Breakpoint set at "; }
+                else if (command == "delete") { done = remove_breakpoint(address); what = "Breakpoint removed at "; }
+                else if ((command == "watch") || (command == "w")) { done = set_watchpoint(address); what = "Watchpoint set at "; }
+                else { done = remove_watchpoint(address); what = "Watchpoint removed at "; }
+
+                if (done) { console_stream << "[DEBUGGER]: " << what << address << " (" << state.symbolize(address) << ")." << std::endl; }
+                else if ((command == "watch") || (command == "w"))
+                {
+                    console_stream << "[DEBUGGER]: Cannot watch " << address << ": already watched or sparse memory." << std::endl;
+                }
+                else { console_stream << "[DEBUGGER]: Nothing changed at " << address << "." << std::endl; }
+            }
+            else if ((command == "continue") || (command == "c") || (command == "step") || (command == "s"))
+            {
+                if (!alive)
+                {
+                    console_stream << "[DEBUGGER]: The machine has stopped; only inspection is possible." << std::endl;
+                    continue;
+                }
+
+                // step принимает число без адреса.
+                uint64_t steps = 0;
+                if ((command == "step") || (command == "s"))
+                {
+                    steps = has_address ? std::strtoull(where.c_str(), nullptr, 0) : 1;
+                    if (steps == 0) { steps = 1; }
+                }
+
+                Stop stop = resume(input_stream, output_stream, steps);
+                output_stream.flush();
+                print_stop(stop, console_stream);
+            }
+            else if ((command == "registers") || (command == "r")) { print_registers(console_stream); }
+            else if ((command == "memory") || (command == "x"))
+            {
+                print_memory(address, (count != 0) ? count : 8, console_stream);
+            }
+            else if ((command == "disassemble") || (command == "d"))
+            {
+                if (has_address) { print_disassembly(address, (count != 0) ? count : 10, console_stream); }
+                else
+                {
+                    // Окрестность текущей команды.
+                    uint32_t first = (address >= 4) ? address - 4 : 0;
+                    print_disassembly(first, address - first + 6, console_stream);
+                }
+            }
+            else if ((command == "info") || (command == "i")) { print_points(console_stream); }
+            else { console_stream << "[DEBUGGER]: Unknown command \"" << command << "\". Type \"help\" for the list of commands." << std::endl; }
+        }
+
+        output_stream.flush();
+        return 0;
+    }
+
+    Debugger::Stop Debugger::resume(std::istream& input_stream, std::ostream& output_stream, uint64_t steps)
+    {
+        State& state = emulator.state;
+        Executor& executor = emulator.executor;
+
+        changes.clear();
+        if (!alive) { return Stop::HALT; }
+
+        Executor::ReturnCode return_code = Executor::ReturnCode::OK;
+        uint64_t budget = steps;
+        try
+        {
+            while (true)
+            {
+                // Команда под точкой останова выполняется с исходным словом.
+                uint32_t current = static_cast<uint32_t>(state.registers[State::CIR]) & state.address_mask;
+                auto breakpoint = breakpoints.find(current);
+                if (breakpoint != breakpoints.end())
+                {
+                    uint64_t one = 1;
+                    state.set_word(breakpoint->second, current);
+                    arm();
+                    return_code = executor.run(state, input_stream, output_stream, one);
+                    disarm();
+                    if (state.get_word(current) == breakpoint->second) { state.set_word(trap_word, current); }
+                    else { breakpoint->second = state.get_word(current); state.set_word(trap_word, current); } // Команда изменила сама себя.
+                    if (steps != 0) { --budget; }
+                }
+
+                // Выполнение до остановки.
+                if ((return_code == Executor::ReturnCode::OK) && ((steps == 0) || (budget != 0)) && !faulted && !stop_requested.load())
+                {
+                    arm();
+                    if (steps == 0)
+                    {
+                        do { return_code = executor.run(state, input_stream, output_stream); }
+                        while ((return_code == Executor::ReturnCode::OK) && !faulted);
+                    }
+                    else
+                    {
+                        do { return_code = executor.run(state, input_stream, output_stream, budget); }
+                        while ((return_code == Executor::ReturnCode::OK) && (budget != 0) && !faulted);
+                    }
+                    disarm();
+                }
+
+                // Запись в защищённую страницу: остановка, если изменилось наблюдаемое слово, иначе - продолжение.
+                if (faulted)
+                {
+                    faulted = 0;
+                    if (!stop_requested.load()) { executor.interrupt.store(false); }
+                    collect_changes();
+                    if (!changes.empty())
+                    {
+                        if (return_code == Executor::ReturnCode::BREAK) { return_code = Executor::ReturnCode::OK; }
+                        break;
+                    }
+                    if ((return_code == Executor::ReturnCode::BREAK) && !stop_requested.load()) { return_code = Executor::ReturnCode::OK; }
+                    if ((return_code == Executor::ReturnCode::OK) && ((steps == 0) || (budget != 0))) { continue; }
+                }
+                break;
+            }
+        }
+        catch (Executor::Exception exception)
+        {
+            disarm();
+            output_stream.flush();
+            alive = false;
+            return Stop::ERROR;
+        }
+        collect_changes();
+
+        switch (return_code)
+        {
+            case Executor::ReturnCode::OK:
+            {
+                if (!changes.empty()) { return Stop::WATCHPOINT; }
+                if (stop_requested.exchange(false)) { executor.interrupt.store(false); return Stop::INTERRUPT; }
+                return Stop::STEP;
+            }
+            case Executor::ReturnCode::BREAK:
+            {
+                // BREAK - либо команда TRAP, либо запрос остановки на переходе назад.
+                uint32_t current = static_cast<uint32_t>(state.registers[State::CIR]) & state.address_mask;
+                if (stop_requested.exchange(false))
+                {
+                    executor.interrupt.store(false);
+                    if (!breakpoints.count(current)) { return Stop::INTERRUPT; }
+                }
+                return Stop::BREAKPOINT;
+            }
+            case Executor::ReturnCode::TERMINATE:
+            {
+                alive = false;
+                return Stop::HALT;
+            }
+            default:
+            {
+                alive = false;
+                return Stop::ERROR;
+            }
+        }
+    }
+
+    void Debugger::request_stop()
+    {
+        stop_requested.store(true);
+        emulator.executor.interrupt.store(true);
+    }
+
+    bool Debugger::set_breakpoint(uint32_t address)
+    {
+        State& state = emulator.state;
+        address &= state.address_mask;
+        if (breakpoints.count(address)) { return false; }
+
+        bool was_armed = armed;
+        disarm();
+        breakpoints[address] = state.get_word(address);
+        state.set_word(trap_word, address);
+        if (was_armed) { arm(); }
+        return true;
+    }
+
+    bool Debugger::remove_breakpoint(uint32_t address)
+    {
+        State& state = emulator.state;
+        address &= state.address_mask;
+        auto breakpoint = breakpoints.find(address);
+        if (breakpoint == breakpoints.end()) { return false; }
+
+        bool was_armed = armed;
+        disarm();
+        state.set_word(breakpoint->second, address);
+        breakpoints.erase(breakpoint);
+        if (was_armed) { arm(); }
+        return true;
+    }
+
+    bool Debugger::set_watchpoint(uint32_t address)
+    {
+        address &= emulator.state.address_mask;
+        if ((emulator.state.backend != State::Backend::DENSE) || watchpoints.count(address)) { return false; }
+        watchpoints[address] = read(address);
+        return true;
+    }
+
+    bool Debugger::remove_watchpoint(uint32_t address)
+    {
+        address &= emulator.state.address_mask;
+        return watchpoints.erase(address) != 0;
+    }
+
+    uint32_t Debugger::read(uint32_t address) const
+    {
+        address &= emulator.state.address_mask;
+        auto breakpoint = breakpoints.find(address);
+        if (breakpoint != breakpoints.end()) { return breakpoint->second; }
+        return emulator.state.get_word(address);
+    }
+
+    void Debugger::write(uint32_t address, uint32_t value)
+    {
+        address &= emulator.state.address_mask;
+        auto breakpoint = breakpoints.find(address);
+        if (breakpoint != breakpoints.end())
+        {
+            breakpoint->second = value;
+            return;
+        }
+
+        bool was_armed = armed;
+        disarm();
+        emulator.state.set_word(value, address);
+        if (was_armed) { arm(); }
+
+        // Запись отладчика не считается изменением, обнаруженным точкой наблюдения.
+        auto watchpoint = watchpoints.find(address);
+        if (watchpoint != watchpoints.end()) { watchpoint->second = value; }
+    }
+
+    // PROTECTED:
+
+    void Debugger::arm()
+    {
+        if (watchpoints.empty() || armed) { return; }
+
+        // Слово выровнено по 4 байта, поэтому всегда лежит в одной странице хоста.
+        uint8_t* memory = emulator.state.memory.data();
+        pages.clear();
+        for (const auto& watchpoint : watchpoints)
+        {
+            uintptr_t host = reinterpret_cast<uintptr_t>(memory + static_cast<size_t>(watchpoint.first) * State::bytes_in_word);
+            uint8_t* page = reinterpret_cast<uint8_t*>(host & ~static_cast<uintptr_t>(page_size - 1));
+            if (pages.empty() || (pages.back() != page)) { pages.push_back(page); }
+        }
+
+        memory_begin = memory;
+        memory_end = memory + emulator.state.memory.size();
+        armed = 1;
+        for (uint8_t* page : pages) { mprotect(page, page_size, PROT_READ); }
+    }
+
+    void Debugger::disarm()
+    {
+        if (!armed) { return; }
+        armed = 0;
+        for (uint8_t* page : pages) { mprotect(page, page_size, PROT_READ | PROT_WRITE); }
+    }
+
+    void Debugger::collect_changes()
+    {
+        for (auto& watchpoint : watchpoints)
+        {
+            uint32_t value = read(watchpoint.first);
+            if (value != watchpoint.second)
+            {
+                changes.push_back({watchpoint.first, watchpoint.second, value});
+                watchpoint.second = value;
+            }
+        }
+    }
+
+    bool Debugger::parse_address(const std::string& text, uint32_t& address) const
+    {
+        if (text.empty()) { return false; }
+
+        // Число (десятичное или с префиксом 0x).
+        if (std::isdigit(static_cast<unsigned char>(text[0])))
+        {
+            char* end = nullptr;
+            unsigned long long value = std::strtoull(text.c_str(), &end, 0);
+            if (*end != '\0') { return false; }
+            address = static_cast<uint32_t>(value) & emulator.state.address_mask;
+            return true;
+        }
+
+        // Метка.
+        for (const auto& symbol : emulator.state.symbols)
+        {
+            if (symbol.second == text)
+            {
+                address = symbol.first;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Debugger::print_stop(Stop stop, std::ostream& console_stream) const
+    {
+        const State& state = emulator.state;
+        for (const Change& change : changes)
+        {
+            console_stream << "[DEBUGGER]: Watchpoint " << change.address << " (" << state.symbolize(change.address) << "): "
+                           << static_cast<int32_t>(change.before) << " -> " << static_cast<int32_t>(change.after) << std::endl;
+        }
+
+        switch (stop)
+        {
+            case Stop::STEP:       { break; }
+            case Stop::BREAKPOINT: { console_stream << "[DEBUGGER]: Breakpoint." << std::endl; break; }
+            case Stop::WATCHPOINT: { break; }
+            case Stop::INTERRUPT:  { console_stream << "[DEBUGGER]: Interrupted." << std::endl; break; }
+            case Stop::HALT:       { console_stream << "[DEBUGGER]: The machine has halted." << std::endl; break; }
+            case Stop::ERROR:      { console_stream << "[DEBUGGER]: The machine has stopped with an error." << std::endl; break; }
+        }
+        print_disassembly(static_cast<uint32_t>(state.registers[State::CIR]) & state.address_mask, 1, console_stream);
+    }
+
+    void Debugger::print_registers(std::ostream& console_stream) const
+    {
+        const State& state = emulator.state;
+        for (uint8_t index = 0; index < State::registers_number; ++index)
+        {
+            std::string name = (index == State::CIR) ? "r15 (CIR)" : (index == State::SR) ? "r14 (SR)" : "r" + std::to_string(index);
+            console_stream << "[DEBUGGER]: " << std::left << std::setw(10) << name << std::right << " = " << std::setw(11)
+                           << state.registers[index] << "  0x" << std::hex << std::setw(8) << std::setfill('0')
+                           << static_cast<uint32_t>(state.registers[index]) << std::dec << std::setfill(' ') << std::endl;
+        }
+        console_stream << "[DEBUGGER]: flags      = " << static_cast<int>(state.flags)
+                       << " (equality " << ((state.flags & State::FlagsBits::EQUALITY) ? 1 : 0)
+                       << ", majority " << ((state.flags & State::FlagsBits::MAJORITY) ? 1 : 0) << ")" << std::endl;
+    }
+
+    void Debugger::print_memory(uint32_t address, size_t count, std::ostream& console_stream) const
+    {
+        const State& state = emulator.state;
+        for (size_t index = 0; index < count; ++index)
+        {
+            uint32_t current = static_cast<uint32_t>((address + index) & state.address_mask);
+            uint32_t word = read(current);
+            console_stream << "[DEBUGGER]: " << std::setw(8) << current << " (" << state.symbolize(current) << "): "
+                           << static_cast<int32_t>(word) << "  0x" << std::hex << std::setw(8) << std::setfill('0') << word
+                           << std::dec << std::setfill(' ') << std::endl;
+        }
+    }
+
+    void Debugger::print_disassembly(uint32_t address, size_t count, std::ostream& console_stream) const
+    {
+        const State& state = emulator.state;
+        const uint32_t current = static_cast<uint32_t>(state.registers[State::CIR]) & state.address_mask;
+        for (size_t index = 0; index < count; ++index)
+        {
+            uint32_t line = static_cast<uint32_t>((address + index) & state.address_mask);
+            console_stream << "[DEBUGGER]: " << ((line == current) ? "=>" : "  ") << (breakpoints.count(line) ? "*" : " ")
+                           << std::setw(8) << line << " (" << state.symbolize(line) << "): "
+                           << emulator.translator.disassemble(read(line)) << std::endl;
+        }
+    }
+
+    void Debugger::print_points(std::ostream& console_stream) const
+    {
+        const State& state = emulator.state;
+        if (breakpoints.empty() && watchpoints.empty()) { console_stream << "[DEBUGGER]: No breakpoints or watchpoints." << std::endl; }
+        for (const auto& breakpoint : breakpoints)
+        {
+            console_stream << "[DEBUGGER]: Breakpoint " << breakpoint.first << " (" << state.symbolize(breakpoint.first) << "): "
+                           << emulator.translator.disassemble(breakpoint.second) << std::endl;
+        }
+        for (const auto& watchpoint : watchpoints)
+        {
+            console_stream << "[DEBUGGER]: Watchpoint " << watchpoint.first << " (" << state.symbolize(watchpoint.first) << "): "
+                           << static_cast<int32_t>(watchpoint.second) << std::endl;
+        }
+    }
+
+    // Обработчик SIGSEGV: запись в защищённую страницу памяти машины снимает защиту всех страниц и запрашивает остановку.
+    // Прочие ошибки передаются прежнему обработчику: он восстанавливается, и команда, вызвавшая ошибку, повторяется.
+    void Debugger::handle(int signal_number, siginfo_t* information, void* context)
+    {
+        (void)context;
+        Debugger* debugger = active;
+        const uint8_t* address = static_cast<const uint8_t*>(information->si_addr);
+        if ((debugger != nullptr) && debugger->armed && (address >= debugger->memory_begin) && (address < debugger->memory_end))
+        {
+            debugger->armed = 0;
+            for (uint8_t* page : debugger->pages) { mprotect(page, debugger->page_size, PROT_READ | PROT_WRITE); }
+            debugger->faulted = 1;
+            debugger->emulator.executor.interrupt.store(true, std::memory_order_relaxed);
+            return;
+        }
+
+        if (debugger != nullptr) { sigaction(signal_number, &debugger->previous, nullptr); }
+        else { signal(signal_number, SIG_DFL); }
+    }
+}
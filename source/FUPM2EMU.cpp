@@ -2,8 +2,18 @@
 #include <iostream>
 #include <cstdio>
 #include <cstring>
+#include <algorithm>
+#include <exception>
+#include <system_error>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 #include "FUPM2EMU.hpp"
+#include "CallProfiler.hpp"
+#include "CacheSimulator.hpp"
+#include "BranchProfiler.hpp"
 
 //#define DEBUG_OUTPUT_EXECUTION
 //#define DEBUG_OUTPUT_LOADINGSTATE
@@ -13,11 +23,17 @@
 namespace FUPM2EMU
 {
     ////////////////      State      ///////////////
-    // Настройки компиляции:
-    #define MEMORY_MOD          // Модульная адресация.
-    //#define MEMORY_EXCEPTIONS // Исключение при выходе за пределы адресного пространства.
+    const char State::executable_signature[8] = { 'F', 'U', 'P', 'M', '2', 'E', 'X', 'E' };
+
+    State::State() : State(Backend::DENSE, address_bits)
+    {
 
-    State::State()
+    }
+    State::State(Backend init_backend, uint8_t init_address_bits) :
+        backend(init_backend),
+        memory_words(static_cast<size_t>(1) << (init_backend == Backend::DENSE ? address_bits : init_address_bits)),
+        address_mask(memory_words - 1),
+        paged(init_backend == Backend::DENSE ? 0 : init_address_bits)
     {
         // Заполнение нулями регистров.
         std::memset(registers, 0, registers_number * sizeof(uint32_t));
@@ -25,8 +41,17 @@ namespace FUPM2EMU
         // Обнуление регистра флагов.
         flags = 0;
 
-        // Создание и заполнение нулями блока памяти.
-        memory = std::vector<uint8_t>(memory_size * bytes_in_word, 0);
+        // Создание и заполнение нулями блока памяти. Разреженная память выделяет страницы при первой записи.
+        if (backend == Backend::DENSE)
+        {
+            memory = std::vector<uint8_t>(memory_size * bytes_in_word, 0);
+
+            // Нулевая память совпадает с началом любой цепочки контрольных точек.
+            dirty_pages = std::vector<uint8_t>(pages_number, 0);
+            written_pages = std::vector<uint8_t>(pages_number, 0);
+        }
+
+        reset_heap(0);
     }
     State::~State()
     {
@@ -35,13 +60,30 @@ namespace FUPM2EMU
 
     int State::load(std::istream& input_stream)
     {
+        // Исполнимый файл узнаётся по сигнатуре. Иначе прочитанные байты - начало дампа.
+        char signature[sizeof(executable_signature)];
+        input_stream.read(signature, sizeof(signature));
+        size_t signature_bytes = static_cast<size_t>(input_stream.gcount());
+        if ((signature_bytes == sizeof(signature)) && (std::memcmp(signature, executable_signature, sizeof(signature)) == 0))
+        {
+            return load_executable(input_stream);
+        }
+
         // Первые 16 * 4 + 1 байт - регистры + регистр флагов, остальное до конца файла - память.
         char bytes[bytes_in_word];
 
         // Регистры.
         for (size_t reg = 0; reg < registers_number; ++reg)
         {
-            if (input_stream.read(bytes, bytes_in_word))
+            bool read = false;
+            if ((reg + 1) * bytes_in_word <= signature_bytes)
+            {
+                std::memcpy(bytes, signature + reg * bytes_in_word, bytes_in_word);
+                read = true;
+            }
+            else { read = static_cast<bool>(input_stream.read(bytes, bytes_in_word)); }
+
+            if (read)
             {
                 registers[reg] = (static_cast<uint32_t>(bytes[0]) << 24) |
                                  (static_cast<uint32_t>(bytes[1]) << 16) |
@@ -61,6 +103,23 @@ namespace FUPM2EMU
 
         // Память.
         size_t address = 0;
+        if (backend == Backend::SPARSE)
+        {
+            // Нулевые слова образа не выделяют страниц.
+            while (input_stream.read(bytes, bytes_in_word) && (address < (memory_words * bytes_in_word)))
+            {
+                if (bytes[0] | bytes[1] | bytes[2] | bytes[3]) { std::memcpy(paged.obtain(address / bytes_in_word) + address % PagedMemory::page_bytes, bytes, bytes_in_word); }
+                address += bytes_in_word;
+            }
+            // Неполное последнее слово.
+            for (std::streamsize byte = 0; (byte < input_stream.gcount()) && (address < (memory_words * bytes_in_word)); ++byte, ++address)
+            {
+                paged.obtain(address / bytes_in_word)[address % PagedMemory::page_bytes] = static_cast<uint8_t>(bytes[byte]);
+            }
+
+            reset_heap((address + bytes_in_word - 1) / bytes_in_word);
+            return 0;
+        }
         while (input_stream.get(bytes[0]) && (address < (memory_size * bytes_in_word)))
         {
             memory[address] = static_cast<uint8_t>(bytes[0]);
@@ -70,675 +129,1948 @@ namespace FUPM2EMU
             ++address;
         }
 
+        // Загруженные страницы считаются изменёнными.
+        size_t loaded_pages = (address + page_size * bytes_in_word - 1) / (page_size * bytes_in_word);
+        std::fill(dirty_pages.begin(), dirty_pages.begin() + loaded_pages, 1);
+
+        reset_heap((address + bytes_in_word - 1) / bytes_in_word);
         return 0;
     }
 
-
-    inline uint32_t State::get_word(size_t address) const
+    std::string State::symbolize(uint32_t address, bool with_offset) const
     {
-        // Адресация по модулю.
-        #ifdef MEMORY_MOD
-        address %= memory_size;
-        #endif
+        auto symbol = symbols.upper_bound(address);
+        if (symbol == symbols.begin()) { return std::to_string(address); }
 
-        // Исключение при выходе за пределы адресного пространства.
-        #ifdef MEMORY_EXCEPTIONS
-        if (address > memory_size) { throw Exception::MEMORY; }
-        #endif
+        --symbol;
+        if (!with_offset || (symbol->first == address)) { return symbol->second; }
+        return symbol->second + "+" + std::to_string(address - symbol->first);
+    }
 
-        size_t byte_address = address * bytes_in_word;
-        return (static_cast<uint32_t>(memory[byte_address]) << 24)     |
-               (static_cast<uint32_t>(memory[byte_address + 1]) << 16) |
-               (static_cast<uint32_t>(memory[byte_address + 2]) << 8)  |
-                static_cast<uint32_t>(memory[byte_address + 3]);
+    void State::reset_heap(size_t init_image_size)
+    {
+        image_size = init_image_size;
+        heap.reset(image_size, memory_words - std::min(stack_reserve, memory_words / 2));
     }
-    inline void State::set_word(uint32_t value, size_t address)
+
+    void State::clear()
     {
-        // Адресация по модулю.
-        #ifdef MEMORY_MOD
-        address %= memory_size;
-        #endif
+        std::memset(registers, 0, registers_number * sizeof(uint32_t));
+        flags = 0;
 
-        // Исключение при выходе за пределы адресного пространства.
-        #ifdef MEMORY_EXCEPTIONS
-        if (address > memory_size) { throw Exception::MEMORY; }
-        #endif
+        if (backend == Backend::DENSE)
+        {
+            // Ненулевыми могут быть только отмеченные страницы. Подряд идущие отмеченные страницы обнуляются одним memset.
+            for (size_t page = 0; page < pages_number;)
+            {
+                if (!dirty_pages[page] && !written_pages[page])
+                {
+                    ++page;
+                    continue;
+                }
+
+                size_t first_page = page;
+                for (; (page < pages_number) && (dirty_pages[page] || written_pages[page]); ++page)
+                {
+                    dirty_pages[page] = 0;
+                    written_pages[page] = 0;
+                }
+                std::memset(memory.data() + first_page * page_size * bytes_in_word, 0, (page - first_page) * page_size * bytes_in_word);
+            }
+        }
+        else
+        {
+            paged.clear();
+        }
 
-        size_t byte_address = address * bytes_in_word;
-        memory[byte_address + 3] = static_cast<uint8_t>(value & 0xFF); value >>= 8;
-        memory[byte_address + 2] = static_cast<uint8_t>(value & 0xFF); value >>= 8;
-        memory[byte_address + 1] = static_cast<uint8_t>(value & 0xFF); value >>= 8;
-        memory[byte_address] =     static_cast<uint8_t>(value & 0xFF);
+        symbols.clear();
+        reset_heap(0);
     }
 
+    int State::revert(const State& origin)
+    {
+        require_dense("state revert");
+        std::memcpy(registers, origin.registers, registers_number * sizeof(uint32_t));
+        flags = origin.flags;
+        // Таблица блоков распределителя велика, поэтому копируется, только если были выделения или освобождения.
+        if ((heap.statistics.allocations != origin.heap.statistics.allocations) ||
+            (heap.statistics.releases != origin.heap.statistics.releases))
+        {
+            heap = origin.heap;
+        }
+
+        for (size_t page = 0; page < pages_number; ++page)
+        {
+            if (!dirty_pages[page]) { continue; }
 
+            size_t offset = page * page_size * bytes_in_word;
+            std::memcpy(memory.data() + offset, origin.memory.data() + offset, page_size * bytes_in_word);
+            written_pages[page] = 1;
+            dirty_pages[page] = 0;
+        }
 
-    ////////////////    Executor    ////////////////
-    // PUBLIC:
-    Executor::Executor()
-    {
-        // ...
-    }
-    Executor::~Executor()
-    {
-        // ...
+        return 0;
     }
 
-    // Выполнение комманды.
-    inline Executor::ReturnCode Executor::step(State& state, std::istream& input_stream, std::ostream& output_stream)
+    int State::save_checkpoint(std::ostream& output_stream)
     {
-        // Извлечение следующией команды.
-        uint32_t command = state.get_word(state.registers[State::CIR]);
+        require_dense("checkpointing");
+        // Запись: маркер, число страниц, регистры, флаги, размер образа, состояние распределителя (число слов и слова),
+        // затем страницы (номер и содержимое). Распределитель записывается целиком: его данные хранятся вне памяти машины.
+        uint32_t pages_count = 0;
+        for (size_t page = 0; page < pages_number; ++page) { pages_count += dirty_pages[page]; }
+
+        write_stream_word(output_stream, checkpoint_marker);
+        write_stream_word(output_stream, pages_count);
+        for (size_t reg = 0; reg < registers_number; ++reg) { write_stream_word(output_stream, static_cast<uint32_t>(registers[reg])); }
+        output_stream.put(static_cast<char>(flags));
+
+        std::vector<uint32_t> heap_words;
+        heap.save(heap_words);
+        write_stream_word(output_stream, static_cast<uint32_t>(image_size));
+        write_stream_word(output_stream, static_cast<uint32_t>(heap_words.size()));
+        for (uint32_t word : heap_words) { write_stream_word(output_stream, word); }
+
+        for (size_t page = 0; page < pages_number; ++page)
+        {
+            if (!dirty_pages[page]) { continue; }
 
-        // Код будет короче, если вычислить все возможные операнды сразу.
-        OPERATION_CODE operation = static_cast<OPERATION_CODE>((command >> 24) & 0xFF);
-        uint8_t R1 = (command >> 20) & 0xF;
-        uint8_t R2 = (command >> 16) & 0xF;
-        int32_t imm16 = command & 0x0FFFF;
-        int32_t imm20 = command & 0xFFFFF;
+            // Память уже хранится старшим байтом вперёд, поэтому страница пишется как есть.
+            write_stream_word(output_stream, static_cast<uint32_t>(page));
+            output_stream.write(reinterpret_cast<const char*>(memory.data() + page * page_size * bytes_in_word), page_size * bytes_in_word);
+            written_pages[page] = 1;
+            dirty_pages[page] = 0;
+        }
 
-        ReturnCode return_code = ReturnCode::OK;
+        output_stream.flush();
+        return 0;
+    }
 
-        #ifdef DEBUG_OUTPUT_EXECUTION
-        std::cout << "OPCODE: " << operation << std::endl;
-        std::cout << "registers:"
-                  << " R" << static_cast<unsigned int>(R1) << ": " << state.registers[R1]
-                  << " R" << static_cast<unsigned int>(R2) << ": " << state.registers[R2] << std::endl;
-        std::cout << "Immediates: " << "imm16: " << imm16 << " imm20: " << imm20 << std::endl;
-        #endif
+    int State::restore_checkpoint(std::istream& input_stream, size_t index)
+    {
+        require_dense("checkpointing");
+        // Цепочка начинается с нулевой памяти.
+        std::memset(registers, 0, registers_number * sizeof(uint32_t));
+        flags = 0;
+        std::fill(memory.begin(), memory.end(), 0);
+        std::fill(dirty_pages.begin(), dirty_pages.end(), 0);
+        std::fill(written_pages.begin(), written_pages.end(), 0);
 
-        try
+        for (size_t record = 0; record <= index; ++record)
         {
-            switch(operation)
+            uint32_t marker = 0;
+            uint32_t pages_count = 0;
+            if (!read_stream_word(input_stream, marker) || (marker != checkpoint_marker) || !read_stream_word(input_stream, pages_count))
             {
-                // СИСТЕМНОЕ.
-                // HALT - выключение процессора.
-                case HALT:
-                {
-                    return_code = ReturnCode::TERMINATE;
-                    break;
-                }
-
-                // SYSCALL - системный вызов.
-                case SYSCALL:
-                {
-                    switch (imm20)
-                    {
-                        // EXIT - выход.
-                        case 0:
-                        {
-                            return_code = ReturnCode::TERMINATE;
-                            break;
-                        }
-                        // SCANINT - запрос целого числа.
-                        case 100:
-                        {
-                            input_stream >> state.registers[R1];
-                            break;
-                        }
-                        // SCANDOUBLE - запрос вещественного числа.
-                        case 101:
-                        {
-                            // Результат выполнения команды приведёт к выходу за пределы существующих регистров.
-                            if (R1 + 1 >= State::registers_number) { throw OperationException::INVALIDREG; }
-
-                            double input = 0.0;
-                            input_stream >> input;
-                            *reinterpret_cast<double*>(state.registers + R1) = input;
-                            break;
-                        }
-                        // PRINTINT - вывод целого числа.
-                        case 102:
-                        {
-                            output_stream << state.registers[R1];
-                            break;
-                        }
-                        // PRINTDOUBLE - вывод вещественного числа.
-                        case 103:
-                        {
-                            // Результат выполнения команды приведёт к выходу за пределы существующих регистров.
-                            if (R1 + 1 >= State::registers_number) { throw OperationException::INVALIDREG; }
+                // Файлы прежнего формата ("CKPT") не содержат состояния распределителя памяти.
+                if (marker == 0x434B5054) { std::cerr << "[STATE ERROR]: checkpoint file has an outdated format." << std::endl; }
+                else { std::cerr << "[STATE ERROR]: checkpoint " << record << " was not found." << std::endl; }
+                throw Exception::CHECKPOINT;
+            }
 
-                            output_stream << *reinterpret_cast<double*>(state.registers + R1);
-                            break;
-                        }
-                        // PUTCHAR - вывод символа.
-                        case 105:
-                        {
-                            output_stream.put(static_cast<uint8_t>(state.registers[R1]));
-                            break;
-                        }
-                        // GETCHAR - получение символа.
-                        case 106:
-                        {
-                            state.registers[R1] = static_cast<int32_t>(getchar());
-                            break;
-                        }
-                        // Использован неспецифицированный код системного вызова.
-                        default:
-                        {
-                            return_code = ReturnCode::ERROR;
-                            break;
-                        }
-                    }
-                    break;
-                }
+            for (size_t reg = 0; reg < registers_number; ++reg)
+            {
+                uint32_t value = 0;
+                if (!read_stream_word(input_stream, value)) { throw Exception::CHECKPOINT; }
+                registers[reg] = static_cast<int32_t>(value);
+            }
+            char flags_byte = 0;
+            if (!input_stream.get(flags_byte)) { throw Exception::CHECKPOINT; }
+            flags = static_cast<uint8_t>(flags_byte);
+
+            uint32_t record_image_size = 0;
+            uint32_t heap_size = 0;
+            if (!read_stream_word(input_stream, record_image_size) || !read_stream_word(input_stream, heap_size) ||
+                (heap_size > memory_words * 2 + 64))
+            {
+                std::cerr << "[STATE ERROR]: checkpoint " << record << " is damaged." << std::endl;
+                throw Exception::CHECKPOINT;
+            }
+            std::vector<uint32_t> heap_words(heap_size);
+            for (uint32_t& word : heap_words)
+            {
+                if (!read_stream_word(input_stream, word)) { throw Exception::CHECKPOINT; }
+            }
+            image_size = record_image_size;
+            if (!heap.load(heap_words))
+            {
+                std::cerr << "[STATE ERROR]: checkpoint " << record << " is damaged." << std::endl;
+                throw Exception::CHECKPOINT;
+            }
 
-                // ЦЕЛОЧИСЛЕННАЯ АРИФМЕТИКА.
-                // ADD - сложение регистров.
-                case ADD:
+            for (uint32_t count = 0; count < pages_count; ++count)
+            {
+                uint32_t page = 0;
+                if (!read_stream_word(input_stream, page) || (page >= pages_number) ||
+                    !input_stream.read(reinterpret_cast<char*>(memory.data() + page * page_size * bytes_in_word), page_size * bytes_in_word))
                 {
-                    state.registers[R1] += state.registers[R2] + imm16;
-                    break;
+                    std::cerr << "[STATE ERROR]: checkpoint " << record << " is damaged." << std::endl;
+                    throw Exception::CHECKPOINT;
                 }
 
-                // ADDI - прибавление к регистру непосредственного операнда.
-                case ADDI:
-                {
-                    state.registers[R1] += imm20;
-                    break;
-                }
+                // Восстановленные страницы считаются изменёнными: следующая контрольная точка начнёт новую полную цепочку.
+                dirty_pages[page] = 1;
+            }
+        }
 
-                // SUB - разность регистров.
-                case SUB:
-                {
-                    state.registers[R1] -= state.registers[R2] + imm16;
-                    break;
-                }
+        return 0;
+    }
 
-                // SUBI - вычитание из регистра непосредственного операнда.
-                case SUBI:
-                {
-                    state.registers[R1] -= imm20;
-                    break;
-                }
+    int State::save_executable(std::ostream& output_stream, bool compress) const
+    {
+        // Заполненные участки памяти: ненулевые слова, между которыми меньше segment_gap нулевых.
+        std::vector<std::pair<size_t, size_t>> ranges; // Первое слово и слово после последнего.
+        for (size_t address = 0; address < memory_words;)
+        {
+            // Невыделенные страницы разреженной памяти пропускаются целиком.
+            if ((backend == Backend::SPARSE) && (paged.find(address) == nullptr))
+            {
+                address = (address | (PagedMemory::page_words - 1)) + 1;
+                continue;
+            }
 
-                // MUL - произведение регистров.
-                case MUL:
-                {
-                    // Результат умножения приведёт к выходу за пределы существующих регистров.
-                    if (R1 + 1 >= State::registers_number) { throw OperationException::INVALIDREG; }
+            if (get_word(address) != 0)
+            {
+                if (ranges.empty() || (address - ranges.back().second >= segment_gap)) { ranges.push_back({ address, address + 1 }); }
+                else { ranges.back().second = address + 1; }
+            }
+            ++address;
+        }
 
-                    int64_t product = static_cast<int64_t>(state.registers[R1]) * static_cast<int64_t>(state.registers[R2] + imm16);
-                    state.registers[R1] = int32_t(product & UINT32_MAX);
-                    state.registers[R1 + 1] = static_cast<int32_t>((product >> State::bits_in_word) & UINT32_MAX);
-                    break;
-                }
+        // Данные сегментов.
+        std::vector<std::vector<uint32_t>> contents(ranges.size());
+        std::vector<SegmentEncoding> encodings(ranges.size(), RAW);
+        for (size_t segment = 0; segment < ranges.size(); ++segment)
+        {
+            std::vector<uint32_t> words(ranges[segment].second - ranges[segment].first);
+            for (size_t index = 0; index < words.size(); ++index) { words[index] = get_word(ranges[segment].first + index); }
 
-                // MULI - произведение регистра на непосредственный операнд.
-                case MULI:
+            if (compress)
+            {
+                compress_segment(words, contents[segment]);
+                if (contents[segment].size() < words.size())
                 {
-                    // Результат умножения приведёт к выходу за пределы существующих регистров.
-                    if (R1 + 1 >= State::registers_number) { throw OperationException::INVALIDREG; }
-
-                    int64_t product = static_cast<int64_t>(state.registers[R1]) * static_cast<int64_t>(imm20);
-                    state.registers[R1] = static_cast<int32_t>(product & UINT32_MAX);
-                    state.registers[R1 + 1] = static_cast<int32_t>((product >> State::bits_in_word) & UINT32_MAX);
-                    break;
+                    encodings[segment] = RLE;
+                    continue;
                 }
+            }
+            contents[segment] = std::move(words);
+        }
 
-                // DIV - частное и остаток от деления пары регистров на регистр.
-                case DIV:
-                {
-                    // Результат деления приведёт к выходу за пределы существующих регистров.
-                    if (R1 + 1 >= State::registers_number) { throw OperationException::INVALIDREG; }
-                    // Происходит деление на ноль.
-                    if (!state.registers[R2]) { throw OperationException::DIVBYZERO; }
+        // Заголовок и таблица сегментов.
+        output_stream.write(executable_signature, sizeof(executable_signature));
+        write_stream_word(output_stream, executable_version);
+        write_stream_word(output_stream, static_cast<uint32_t>(registers[CIR]));
+        write_stream_word(output_stream, static_cast<uint32_t>(registers[SR]));
+        write_stream_word(output_stream, static_cast<uint32_t>(image_size));
+        write_stream_word(output_stream, static_cast<uint32_t>(ranges.size()));
+        for (size_t segment = 0; segment < ranges.size(); ++segment)
+        {
+            write_stream_word(output_stream, static_cast<uint32_t>(ranges[segment].first));
+            write_stream_word(output_stream, static_cast<uint32_t>(ranges[segment].second - ranges[segment].first));
+            write_stream_word(output_stream, encodings[segment]);
+            write_stream_word(output_stream, static_cast<uint32_t>(contents[segment].size() * bytes_in_word));
+        }
 
-                    int64_t divident = static_cast<int64_t>(state.registers[R1] | (static_cast<int64_t>(state.registers[R1 + 1]) << State::bits_in_word));
-                    int64_t divider = static_cast<int64_t>(state.registers[R2]);
-                    int64_t product = divident / divider;
+        for (const auto& content : contents)
+        {
+            for (uint32_t word : content) { write_stream_word(output_stream, word); }
+        }
 
-                    // Результат деления не помещается в регистр. По спецификации - деление на ноль.
-                    if (product > UINT32_MAX) { throw OperationException::DIVBYZERO; }
+        output_stream.flush();
+        return output_stream ? 0 : -1;
+    }
 
-                    int64_t remainder = divident % divider;
+    void State::store_words(const uint32_t* words, size_t address, size_t count)
+    {
+        size_t end = address + count;
+        while (address < end)
+        {
+            size_t part = 0;
+            uint8_t* destination = nullptr;
+            if (backend == Backend::DENSE)
+            {
+                part = end - address;
+                destination = memory.data() + address * bytes_in_word;
+                std::fill(dirty_pages.begin() + (address >> page_bits), dirty_pages.begin() + ((end - 1) >> page_bits) + 1, 1);
+            }
+            else
+            {
+                part = std::min(end, (address | (PagedMemory::page_words - 1)) + 1) - address;
+                destination = paged.obtain(address) + (address % PagedMemory::page_words) * bytes_in_word;
+            }
 
-                    state.registers[R1] = static_cast<int32_t>(product & UINT32_MAX);
-                    state.registers[R1 + 1] = static_cast<int32_t>(remainder & UINT32_MAX);
-                    break;
-                }
+            std::memcpy(destination, words, part * bytes_in_word);
+            words += part;
+            address += part;
+        }
+    }
 
-                // DIVI - частное и остаток от деления пары регистров на непосредственный операнд.
-                case DIVI:
-                {
-                    // Результат деления приведёт к выходу за пределы существующих регистров.
-                    if (R1 + 1 >= State::registers_number) { throw OperationException::INVALIDREG; }
-                    // Происходит деление на ноль.
-                    if (!imm20) { throw OperationException::DIVBYZERO; }
+    // PROTECTED:
 
-                    int64_t divident = static_cast<int64_t>(state.registers[R1] | (static_cast<int64_t>(state.registers[R1 + 1]) << State::bits_in_word));
-                    int64_t divider = static_cast<int64_t>(imm20);
-                    int64_t product = divident / divider;
+    int State::load_executable(std::istream& input_stream)
+    {
+        // Элемент таблицы сегментов.
+        struct Segment
+        {
+            uint32_t address;  // Адрес первого слова.
+            uint32_t words;    // Число слов.
+            uint32_t encoding; // Способ хранения.
+            uint32_t bytes;    // Размер данных в файле.
+        };
 
-                    // Результат деления не помещается в регистр. По спецификации - деление на ноль.
-                    if (product > UINT32_MAX) { throw OperationException::DIVBYZERO; }
+        auto damaged = [](const char* reason)
+        {
+            std::cerr << "[STATE ERROR]: executable file " << reason << "." << std::endl;
+            throw Exception::EXECUTABLE;
+        };
 
-                    int64_t remainder = divident % divider;
+        uint32_t version = 0, entry = 0, stack = 0, image_words = 0, segments_count = 0;
+        if (!read_stream_word(input_stream, version) || !read_stream_word(input_stream, entry) ||
+            !read_stream_word(input_stream, stack) || !read_stream_word(input_stream, image_words) ||
+            !read_stream_word(input_stream, segments_count))
+        {
+            damaged("header is truncated");
+        }
+        if (version != executable_version) { damaged("format version is not supported"); }
 
-                    state.registers[R1] = static_cast<int32_t>(product & UINT32_MAX);
-                    state.registers[R1 + 1] = static_cast<int32_t>(remainder & UINT32_MAX);
-                    break;
-                }
+        size_t image_end = image_words; // Конец образа: не раньше конца последнего сегмента.
+        std::vector<Segment> segments;
+        segments.reserve(std::min(static_cast<size_t>(segments_count), static_cast<size_t>(page_size)));
+        for (uint32_t index = 0; index < segments_count; ++index)
+        {
+            Segment segment;
+            if (!read_stream_word(input_stream, segment.address) || !read_stream_word(input_stream, segment.words) ||
+                !read_stream_word(input_stream, segment.encoding) || !read_stream_word(input_stream, segment.bytes))
+            {
+                damaged("segment table is truncated");
+            }
+            if ((segment.address >= memory_words) || (segment.words > memory_words - segment.address))
+            {
+                damaged("segment does not fit into the address space");
+            }
+            if (((segment.encoding == RAW) && (segment.bytes != static_cast<uint64_t>(segment.words) * bytes_in_word)) ||
+                ((segment.encoding != RAW) && (segment.encoding != RLE)) || (segment.bytes % bytes_in_word != 0))
+            {
+                damaged("segment encoding is invalid");
+            }
+            segments.push_back(segment);
+            image_end = std::max<size_t>(image_end, static_cast<size_t>(segment.address) + segment.words);
+        }
 
-                // КОПИРОВАНИЕ В РЕГИСТРЫ.
-                // LC - загрузка константы в регистр.
-                case LC:
-                {
-                    state.registers[R1] = imm20;
-                    break;
-                }
+        std::memset(registers, 0, registers_number * sizeof(uint32_t));
+        flags = 0;
+        registers[CIR] = static_cast<int32_t>(entry);
+        registers[SR] = static_cast<int32_t>(stack);
 
-                // MOV - пересылка из одного регистра в другой.
-                case MOV:
-                {
-                    state.registers[R1] = state.registers[R2] + imm16;
-                    break;
-                }
+        for (const Segment& segment : segments)
+        {
+            if (segment.encoding == RAW)
+            {
+                if (!read_memory(input_stream, segment.address, segment.words)) { damaged("segment is truncated"); }
+                continue;
+            }
 
-                // СДВИГИ.
-                // SHL - сдвиг влево на занчение регистра.
-                case SHL:
-                {
-                    state.registers[R1] <<= state.registers[R2] + imm16;
-                    break;
-                }
+            // RLE: пакеты до заполнения сегмента.
+            size_t address = segment.address;
+            size_t end = address + segment.words;
+            size_t packed_words = segment.bytes / bytes_in_word;
+            while (packed_words != 0)
+            {
+                uint32_t header = 0, value = 0;
+                if (!read_stream_word(input_stream, header)) { damaged("segment is truncated"); }
+                --packed_words;
 
-                // SHLI - сдвиг влево на непосредственный операнд.
-                case SHLI:
+                size_t count = header & ~rle_run;
+                if ((count > end - address) || ((header & rle_run) ? (packed_words < 1) : (packed_words < count)))
                 {
-                    state.registers[R1] <<= imm20;
-                    break;
+                    damaged("compressed segment is damaged");
                 }
 
-                // SHR - сдвиг вправо на занчение регистра.
-                case SHR:
+                if (header & rle_run)
                 {
-                    state.registers[R1] >>= state.registers[R2] + imm16;
-                    break;
+                    if (!read_stream_word(input_stream, value)) { damaged("segment is truncated"); }
+                    --packed_words;
+                    for (size_t index = 0; index < count; ++index) { set_word(value, address + index); }
                 }
-
-                // SHRI - сдвиг вправо на непосредственный операнд.
-                case SHRI:
+                else
                 {
-                    state.registers[R1] >>= imm20;
-                    break;
+                    if (!read_memory(input_stream, address, count)) { damaged("segment is truncated"); }
+                    packed_words -= count;
                 }
+                address += count;
+            }
+            if (address != end) { damaged("compressed segment is damaged"); }
+        }
 
-                // ЛОГИЕСКИЕ ОПЕРАЦИИ.
-                // AND - побитовое И между регистрами.
-                case AND:
-                {
-                    state.registers[R1] &= state.registers[R2] + imm16;
-                    break;
-                }
+        reset_heap(std::min(image_end, memory_words));
+        return 0;
+    }
 
-                // ANDI - побитовое И между регистром и непосредственным операндом.
-                case ANDI:
-                {
-                    state.registers[R1] &= imm20;
-                    break;
-                }
+    bool State::read_memory(std::istream& input_stream, size_t address, size_t count)
+    {
+        // Память хранится старшим байтом вперёд, как и файл, поэтому слова читаются прямо в неё.
+        size_t end = address + count;
+        while (address < end)
+        {
+            size_t part = 0;
+            char* destination = nullptr;
+            if (backend == Backend::DENSE)
+            {
+                part = end - address;
+                destination = reinterpret_cast<char*>(memory.data() + address * bytes_in_word);
+                std::fill(dirty_pages.begin() + (address >> page_bits), dirty_pages.begin() + ((end - 1) >> page_bits) + 1, 1);
+            }
+            else
+            {
+                part = std::min(end, (address | (PagedMemory::page_words - 1)) + 1) - address;
+                destination = reinterpret_cast<char*>(paged.obtain(address) + (address % PagedMemory::page_words) * bytes_in_word);
+            }
 
-                // OR - побитовое ИЛИ между регистрами.
-                case OR:
-                {
-                    state.registers[R1] |= state.registers[R2] + imm16;
-                    break;
-                }
+            if (!input_stream.read(destination, static_cast<std::streamsize>(part * bytes_in_word))) { return false; }
+            address += part;
+        }
+        return true;
+    }
 
-                // ORI - побитовое ИЛИ между регистром и непосредственным операндом.
-                case ORI:
-                {
-                    state.registers[R1] |= imm20;
-                    break;
-                }
+    void State::compress_segment(const std::vector<uint32_t>& words, std::vector<uint32_t>& packed)
+    {
+        // Серия - не меньше трёх одинаковых слов (два слова в файле). Остальные слова идут блоками без сжатия.
+        auto run_length = [&words](size_t index)
+        {
+            size_t length = 1;
+            while ((index + length < words.size()) && (words[index + length] == words[index]) && (length < rle_run - 1)) { ++length; }
+            return length;
+        };
 
-                // XOR - побитовое ИСКЛЮЧАЮЩЕЕ ИЛИ между регистрами.
-                case XOR:
-                {
-                    state.registers[R1] ^= state.registers[R2] + imm16;
-                    break;
-                }
+        packed.clear();
+        size_t index = 0;
+        while (index < words.size())
+        {
+            size_t length = run_length(index);
+            if (length >= 3)
+            {
+                packed.push_back(rle_run | static_cast<uint32_t>(length));
+                packed.push_back(words[index]);
+                index += length;
+                continue;
+            }
 
-                // XORI - побитовое ИСКЛЮЧАЮЩЕЕ ИЛИ между регистром и непосредственным операндом.
-                case XORI:
-                {
-                    state.registers[R1] ^= imm20;
-                    break;
-                }
+            size_t literal_end = index + length;
+            while ((literal_end < words.size()) &&
+                   !((literal_end + 2 < words.size()) && (words[literal_end] == words[literal_end + 1]) && (words[literal_end] == words[literal_end + 2])))
+            {
+                ++literal_end;
+            }
+            packed.push_back(static_cast<uint32_t>(literal_end - index));
+            packed.insert(packed.end(), words.begin() + index, words.begin() + literal_end);
+            index = literal_end;
+        }
+    }
 
-                // NOT - побитовое НЕ.
-                case NOT:
-                {
-                    state.registers[R1] = ~(state.registers[R1]);
-                    break;
-                }
+    void State::require_dense(const char* operation) const
+    {
+        if (backend != Backend::DENSE)
+        {
+            std::cerr << "[STATE ERROR]: " << operation << " is not supported by sparse memory." << std::endl;
+            throw Exception::BACKEND;
+        }
+    }
 
-                // ВЕЩЕСТВЕННАЯ АРИФМЕТИКА.
-                // ADDD - сложение двух вещественных чисел.
-                case ADDD:
-                {
-                    // Результат выполнения команды приведёт к выходу за пределы существующих регистров.
-                    if ((R1 + 1 >= State::registers_number) || (R2 + 1 >= State::registers_number)) { throw OperationException::INVALIDREG; }
+    bool State::read_stream_word(std::istream& input_stream, uint32_t& value)
+    {
+        uint8_t bytes[bytes_in_word];
+        if (!input_stream.read(reinterpret_cast<char*>(bytes), bytes_in_word)) { return false; }
+
+        value = (static_cast<uint32_t>(bytes[0]) << 24) |
+                (static_cast<uint32_t>(bytes[1]) << 16) |
+                (static_cast<uint32_t>(bytes[2]) << 8)  |
+                 static_cast<uint32_t>(bytes[3]);
+        return true;
+    }
 
-                    *reinterpret_cast<double*>(state.registers + R1) += *reinterpret_cast<double*>(state.registers + R2);
-                    break;
-                }
+    void State::write_stream_word(std::ostream& output_stream, uint32_t value)
+    {
+        char bytes[bytes_in_word] =
+        {
+            static_cast<char>((value >> 24) & 0xFF),
+            static_cast<char>((value >> 16) & 0xFF),
+            static_cast<char>((value >> 8) & 0xFF),
+            static_cast<char>(value & 0xFF)
+        };
+        output_stream.write(bytes, bytes_in_word);
+    }
+
+
+
+    ////////////////    Executor    ////////////////
+    #ifdef FUPM2EMU_FUZZING
+    uint8_t* Executor::coverage = nullptr;
+    #endif
+
+    uint64_t Executor::Statistics::retired() const
+    {
+        uint64_t result = 0;
+        for (uint64_t count : classes) { result += count; }
+        return result;
+    }
+
+    // PUBLIC:
+    Executor::Executor()
+    {
+        std::fill(files, files + files_number, -1);
+    }
+    Executor::~Executor()
+    {
+        reset();
+    }
+
+    void Executor::reset()
+    {
+        stop_cores();
+        for (int& descriptor : files)
+        {
+            if (descriptor >= 0) { close(descriptor); }
+            descriptor = -1;
+        }
+        interrupt.store(false);
+    }
+
+    // Выполнение комманды.
+    inline Executor::ReturnCode Executor::step(State& state, std::istream& input_stream, std::ostream& output_stream)
+    {
+        uint64_t budget = 1;
+        return run_main<true, false>(state, input_stream, output_stream, budget);
+    }
+
+    // Выполнение команд до останова.
+    Executor::ReturnCode Executor::run(State& state, std::istream& input_stream, std::ostream& output_stream)
+    {
+        uint64_t budget = 0;
+        return run_main<false, false>(state, input_stream, output_stream, budget);
+    }
+
+    // Выполнение не более budget команд.
+    Executor::ReturnCode Executor::run(State& state, std::istream& input_stream, std::ostream& output_stream, uint64_t& budget)
+    {
+        if (budget == 0) { return ReturnCode::OK; }
+        return run_main<false, true>(state, input_stream, output_stream, budget);
+    }
+
+    // PROTECTED:
+
+    template <typename Memory>
+    Executor::SimulatedAccess<Memory>::SimulatedAccess(State& state, Executor& executor) :
+        memory(state, executor), simulator(*executor.cache_simulator)
+    {
+        // ...
+    }
+    template <typename Memory>
+    inline uint32_t Executor::SimulatedAccess<Memory>::fetch(size_t address)
+    {
+        simulator.fetch(address);
+        return memory.fetch(address);
+    }
+    template <typename Memory>
+    inline uint32_t Executor::SimulatedAccess<Memory>::read(size_t address) const
+    {
+        simulator.read(address);
+        return memory.read(address);
+    }
+    template <typename Memory>
+    inline void Executor::SimulatedAccess<Memory>::write(uint32_t value, size_t address) const
+    {
+        simulator.write(address);
+        memory.write(value, address);
+    }
+
+    // Выполнение основного ядра. После его останова или ошибки дожидается дополнительных ядер: они используют те же потоки ввода-вывода.
+    template <bool single_step, bool limited>
+    Executor::ReturnCode Executor::run_main(State& state, std::istream& input_stream, std::ostream& output_stream, uint64_t& budget)
+    {
+        ReturnCode return_code = ReturnCode::OK;
+        try
+        {
+            if (state.backend == State::Backend::DENSE) { return_code = dispatch<single_step, limited, DenseAccess>(state, input_stream, output_stream, budget); }
+            else { return_code = dispatch<single_step, limited, PagedAccess>(state, input_stream, output_stream, budget); }
+        }
+        catch (Exception exception)
+        {
+            if (limited) { stop_cores(); }
+            else { join_cores(); }
+            throw;
+        }
+
+        // Остановка для отладчика не завершает работу: дополнительные ядра продолжают выполняться.
+        if (debugging && (return_code == ReturnCode::BREAK)) { return return_code; }
+        // Бюджет ограничивает всю машину: ядра не должны работать после возврата (потоки ввода-вывода могут быть уже удалены).
+        if (limited && !debugging) { stop_cores(); }
+        else if (return_code != ReturnCode::OK) { join_cores(); }
+        return return_code;
+    }
+
+    template <bool single_step, bool limited, typename Memory>
+    Executor::ReturnCode Executor::dispatch(State& state, std::istream& input_stream, std::ostream& output_stream, uint64_t& budget)
+    {
+        // Модель кэша не совмещается с профилировщиками (проверяется при разборе аргументов).
+        if (cache_simulator != nullptr)
+        {
+            return execute<single_step, limited, false, false, SimulatedAccess<Memory>>(state, state.registers, state.flags, input_stream, output_stream, budget);
+        }
+        // Без профилировщиков переходов цикл не содержит даже проверки указателя: она мешает держать счётчики в регистрах.
+        if ((call_profiler != nullptr) || (branch_profiler != nullptr))
+        {
+            if (sampling) { return execute<single_step, limited, true, true, Memory>(state, state.registers, state.flags, input_stream, output_stream, budget); }
+            return execute<single_step, limited, false, true, Memory>(state, state.registers, state.flags, input_stream, output_stream, budget);
+        }
+        if (sampling) { return execute<single_step, limited, true, false, Memory>(state, state.registers, state.flags, input_stream, output_stream, budget); }
+        return execute<single_step, limited, false, false, Memory>(state, state.registers, state.flags, input_stream, output_stream, budget);
+    }
+
+    // Ожидание всех дополнительных ядер.
+    void Executor::join_cores()
+    {
+        for (Core& core : cores)
+        {
+            std::thread thread;
+            {
+                std::lock_guard<std::mutex> cores_lock(cores_mutex);
+                thread = std::move(core.thread);
+            }
+            if (thread.joinable())
+            {
+                thread.join();
+                running_cores.fetch_sub(1);
+            }
+            core.used = false;
+        }
+    }
+
+    // Остановка дополнительных ядер. Пока запрос действует, SPAWN не запускает новых ядер.
+    void Executor::stop_cores()
+    {
+        if (running_cores.load() == 0) { return; }
+        stopping.store(true);
+        join_cores();
+        stopping.store(false);
+    }
+
+    // Номер ядра по его регистрам.
+    size_t Executor::core_id(const State& state, const int32_t* registers) const
+    {
+        if (registers == state.registers) { return 0; }
+        for (size_t id = 1; id < cores_number; ++id)
+        {
+            if (cores[id].registers == registers) { return id; }
+        }
+        return 0;
+    }
+
+    // Основной цикл интерпретатора.
+    // Регистры, флаги и номер текущей инструкции на время выполнения хранятся в локальных переменных: регистры ядра могут
+    // совпадать по адресу с записываемыми в state.memory байтами, поэтому при работе через указатель компилятор обязан перечитывать
+    // регистры после каждой записи в память. Локальные копии возвращаются ядру только при системных вызовах, исключениях и выходе.
+    // Счётчик команд ведётся только при limited: в обычном режиме цикл не платит за проверку бюджета.
+    // Способ доступа к памяти - параметр шаблона, поэтому плотная память не платит за проверку вида памяти.
+    // Статистика команд ведётся в локальных счётчиках классов и переносится в statistics вместе с регистрами.
+    // Публикация команды (sampled) - одна запись в volatile-слово на команду.
+    // События вызовов и условных переходов (traced) передаются профилировщикам только из ветвей CALL, CALLI, RET и Jcc;
+    // дополнительные ядра их не передают.
+    template <bool single_step, bool limited, bool sampled, bool traced, typename Memory>
+    Executor::ReturnCode Executor::execute(State& state, int32_t* context_registers, uint8_t& context_flags,
+                                           std::istream& input_stream, std::ostream& output_stream, uint64_t& budget)
+    {
+        int32_t registers[State::registers_number]; // Локальная копия регистров. R14 (SR) используется напрямую отсюда.
+        uint32_t current;                            // Номер текущей инструкции (R15).
+        LazyFlags flags;                             // Регистр флагов (вычисляется по требованию).
+        uint64_t remaining = budget;                 // Оставшееся число команд (budget может совпадать по адресу с памятью).
+        uint64_t classes[Statistics::CLASSES_NUMBER] = {}; // Выполненные команды по классам, ещё не перенесённые в statistics.
+        uint64_t taken = 0;                          // Совершённые условные переходы, ещё не перенесённые в statistics.
+        #ifdef FUPM2EMU_FUZZING
+        uint32_t previous_location = 0;              // Сдвинутый адрес предыдущей команды для карты покрытия.
+        #endif
+        Memory access(state, *this);                 // Память машины.
+        CallProfiler* const calls = call_profiler;      // Профилировщик вызовов (при traced, может отсутствовать).
+        BranchProfiler* const branches = branch_profiler; // Статистика переходов (при traced, может отсутствовать).
+
+        // Запросы остановки проверяются только на переходах назад (target не после текущей команды): основное ядро
+        // проверяет interrupt, дополнительные - stopping.
+        auto interrupted = [&](uint32_t target)
+        {
+            if (target > current) { return false; }
+            if (context_registers == state.registers) { return interrupt.load(std::memory_order_relaxed); }
+            return stopping.load(std::memory_order_relaxed);
+        };
+
+        // Загрузка локальных копий из состояния.
+        auto load_state = [&]()
+        {
+            std::memcpy(registers, context_registers, sizeof(registers));
+            current = static_cast<uint32_t>(registers[State::CIR]);
+            flags.load(context_flags);
+        };
+        // Выгрузка локальных копий в состояние.
+        auto store_state = [&]()
+        {
+            registers[State::CIR] = static_cast<int32_t>(current);
+            std::memcpy(context_registers, registers, sizeof(registers));
+            context_flags = flags.store();
+            if (limited) { budget = remaining; }
+        };
+        // Число команд, выполненных с входа в цикл.
+        auto local_retired = [&]()
+        {
+            uint64_t retired = 0;
+            for (uint64_t count : classes) { retired += count; }
+            return retired;
+        };
+        // Перенос счётчиков команд в statistics - только при выходе, чтобы системные вызовы не мешали держать их в регистрах.
+        // Ядра переносят счётчики одновременно, поэтому сложение атомарное.
+        auto store_statistics = [&]()
+        {
+            if (traced && (calls != nullptr)) { calls->pause(local_retired()); }
+            for (size_t index = 0; index < Statistics::CLASSES_NUMBER; ++index)
+            {
+                __atomic_fetch_add(&statistics.classes[index], classes[index], __ATOMIC_RELAXED);
+            }
+            __atomic_fetch_add(&statistics.taken, taken, __ATOMIC_RELAXED);
+        };
+
+        load_state();
+        ReturnCode return_code = ReturnCode::OK;
+
+        try
+        {
+            do
+            {
+                // Значение R15 нужно командам, использующим его как обычный регистр.
+                const int32_t fetched = static_cast<int32_t>(current);
+                registers[State::CIR] = fetched;
+
+                #ifdef FUPM2EMU_FUZZING
+                ++coverage[(current ^ previous_location) & (coverage_size - 1)];
+                previous_location = current >> 1;
+                #endif
+
+                // Извлечение следующией команды.
+                uint32_t command = access.fetch(current);
+
+                // Код будет короче, если вычислить все возможные операнды сразу.
+                OPERATION_CODE operation = static_cast<OPERATION_CODE>((command >> 24) & 0xFF);
+                uint8_t R1 = (command >> 20) & 0xF;
+                uint8_t R2 = (command >> 16) & 0xF;
+                int32_t imm16 = command & 0x0FFFF;
+                int32_t imm20 = command & 0xFFFFF;
+
+                if (sampled) { sample = current; }
+
+                #ifdef DEBUG_OUTPUT_EXECUTION
+                std::cout << "OPCODE: " << operation << std::endl;
+                std::cout << "registers:"
+                          << " R" << static_cast<unsigned int>(R1) << ": " << registers[R1]
+                          << " R" << static_cast<unsigned int>(R2) << ": " << registers[R2] << std::endl;
+                std::cout << "Immediates: " << "imm16: " << imm16 << " imm20: " << imm20 << std::endl;
+                #endif
+
+                switch(operation)
+                {
+                    // СИСТЕМНОЕ.
+                    // HALT - выключение процессора.
+                    case HALT:
+                    {
+                        ++classes[Statistics::SYSTEM];
+                        return_code = ReturnCode::TERMINATE;
+                        break;
+                    }
+
+                    // SYSCALL - системный вызов.
+                    case SYSCALL:
+                    {
+                        ++classes[Statistics::SYSTEM];
+                        // Системный вызов работает с состоянием напрямую.
+                        store_state();
+                        return_code = syscall(state, context_registers, context_flags, R1, imm20, input_stream, output_stream);
+                        load_state();
+                        break;
+                    }
+
+                    // ЦЕЛОЧИСЛЕННАЯ АРИФМЕТИКА.
+                    // ADD - сложение регистров.
+                    case ADD:
+                    {
+                        ++classes[Statistics::ALU];
+                        registers[R1] += registers[R2] + imm16;
+                        break;
+                    }
+
+                    // ADDI - прибавление к регистру непосредственного операнда.
+                    case ADDI:
+                    {
+                        ++classes[Statistics::ALU];
+                        registers[R1] += imm20;
+                        break;
+                    }
+
+                    // SUB - разность регистров.
+                    case SUB:
+                    {
+                        ++classes[Statistics::ALU];
+                        registers[R1] -= registers[R2] + imm16;
+                        break;
+                    }
+
+                    // SUBI - вычитание из регистра непосредственного операнда.
+                    case SUBI:
+                    {
+                        ++classes[Statistics::ALU];
+                        registers[R1] -= imm20;
+                        break;
+                    }
+
+                    // MUL - произведение регистров.
+                    case MUL:
+                    {
+                        ++classes[Statistics::ALU];
+                        // Результат умножения приведёт к выходу за пределы существующих регистров.
+                        if (R1 + 1 >= State::registers_number) { throw OperationException::INVALIDREG; }
+
+                        int64_t product = static_cast<int64_t>(registers[R1]) * static_cast<int64_t>(registers[R2] + imm16);
+                        registers[R1] = int32_t(product & UINT32_MAX);
+                        registers[R1 + 1] = static_cast<int32_t>((product >> State::bits_in_word) & UINT32_MAX);
+                        break;
+                    }
+
+                    // MULI - произведение регистра на непосредственный операнд.
+                    case MULI:
+                    {
+                        ++classes[Statistics::ALU];
+                        // Результат умножения приведёт к выходу за пределы существующих регистров.
+                        if (R1 + 1 >= State::registers_number) { throw OperationException::INVALIDREG; }
+
+                        int64_t product = static_cast<int64_t>(registers[R1]) * static_cast<int64_t>(imm20);
+                        registers[R1] = static_cast<int32_t>(product & UINT32_MAX);
+                        registers[R1 + 1] = static_cast<int32_t>((product >> State::bits_in_word) & UINT32_MAX);
+                        break;
+                    }
+
+                    // DIV - частное и остаток от деления пары регистров на регистр.
+                    case DIV:
+                    {
+                        ++classes[Statistics::ALU];
+                        // Результат деления приведёт к выходу за пределы существующих регистров.
+                        if (R1 + 1 >= State::registers_number) { throw OperationException::INVALIDREG; }
+                        // Происходит деление на ноль.
+                        if (!registers[R2]) { throw OperationException::DIVBYZERO; }
+
+                        int64_t divident = static_cast<int64_t>(registers[R1] | (static_cast<int64_t>(registers[R1 + 1]) << State::bits_in_word));
+                        int64_t divider = static_cast<int64_t>(registers[R2]);
+                        int64_t product = divident / divider;
+
+                        // Результат деления не помещается в регистр. По спецификации - деление на ноль.
+                        if (product > UINT32_MAX) { throw OperationException::DIVBYZERO; }
+
+                        int64_t remainder = divident % divider;
+
+                        registers[R1] = static_cast<int32_t>(product & UINT32_MAX);
+                        registers[R1 + 1] = static_cast<int32_t>(remainder & UINT32_MAX);
+                        break;
+                    }
+
+                    // DIVI - частное и остаток от деления пары регистров на непосредственный операнд.
+                    case DIVI:
+                    {
+                        ++classes[Statistics::ALU];
+                        // Результат деления приведёт к выходу за пределы существующих регистров.
+                        if (R1 + 1 >= State::registers_number) { throw OperationException::INVALIDREG; }
+                        // Происходит деление на ноль.
+                        if (!imm20) { throw OperationException::DIVBYZERO; }
+
+                        int64_t divident = static_cast<int64_t>(registers[R1] | (static_cast<int64_t>(registers[R1 + 1]) << State::bits_in_word));
+                        int64_t divider = static_cast<int64_t>(imm20);
+                        int64_t product = divident / divider;
+
+                        // Результат деления не помещается в регистр. По спецификации - деление на ноль.
+                        if (product > UINT32_MAX) { throw OperationException::DIVBYZERO; }
+
+                        int64_t remainder = divident % divider;
+
+                        registers[R1] = static_cast<int32_t>(product & UINT32_MAX);
+                        registers[R1 + 1] = static_cast<int32_t>(remainder & UINT32_MAX);
+                        break;
+                    }
+
+                    // КОПИРОВАНИЕ В РЕГИСТРЫ.
+                    // LC - загрузка константы в регистр.
+                    case LC:
+                    {
+                        ++classes[Statistics::ALU];
+                        registers[R1] = imm20;
+                        break;
+                    }
+
+                    // MOV - пересылка из одного регистра в другой.
+                    case MOV:
+                    {
+                        ++classes[Statistics::ALU];
+                        registers[R1] = registers[R2] + imm16;
+                        break;
+                    }
+
+                    // СДВИГИ.
+                    // SHL - сдвиг влево на занчение регистра.
+                    case SHL:
+                    {
+                        ++classes[Statistics::ALU];
+                        registers[R1] <<= registers[R2] + imm16;
+                        break;
+                    }
+
+                    // SHLI - сдвиг влево на непосредственный операнд.
+                    case SHLI:
+                    {
+                        ++classes[Statistics::ALU];
+                        registers[R1] <<= imm20;
+                        break;
+                    }
+
+                    // SHR - сдвиг вправо на занчение регистра.
+                    case SHR:
+                    {
+                        ++classes[Statistics::ALU];
+                        registers[R1] >>= registers[R2] + imm16;
+                        break;
+                    }
+
+                    // SHRI - сдвиг вправо на непосредственный операнд.
+                    case SHRI:
+                    {
+                        ++classes[Statistics::ALU];
+                        registers[R1] >>= imm20;
+                        break;
+                    }
+
+                    // ЛОГИЕСКИЕ ОПЕРАЦИИ.
+                    // AND - побитовое И между регистрами.
+                    case AND:
+                    {
+                        ++classes[Statistics::ALU];
+                        registers[R1] &= registers[R2] + imm16;
+                        break;
+                    }
+
+                    // ANDI - побитовое И между регистром и непосредственным операндом.
+                    case ANDI:
+                    {
+                        ++classes[Statistics::ALU];
+                        registers[R1] &= imm20;
+                        break;
+                    }
+
+                    // OR - побитовое ИЛИ между регистрами.
+                    case OR:
+                    {
+                        ++classes[Statistics::ALU];
+                        registers[R1] |= registers[R2] + imm16;
+                        break;
+                    }
+
+                    // ORI - побитовое ИЛИ между регистром и непосредственным операндом.
+                    case ORI:
+                    {
+                        ++classes[Statistics::ALU];
+                        registers[R1] |= imm20;
+                        break;
+                    }
+
+                    // XOR - побитовое ИСКЛЮЧАЮЩЕЕ ИЛИ между регистрами.
+                    case XOR:
+                    {
+                        ++classes[Statistics::ALU];
+                        registers[R1] ^= registers[R2] + imm16;
+                        break;
+                    }
+
+                    // XORI - побитовое ИСКЛЮЧАЮЩЕЕ ИЛИ между регистром и непосредственным операндом.
+                    case XORI:
+                    {
+                        ++classes[Statistics::ALU];
+                        registers[R1] ^= imm20;
+                        break;
+                    }
+
+                    // NOT - побитовое НЕ.
+                    case NOT:
+                    {
+                        ++classes[Statistics::ALU];
+                        registers[R1] = ~(registers[R1]);
+                        break;
+                    }
+
+                    // ВЕЩЕСТВЕННАЯ АРИФМЕТИКА.
+                    // ADDD - сложение двух вещественных чисел.
+                    case ADDD:
+                    {
+                        ++classes[Statistics::DOUBLE];
+                        // Результат выполнения команды приведёт к выходу за пределы существующих регистров.
+                        if ((R1 + 1 >= State::registers_number) || (R2 + 1 >= State::registers_number)) { throw OperationException::INVALIDREG; }
+
+                        set_double(registers, R1, get_double(registers, R1) + get_double(registers, R2));
+                        break;
+                    }
+
+                    // SUBD - разность двух вещественных чисел.
+                    case SUBD:
+                    {
+                        ++classes[Statistics::DOUBLE];
+                        // Результат выполнения команды приведёт к выходу за пределы существующих регистров.
+                        if ((R1 + 1 >= State::registers_number) || (R2 + 1 >= State::registers_number)) { throw OperationException::INVALIDREG; }
+
+                        set_double(registers, R1, get_double(registers, R1) - get_double(registers, R2));
+                        break;
+                    }
+
+                    // MULD - произведение двух вещественных чисел.
+                    case MULD:
+                    {
+                        ++classes[Statistics::DOUBLE];
+                        // Результат выполнения команды приведёт к выходу за пределы существующих регистров.
+                        if ((R1 + 1 >= State::registers_number) || (R2 + 1 >= State::registers_number)) { throw OperationException::INVALIDREG; }
+
+                        set_double(registers, R1, get_double(registers, R1) * get_double(registers, R2));
+                        break;
+                    }
+
+                    // DIVD - частное от деления двух вещественных чисел.
+                    case DIVD:
+                    {
+                        ++classes[Statistics::DOUBLE];
+                        // Результат выполнения команды приведёт к выходу за пределы существующих регистров.
+                        if ((R1 + 1 >= State::registers_number) || (R2 + 1 >= State::registers_number)) { throw OperationException::INVALIDREG; }
+
+                        set_double(registers, R1, get_double(registers, R1) / get_double(registers, R2));
+                        break;
+                    }
+
+                    // ITOD - преобразование целого числа в вещественное.
+                    case ITOD:
+                    {
+                        ++classes[Statistics::DOUBLE];
+                        // Результат выполнения команды приведёт к выходу за пределы существующих регистров.
+                        if (R1 + 1 >= State::registers_number) { throw OperationException::INVALIDREG; }
+
+                        set_double(registers, R1, static_cast<double>(registers[R2]));
+                        break;
+                    }
+
+                    // DTOI - преобразование целого числа в вещественное.
+                    case DTOI:
+                    {
+                        ++classes[Statistics::DOUBLE];
+                        // Результат выполнения команды приведёт к выходу за пределы существующих регистров.
+                        if (R2 + 1 >= State::registers_number) { throw OperationException::INVALIDREG; }
+
+                        // Требуется вызвать исключение, если значение вещественного числа не помещается в регистр.
+                        double value = get_double(registers, R2);
+                        if ((value > static_cast<double>(INT32_MAX)) || (value < static_cast<double>(-INT32_MAX)))
+                        { throw OperationException::REGOVERFLOW; }
+
+                        registers[R1] = static_cast<int32_t>(value);
+                        break;
+                    }
+
+                    // СРАВНЕНИЕ.
+                    // Флаги не вычисляются: запоминаются операнды, а предикаты вычисляются командами перехода.
+                    // CMP - сравнение двух регистров.
+                    case CMP:
+                    {
+                        ++classes[Statistics::ALU];
+                        flags.compare(registers[R1], registers[R2]);
+                        break;
+                    }
+
+                    // CMPI - сравнение регистра и константы.
+                    case CMPI:
+                    {
+                        ++classes[Statistics::ALU];
+                        flags.compare(registers[R1], imm20);
+                        break;
+                    }
+
+                    // CMPD - сравнение двух вещественных чисел.
+                    case CMPD:
+                    {
+                        ++classes[Statistics::DOUBLE];
+                        // Результат выполнения команды приведёт к выходу за пределы существующих регистров.
+                        if ((R1 + 1 >= State::registers_number) || (R2 + 1 >= State::registers_number)) { throw OperationException::INVALIDREG; }
+
+                        flags.compare(get_double(registers, R1), get_double(registers, R2));
+                        break;
+                    }
+
+                    // СТЕК.
+                    // PUSH - помещение значения регистра в стек.
+                    case PUSH:
+                    {
+                        ++classes[Statistics::STACK];
+                        --registers[State::SR];
+                        access.write(registers[R1] + imm20, registers[State::SR]);
+                        break;
+                    }
+
+                    // POP - извлечение значения из стека.
+                    case POP:
+                    {
+                        ++classes[Statistics::STACK];
+                        registers[R1] = access.read(registers[State::SR]) + imm20;
+                        ++registers[State::SR];
+                        break;
+                    }
+
+                    // ФУНКЦИИ.
+                    // CALL - вызвать функцию по адресу из регистра.
+                    case CALL:
+                    {
+                        ++classes[Statistics::JUMP];
+                        // Запоминаем адрес следубщей команды.
+                        --registers[State::SR];
+                        access.write(current + 1, registers[State::SR]);
+                        if (traced && (calls != nullptr)) { calls->call(registers[R1] + imm20, current + 1, registers[State::SR], local_retired()); }
+
+                        // Передаём управление.
+                        if (interrupted(registers[R1] + imm20)) { return_code = ReturnCode::BREAK; }
+                        current = registers[R1] + imm20 - 1; // "-1" - костыль, связанный с тем, что после выполнения любой команды (даже CALL) R15 увеличивается на 1.
+                        break;
+                    }
+
+                    // CALL - вызвать функцию по адресу из непосредственного операнда.
+                    case CALLI:
+                    {
+                        ++classes[Statistics::JUMP];
+                        // Запоминаем адрес следубщей команды.
+                        --registers[State::SR];
+                        access.write(current + 1, registers[State::SR]);
+                        if (traced && (calls != nullptr)) { calls->call(imm20, current + 1, registers[State::SR], local_retired()); }
+
+                        // Передаём управление.
+                        if (interrupted(imm20)) { return_code = ReturnCode::BREAK; }
+                        current = imm20 - 1;
+                        break;
+                    }
+
+                    // RET - возврат из функции.
+                    case RET:
+                    {
+                        ++classes[Statistics::JUMP];
+                        // Получаем адрес возврата.
+                        const uint32_t target = access.read(registers[State::SR]);
+                        if (interrupted(target)) { return_code = ReturnCode::BREAK; }
+                        current = target - 1;
+                        if (traced && (calls != nullptr)) { calls->ret(current + 1, registers[State::SR], local_retired()); }
+                        ++registers[State::SR];
+
+                        // Убираем из стека аргументы функции.
+                        registers[State::SR] += imm20;
+                        break;
+                    }
+
+                    // ПЕРЕХОДЫ.
+                    // JMP - безусловный переход.
+                    case JMP:
+                    {
+                        ++classes[Statistics::JUMP];
+                        if (interrupted(imm20)) { return_code = ReturnCode::BREAK; }
+                        current = imm20 - 1; // "-1" - костыль, связанный с тем, что после выполнения любой команды (даже JMP) R15 увеличивается на 1.
+                        break;
+                    }
+
+                    // JNE - переход при флаге неравенства (!=).
+                    case JNE:
+                    {
+                        ++classes[Statistics::CONDITIONAL];
+                        const bool condition = !flags.equal();
+                        if (traced && (branches != nullptr)) { branches->branch(current, imm20, condition); }
+                        if (condition)
+                        {
+                            if (interrupted(imm20)) { return_code = ReturnCode::BREAK; }
+                            current = imm20 - 1;
+                            ++taken;
+                        }
+                        break;
+                    }
+
+                    // JEQ - переход при флаге равенства (==).
+                    case JEQ:
+                    {
+                        ++classes[Statistics::CONDITIONAL];
+                        const bool condition = flags.equal();
+                        if (traced && (branches != nullptr)) { branches->branch(current, imm20, condition); }
+                        if (condition)
+                        {
+                            if (interrupted(imm20)) { return_code = ReturnCode::BREAK; }
+                            current = imm20 - 1;
+                            ++taken;
+                        }
+                        break;
+                    }
+
+                    // JLE - переход при флаге "левый операнд меньше либо равен правому" (<=).
+                    case JLE:
+                    {
+                        ++classes[Statistics::CONDITIONAL];
+                        const bool condition = flags.less_equal();
+                        if (traced && (branches != nullptr)) { branches->branch(current, imm20, condition); }
+                        if (condition)
+                        {
+                            if (interrupted(imm20)) { return_code = ReturnCode::BREAK; }
+                            current = imm20 - 1;
+                            ++taken;
+                        }
+                        break;
+                    }
+
+                    // JL - переход при флаге "левый операнд меньше правого" (<).
+                    case JL:
+                    {
+                        ++classes[Statistics::CONDITIONAL];
+                        const bool condition = flags.less();
+                        if (traced && (branches != nullptr)) { branches->branch(current, imm20, condition); }
+                        if (condition)
+                        {
+                            if (interrupted(imm20)) { return_code = ReturnCode::BREAK; }
+                            current = imm20 - 1;
+                            ++taken;
+                        }
+                        break;
+                    }
+
+                    // JGE - переход при флаге "левый операнд больше либо равен правому" (>=).
+                    case JGE:
+                    {
+                        ++classes[Statistics::CONDITIONAL];
+                        const bool condition = !flags.less();
+                        if (traced && (branches != nullptr)) { branches->branch(current, imm20, condition); }
+                        if (condition)
+                        {
+                            if (interrupted(imm20)) { return_code = ReturnCode::BREAK; }
+                            current = imm20 - 1;
+                            ++taken;
+                        }
+                        break;
+                    }
+
+                    // JG - переход при флаге "левый операнд больше правого" (>).
+                    case JG:
+                    {
+                        ++classes[Statistics::CONDITIONAL];
+                        const bool condition = !flags.less_equal();
+                        if (traced && (branches != nullptr)) { branches->branch(current, imm20, condition); }
+                        if (condition)
+                        {
+                            if (interrupted(imm20)) { return_code = ReturnCode::BREAK; }
+                            current = imm20 - 1;
+                            ++taken;
+                        }
+                        break;
+                    }
 
-                // SUBD - разность двух вещественных чисел.
-                case SUBD:
-                {
-                    // Результат выполнения команды приведёт к выходу за пределы существующих регистров.
-                    if ((R1 + 1 >= State::registers_number) || (R2 + 1 >= State::registers_number)) { throw OperationException::INVALIDREG; }
+                    // РАБОТА С ПАМЯТЬЮ.
+                    // LOAD - загрузка значения из памяти по указанному непосредственно адресу в регистр.
+                    case LOAD:
+                    {
+                        ++classes[Statistics::MEMORY];
+                        registers[R1] = access.read(imm20);
+                        break;
+                    }
 
-                    *reinterpret_cast<double*>(state.registers + R1) -= *reinterpret_cast<double*>(state.registers + R2);
-                    break;
-                }
+                    // STORE - выгрузка значения из регистра в память по указанному непосредственно адресу.
+                    case STORE:
+                    {
+                        ++classes[Statistics::MEMORY];
+                        access.write(registers[R1], imm20);
+                        break;
+                    }
 
-                // MULD - произведение двух вещественных чисел.
-                case MULD:
-                {
-                    // Результат выполнения команды приведёт к выходу за пределы существующих регистров.
-                    if ((R1 + 1 >= State::registers_number) || (R2 + 1 >= State::registers_number)) { throw OperationException::INVALIDREG; }
+                    // LOAD2 - загрузка значения из памяти по указанному непосредственно адресу в пару регистров.
+                    case LOAD2:
+                    {
+                        ++classes[Statistics::MEMORY];
+                        // Результат выполнения команды приведёт к выходу за пределы существующих регистров.
+                        if (R1 + 1 >= State::registers_number) { throw OperationException::INVALIDREG; }
 
-                    *reinterpret_cast<double*>(state.registers + R1) *= *reinterpret_cast<double*>(state.registers + R2);
-                    break;
-                }
+                        registers[R1] = access.read(imm20);
+                        registers[R1 + 1] = access.read(imm20 + 1);
+                        break;
+                    }
 
-                // DIVD - частное от деления двух вещественных чисел.
-                case DIVD:
-                {
-                    // Результат выполнения команды приведёт к выходу за пределы существующих регистров.
-                    if ((R1 + 1 >= State::registers_number) || (R2 + 1 >= State::registers_number)) { throw OperationException::INVALIDREG; }
+                    // STORE2 - выгрузка значения из пары регистров в память по указанному непосредственно адресу.
+                    case STORE2:
+                    {
+                        ++classes[Statistics::MEMORY];
+                        // Результат выполнения команды приведёт к выходу за пределы существующих регистров.
+                        if (R1 + 1 >= State::registers_number) { throw OperationException::INVALIDREG; }
 
-                    *reinterpret_cast<double*>(state.registers + R1) /= *reinterpret_cast<double*>(state.registers + R2);
-                    break;
-                }
+                        access.write(registers[R1], imm20);
+                        access.write(registers[R1 + 1], imm20 + 1);
+                        break;
+                    }
 
-                // ITOD - преобразование целого числа в вещественное.
-                case ITOD:
-                {
-                    // Результат выполнения команды приведёт к выходу за пределы существующих регистров.
-                    if (R1 + 1 >= State::registers_number) { throw OperationException::INVALIDREG; }
+                    // LOADR - загрузка значения из памяти по указанному во втором регистре адресу в первый регистр.
+                    case LOADR:
+                    {
+                        ++classes[Statistics::MEMORY];
+                        try { registers[R1] = access.read(registers[R2] + imm16); }
+                        catch (State::Exception exception) { throw OperationException::INVALIDMEM; }
+                        break;
+                    }
 
-                    *reinterpret_cast<double*>(state.registers + R1) = static_cast<double>(state.registers[R2]);
-                    break;
-                }
+                    // STORER - выгрузка значения из регистра в память по указанному во втором регистре адресу.
+                    case STORER:
+                    {
+                        ++classes[Statistics::MEMORY];
+                        try { access.write(registers[R1], registers[R2] + imm16); }
+                        catch (State::Exception exception) { throw OperationException::INVALIDMEM; }
+                        break;
+                    }
 
-                // DTOI - преобразование целого числа в вещественное.
-                case DTOI:
-                {
-                    // Результат выполнения команды приведёт к выходу за пределы существующих регистров.
-                    if (R2 + 1 >= State::registers_number) { throw OperationException::INVALIDREG; }
+                    // LOADR2 - загрузка значения из памяти по указанному во втором регистре адресу в пару регистров.
+                    case LOADR2:
+                    {
+                        ++classes[Statistics::MEMORY];
+                        // Результат выполнения команды приведёт к выходу за пределы существующих регистров.
+                        if (R1 + 1 >= State::registers_number) { throw OperationException::INVALIDREG; }
 
-                    // Требуется вызвать исключение, если значение вещественного числа не помещается в регистр.
-                    if ( (*reinterpret_cast<double*>(state.registers + R2) > static_cast<double>(INT32_MAX)) ||
-                         (*reinterpret_cast<double*>(state.registers + R2) < static_cast<double>(-INT32_MAX)) )
-                    { throw OperationException::REGOVERFLOW; }
+                        try
+                        {
+                            registers[R1] = access.read(registers[R2] + imm16);
+                            registers[R1 + 1] = access.read(registers[R2] + imm16 + 1);
+                        }
+                        catch (State::Exception exception) { throw OperationException::INVALIDMEM; }
+                        break;
+                    }
 
-                    state.registers[R1] = static_cast<int32_t>(*reinterpret_cast<double*>(state.registers + R2));
-                    break;
-                }
+                    // STORER2 - выгрузка значения из пары регистров в память по указанному во втором регистре адресу.
+                    case STORER2:
+                    {
+                        ++classes[Statistics::MEMORY];
+                        // Результат выполнения команды приведёт к выходу за пределы существующих регистров.
+                        if (R1 + 1 >= State::registers_number) { throw OperationException::INVALIDREG; }
 
-                // СРАВНЕНИЕ.
-                // CMP - сравнение двух регистров.
-                case CMP:
-                {
-                    // Сброс флагов.
-                    state.flags &= ~(State::FlagsBits::EQUALITY);
-                    state.flags &= ~(State::FlagsBits::MAJORITY);
-                    // Судя по дизассемблеру, эти две строки при текущем выборе положения бит соптимизируется в эту: state.flags &= ~(0b11);
-
-                    // Установка флагов.
-                    state.flags |= (state.registers[R1] == state.registers[R2]) << State::FlagsBits::EQUALITY_POS;
-                    state.flags |= (state.registers[R1] <  state.registers[R2]) << State::FlagsBits::MAJORITY_POS;
-                    break;
-                }
+                        try
+                        {
+                            access.write(registers[R1], registers[R2] + imm16);
+                            access.write(registers[R1 + 1], registers[R2] + imm16 + 1);
+                        }
+                        catch (State::Exception exception) { throw OperationException::INVALIDMEM; }
+                        break;
+                    }
 
-                // CMPI - сравнение регистра и константы.
-                case CMPI:
-                {
-                    // Сброс флагов.
-                    state.flags &= ~(State::FlagsBits::EQUALITY);
-                    state.flags &= ~(State::FlagsBits::MAJORITY);
+                    // TRAP - точка останова отладчика. Команда не выполняется и не считается, R15 остаётся на ней.
+                    // Без отладчика и для дополнительных ядер это неизвестная команда: слово 0xFF... может оказаться данными.
+                    case TRAP:
+                    {
+                        if (!debugging || (context_registers != state.registers))
+                        {
+                            ++classes[Statistics::SYSTEM];
+                            return_code = ReturnCode::ERROR;
+                            break;
+                        }
+                        return_code = ReturnCode::BREAK;
+                        --current;
+                        if (limited) { ++remaining; }
+                        break;
+                    }
 
-                    // Установка флагов.
-                    state.flags |= (state.registers[R1] == imm20) << State::FlagsBits::EQUALITY_POS;
-                    state.flags |= (state.registers[R1] <  imm20) << State::FlagsBits::MAJORITY_POS;
-                    break;
+                    default:
+                    {
+                        ++classes[Statistics::SYSTEM];
+                        return_code = ReturnCode::ERROR;
+                        break;
+                    }
                 }
 
-                // СТЕК.
-                // PUSH - помещение значения регистра в стек.
-                case PUSH:
-                {
-                    --state.registers[State::SR];
-                    state.set_word(state.registers[R1] + imm20, state.registers[State::SR]);
-                    break;
-                }
+                // Команда могла записать R15 как обычный регистр - тогда это переход.
+                if (registers[State::CIR] != fetched) { current = static_cast<uint32_t>(registers[State::CIR]); }
 
-                // POP - извлечение значения из стека.
-                case POP:
-                {
-                    state.registers[R1] = state.get_word(state.registers[State::SR]) + imm20;
-                    ++state.registers[State::SR];
-                    break;
-                }
+                ++current;
+                if (limited) { --remaining; }
+            }
+            while (!single_step && (return_code == ReturnCode::OK) && (!limited || (remaining != 0)));
+        }
+        catch (OperationException exception)
+        {
+            // Состояние на момент исключения должно быть доступно эмулятору.
+            store_state();
+            store_statistics();
+            report(exception);
+        }
 
-                // ФУНКЦИИ.
-                // CALL - вызвать функцию по адресу из регистра.
-                case CALL:
-                {
-                    // Запоминаем адрес следубщей команды.
-                    --state.registers[State::SR];
-                    state.set_word(state.registers[State::CIR] + 1, state.registers[State::SR]);
+        store_state();
+        store_statistics();
+        return return_code;
+    }
 
-                    // Передаём управление.
-                    state.registers[State::CIR] = state.registers[R1] + imm20 - 1; // "-1" - костыль, связанный с тем, что после выполнения любой команды (даже CALL) R15 увеличивается на 1.
-                    break;
-                }
+    // Системный вызов.
+    Executor::ReturnCode Executor::syscall(State& state, int32_t* registers, uint8_t flags, uint8_t R1, int32_t imm20,
+                                           std::istream& input_stream, std::ostream& output_stream)
+    {
+        ReturnCode return_code = ReturnCode::OK;
 
-                // CALL - вызвать функцию по адресу из непосредственного операнда.
-                case CALLI:
-                {
-                    // Запоминаем адрес следубщей команды.
-                    --state.registers[State::SR];
-                    state.set_word(state.registers[State::CIR] + 1, state.registers[State::SR]);
+        // Ввод-вывод, файлы и динамическая память ядер сериализуются. Пока дополнительных ядер нет, блокировка не нужна.
+        std::unique_lock<std::mutex> io_lock(io_mutex, std::defer_lock);
+        if ((running_cores.load(std::memory_order_relaxed) != 0) &&
+            (((imm20 >= 100) && (imm20 <= 106)) || ((imm20 >= 120) && (imm20 <= 125)) || ((imm20 >= 130) && (imm20 <= 132))))
+        {
+            io_lock.lock();
+        }
 
-                    // Передаём управление.
-                    state.registers[State::CIR] = imm20 - 1;
-                    break;
-                }
+        switch (imm20)
+        {
+            // EXIT - выход.
+            case 0:
+            {
+                return_code = ReturnCode::TERMINATE;
+                break;
+            }
+            // SCANINT - запрос целого числа.
+            case 100:
+            {
+                input_stream >> registers[R1];
+                break;
+            }
+            // SCANDOUBLE - запрос вещественного числа.
+            case 101:
+            {
+                // Результат выполнения команды приведёт к выходу за пределы существующих регистров.
+                if (R1 + 1 >= State::registers_number) { throw OperationException::INVALIDREG; }
 
-                // RET - возврат из функции.
-                case RET:
-                {
-                    // Получаем адрес возврата.
-                    state.registers[State::CIR] = state.get_word(state.registers[State::SR]) - 1;
-                    ++state.registers[State::SR];
+                double input = 0.0;
+                input_stream >> input;
+                set_double(registers, R1, input);
+                break;
+            }
+            // PRINTINT - вывод целого числа.
+            case 102:
+            {
+                output_stream << registers[R1];
+                break;
+            }
+            // PRINTDOUBLE - вывод вещественного числа.
+            case 103:
+            {
+                // Результат выполнения команды приведёт к выходу за пределы существующих регистров.
+                if (R1 + 1 >= State::registers_number) { throw OperationException::INVALIDREG; }
 
-                    // Убираем из стека аргументы функции.
-                    state.registers[State::SR] += imm20;
-                    break;
-                }
+                output_stream << get_double(registers, R1);
+                break;
+            }
+            // PUTCHAR - вывод символа.
+            case 105:
+            {
+                output_stream.put(static_cast<uint8_t>(registers[R1]));
+                break;
+            }
+            // GETCHAR - получение символа.
+            case 106:
+            {
+                registers[R1] = static_cast<int32_t>(input_stream.get());
+                break;
+            }
+            // SPAWN - запуск ядра с адреса R1 и вершиной стека R1 + 1. Ядро получает копию регистров вызвавшего и свой номер в R1.
+            // В R1 вызвавшего возвращается номер ядра или -1, если свободных ядер нет.
+            case 110:
+            {
+                if (R1 + 1 >= State::registers_number) { throw OperationException::INVALIDREG; }
 
-                // ПЕРЕХОДЫ.
-                // JMP - безусловный переход.
-                case JMP:
+                // Таблица страниц разреженной памяти не рассчитана на одновременный доступ: дополнительные ядра недоступны.
+                if (state.backend != State::Backend::DENSE)
                 {
-                    state.registers[State::CIR] = imm20 - 1; // "-1" - костыль, связанный с тем, что после выполнения любой команды (даже JMP) R15 увеличивается на 1.
+                    registers[R1] = -1;
                     break;
                 }
 
-                // JNE - переход при флаге неравенства (!=).
-                case JNE:
+                std::lock_guard<std::mutex> cores_lock(cores_mutex);
+                if (stopping.load())
                 {
-                    if (!(state.flags & State::FlagsBits::EQUALITY)) { state.registers[State::CIR] = imm20 - 1; }
+                    registers[R1] = -1;
                     break;
                 }
-
-                // JEQ - переход при флаге равенства (==).
-                case JEQ:
+                size_t id = 1;
+                while ((id < cores_number) && cores[id].used) { ++id; }
+                if (id == cores_number)
                 {
-                    if (state.flags & State::FlagsBits::EQUALITY) { state.registers[State::CIR] = imm20 - 1; }
+                    registers[R1] = -1;
                     break;
                 }
 
-                // JLE - переход при флаге "левый операнд меньше либо равен правому" (<=).
-                case JLE:
+                Core& core = cores[id];
+                std::memcpy(core.registers, registers, sizeof(core.registers));
+                core.registers[State::CIR] = registers[R1];
+                core.registers[State::SR] = registers[R1 + 1];
+                core.registers[R1] = static_cast<int32_t>(id);
+                core.flags = flags;
+                core.parent = core_id(state, registers);
+                running_cores.fetch_add(1);
+                try
                 {
-                    if ((state.flags & State::FlagsBits::MAJORITY) || (state.flags & State::FlagsBits::EQUALITY)) { state.registers[State::CIR] = imm20 - 1; }
-                    break;
+                    core.thread = std::thread([this, &state, &core, &input_stream, &output_stream]()
+                    {
+                        core.result = run_core(state, core, input_stream, output_stream);
+                    });
                 }
-
-                // JL - переход при флаге "левый операнд меньше правого" (<).
-                case JL:
+                catch (std::system_error& error)
                 {
-                    if ((state.flags & State::FlagsBits::MAJORITY) && !(state.flags & State::FlagsBits::MAJORITY)){ state.registers[State::CIR] = imm20 - 1; }
+                    // Хост не смог создать поток: ядро не запускается.
+                    running_cores.fetch_sub(1);
+                    registers[R1] = -1;
                     break;
                 }
+                core.used = true;
+
+                registers[R1] = static_cast<int32_t>(id);
+                break;
+            }
+            // JOIN - ожидание завершения ядра с номером R1. В R1 возвращается 0 при штатном завершении ядра, иначе -1.
+            // Ожидать ядро может только запустившее его ядро, поэтому ядро не ожидает само себя, а ядра не ожидают друг друга.
+            case 111:
+            {
+                int32_t id = registers[R1];
+                registers[R1] = -1;
+                if ((id <= 0) || (static_cast<size_t>(id) >= cores_number)) { break; }
 
-                // JGE - переход при флаге "левый операнд больше либо равен правому" (>=).
-                case JGE:
+                // Поток забирается под защитой, чтобы одно ядро не ожидали дважды.
+                Core& core = cores[id];
+                std::thread thread;
                 {
-                    if (!(state.flags & State::FlagsBits::MAJORITY) || (state.flags & State::FlagsBits::EQUALITY)) { state.registers[State::CIR] = imm20 - 1; }
-                    break;
+                    std::lock_guard<std::mutex> cores_lock(cores_mutex);
+                    if (!core.used || (core.parent != core_id(state, registers))) { break; }
+                    thread = std::move(core.thread);
                 }
+                if (!thread.joinable()) { break; }
+                thread.join();
 
-                // JG - переход при флаге "левый операнд больше правого" (>).
-                case JG:
+                registers[R1] = (core.result == ReturnCode::TERMINATE) ? 0 : -1;
+                std::lock_guard<std::mutex> cores_lock(cores_mutex);
+                core.used = false;
+                // Номер ожидавшегося ядра может достаться новому ядру, поэтому запущенные им ядра переходят к основному.
+                for (Core& child : cores)
                 {
-                    if (!(state.flags & State::FlagsBits::MAJORITY) && !(state.flags & State::FlagsBits::EQUALITY)) { state.registers[State::CIR] = imm20 - 1; }
-                    break;
+                    if (child.used && (child.parent == static_cast<size_t>(id))) { child.parent = 0; }
                 }
+                running_cores.fetch_sub(1);
+                break;
+            }
+            // CAS - атомарное сравнение с обменом: слово по адресу R1 заменяется на R1 + 2, если равно R1 + 1.
+            // В R1 возвращается прежнее значение слова.
+            case 112:
+            {
+                if (R1 + 2 >= State::registers_number) { throw OperationException::INVALIDREG; }
 
-                // РАБОТА С ПАМЯТЬЮ.
-                // LOAD - загрузка значения из памяти по указанному непосредственно адресу в регистр.
-                case LOAD:
+                try
                 {
-                    state.registers[R1] = state.get_word(imm20);
-                    break;
+                    if (state.backend == State::Backend::DENSE)
+                    {
+                        registers[R1] = static_cast<int32_t>(State::compare_exchange_word(state.memory.data(), state.dirty_pages.data(),
+                            registers[R1 + 1], registers[R1 + 2], static_cast<uint32_t>(registers[R1])));
+                    }
+                    else
+                    {
+                        // Разреженная память однопоточна.
+                        uint32_t value = state.get_word(static_cast<uint32_t>(registers[R1]));
+                        if (value == static_cast<uint32_t>(registers[R1 + 1])) { state.set_word(registers[R1 + 2], static_cast<uint32_t>(registers[R1])); }
+                        registers[R1] = static_cast<int32_t>(value);
+                    }
                 }
+                catch (State::Exception exception) { throw OperationException::INVALIDMEM; }
+                break;
+            }
+            // FETCHADD - атомарное прибавление R1 + 1 к слову по адресу R1. В R1 возвращается прежнее значение слова.
+            case 113:
+            {
+                if (R1 + 1 >= State::registers_number) { throw OperationException::INVALIDREG; }
 
-                // STORE - выгрузка значения из регистра в память по указанному непосредственно адресу.
-                case STORE:
+                try
                 {
-                    state.set_word(state.registers[R1], imm20);
-                    break;
+                    if (state.backend == State::Backend::DENSE)
+                    {
+                        registers[R1] = static_cast<int32_t>(State::fetch_add_word(state.memory.data(), state.dirty_pages.data(),
+                            registers[R1 + 1], static_cast<uint32_t>(registers[R1])));
+                    }
+                    else
+                    {
+                        uint32_t value = state.get_word(static_cast<uint32_t>(registers[R1]));
+                        state.set_word(value + registers[R1 + 1], static_cast<uint32_t>(registers[R1]));
+                        registers[R1] = static_cast<int32_t>(value);
+                    }
                 }
+                catch (State::Exception exception) { throw OperationException::INVALIDMEM; }
+                break;
+            }
+            // OPEN - открытие файла, путь к которому (по символу в слове, до нулевого слова) находится по адресу R1.
+            // Режим R1 + 1: 0 - чтение, 1 - запись с усечением, 2 - чтение и запись, 3 - дописывание. В R1 возвращается номер файла или -1.
+            case 120:
+            {
+                if (R1 + 1 >= State::registers_number) { throw OperationException::INVALIDREG; }
 
-                // LOAD2 - загрузка значения из памяти по указанному непосредственно адресу в пару регистров.
-                case LOAD2:
+                registers[R1] = open_file(state, static_cast<uint32_t>(registers[R1]), registers[R1 + 1]);
+                break;
+            }
+            // CLOSE - закрытие файла R1. В R1 возвращается 0 или -1.
+            case 121:
+            {
+                int descriptor = file_descriptor(registers[R1]);
+                if (descriptor < 0)
                 {
-                    // Результат выполнения команды приведёт к выходу за пределы существующих регистров.
-                    if (R1 + 1 >= State::registers_number) { throw OperationException::INVALIDREG; }
-
-                    state.registers[R1] = state.get_word(imm20);
-                    state.registers[R1 + 1] = state.get_word(imm20 + 1);
+                    registers[R1] = -1;
                     break;
                 }
 
-                // STORE2 - выгрузка значения из пары регистров в память по указанному непосредственно адресу.
-                case STORE2:
-                {
-                    // Результат выполнения команды приведёт к выходу за пределы существующих регистров.
-                    if (R1 + 1 >= State::registers_number) { throw OperationException::INVALIDREG; }
+                files[registers[R1]] = -1;
+                registers[R1] = (close(descriptor) == 0) ? 0 : -1;
+                break;
+            }
+            // READ, WRITE - чтение из файла R1 в память с адреса R1 + 1 (запись из памяти в файл) R1 + 2 слов.
+            // В R1 возвращается число переданных слов или -1.
+            case 122:
+            case 123:
+            {
+                if (R1 + 2 >= State::registers_number) { throw OperationException::INVALIDREG; }
 
-                    state.set_word(state.registers[R1], imm20);
-                    state.set_word(state.registers[R1 + 1], imm20 + 1);
+                registers[R1] = transfer_file(state, registers[R1], static_cast<uint32_t>(registers[R1 + 1]), registers[R1 + 2], imm20 == 122);
+                break;
+            }
+            // SEEK - перемещение позиции файла R1 на R1 + 1 слов от начала (R1 + 2 = 0), текущей позиции (1) или конца (2).
+            // В R1 возвращается новая позиция в словах или -1.
+            case 124:
+            {
+                if (R1 + 2 >= State::registers_number) { throw OperationException::INVALIDREG; }
+
+                // Другие значения R1 + 2 - ошибка программы, а не переход к концу файла.
+                int descriptor = file_descriptor(registers[R1]);
+                int origin = registers[R1 + 2];
+                int whence = (origin == 0) ? SEEK_SET : (origin == 1) ? SEEK_CUR : SEEK_END;
+                off_t position = ((descriptor < 0) || (origin < 0) || (origin > 2)) ? -1 :
+                    lseek(descriptor, static_cast<off_t>(registers[R1 + 1]) * State::bytes_in_word, whence);
+                registers[R1] = (position < 0) ? -1 : static_cast<int32_t>(position / State::bytes_in_word);
+                break;
+            }
+            // SIZE - размер файла R1 в словах (неполное последнее слово считается целым). В R1 возвращается размер или -1.
+            case 125:
+            {
+                int descriptor = file_descriptor(registers[R1]);
+                struct stat file_stat;
+                if ((descriptor < 0) || (fstat(descriptor, &file_stat) != 0))
+                {
+                    registers[R1] = -1;
                     break;
                 }
+                registers[R1] = static_cast<int32_t>((file_stat.st_size + State::bytes_in_word - 1) / State::bytes_in_word);
+                break;
+            }
+            // MALLOC - выделение R1 слов. В R1 возвращается адрес блока или 0.
+            case 130:
+            {
+                registers[R1] = static_cast<int32_t>(state.heap.allocate(static_cast<uint32_t>(registers[R1])));
+                break;
+            }
+            // FREE - освобождение блока по адресу R1 (0 допускается). В R1 возвращается 0 или -1, если блока нет.
+            case 131:
+            {
+                uint32_t address = static_cast<uint32_t>(registers[R1]);
+                registers[R1] = ((address == 0) || state.heap.release(address)) ? 0 : -1;
+                break;
+            }
+            // REALLOC - изменение размера блока R1 (0 - новый блок) до R1 + 1 слов с сохранением содержимого.
+            // В R1 возвращается адрес блока или 0 (тогда старый блок не изменяется).
+            case 132:
+            {
+                if (R1 + 1 >= State::registers_number) { throw OperationException::INVALIDREG; }
+
+                uint32_t address = static_cast<uint32_t>(registers[R1]);
+                uint32_t size = static_cast<uint32_t>(registers[R1 + 1]);
+                ++state.heap.statistics.reallocations;
 
-                // LOADR - загрузка значения из памяти по указанному во втором регистре адресу в первый регистр.
-                case LOADR:
+                // Блок помещается на прежнем месте.
+                if ((address != 0) && state.heap.resize(address, size)) { break; }
+
+                size_t old_capacity = state.heap.capacity(address);
+                if ((address != 0) && (old_capacity == 0))
                 {
-                    try { state.registers[R1] = state.get_word(state.registers[R2] + imm16); }
-                    catch (State::Exception exception) { throw OperationException::INVALIDMEM; }
+                    registers[R1] = 0;
                     break;
                 }
 
-                // STORER - выгрузка значения из регистра в память по указанному во втором регистре адресу.
-                case STORER:
+                uint32_t new_address = state.heap.allocate(size);
+                if (new_address != 0 && address != 0)
                 {
-                    try { state.set_word(state.registers[R1], state.registers[R2] + imm16); }
-                    catch (State::Exception exception) { throw OperationException::INVALIDMEM; }
-                    break;
+                    // Перенос содержимого одним копированием (блоки распределителя не пересекают конец памяти).
+                    size_t words = std::min<size_t>(old_capacity, size);
+                    if (state.backend == State::Backend::DENSE)
+                    {
+                        std::memcpy(state.memory.data() + new_address * State::bytes_in_word,
+                                    state.memory.data() + address * State::bytes_in_word, words * State::bytes_in_word);
+                        size_t first_page = new_address >> State::page_bits;
+                        size_t last_page = (new_address + words) >> State::page_bits;
+                        std::fill(state.dirty_pages.begin() + first_page, state.dirty_pages.begin() + std::min(last_page + 1, State::pages_number), 1);
+                    }
+                    else
+                    {
+                        for (size_t i = 0; i < words; ++i) { state.set_word(state.get_word(address + i), new_address + i); }
+                    }
+                    state.heap.release(address);
                 }
+                registers[R1] = static_cast<int32_t>(new_address);
+                break;
+            }
+            // Использован неспецифицированный код системного вызова.
+            default:
+            {
+                return_code = ReturnCode::ERROR;
+                break;
+            }
+        }
+
+        return return_code;
+    }
+
+    // Открытие файла внутри каталога sandbox.
+    int32_t Executor::open_file(State& state, uint32_t path_address, int32_t mode)
+    {
+        if (sandbox.empty()) { return -1; }
+
+        // Чтение пути из памяти машины.
+        static const size_t max_path_length = 4096;
+        std::string path;
+        for (size_t i = 0; i < max_path_length; ++i)
+        {
+            uint32_t symbol = state.get_word(path_address + i);
+            if (symbol == 0) { break; }
+            path.push_back(static_cast<char>(symbol & 0xFF));
+        }
+
+        // Путь должен быть относительным и состоять из имён без "..".
+        if (path.empty() || (path.front() == '/')) { return -1; }
+        std::vector<std::string> components;
+        size_t component_begin = 0;
+        while (component_begin <= path.size())
+        {
+            size_t component_end = path.find('/', component_begin);
+            if (component_end == std::string::npos) { component_end = path.size(); }
+            std::string component = path.substr(component_begin, component_end - component_begin);
+            if (component == "..") { return -1; }
+            if (!component.empty() && (component != ".")) { components.push_back(component); }
+            else if (component_end == path.size()) { return -1; } // Путь заканчивается каталогом.
+            component_begin = component_end + 1;
+        }
+
+        int flags = 0;
+        switch (mode)
+        {
+            case 0:  { flags = O_RDONLY; break; }
+            case 1:  { flags = O_WRONLY | O_CREAT | O_TRUNC; break; }
+            case 2:  { flags = O_RDWR | O_CREAT; break; }
+            case 3:  { flags = O_WRONLY | O_CREAT | O_APPEND; break; }
+            default: { return -1; }
+        }
+
+        size_t handle = 0;
+        while ((handle < files_number) && (files[handle] >= 0)) { ++handle; }
+        if (handle == files_number) { return -1; }
+
+        // Путь проходится по одному имени от каталога sandbox, символические ссылки не разрешаются (O_NOFOLLOW):
+        // иначе ссылка внутри каталога вывела бы за его пределы.
+        int directory = open(sandbox.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        for (size_t index = 0; (directory >= 0) && (index + 1 < components.size()); ++index)
+        {
+            int next = openat(directory, components[index].c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+            close(directory);
+            directory = next;
+        }
+        if (directory < 0) { return -1; }
+        int descriptor = openat(directory, components.back().c_str(), flags | O_NOFOLLOW | O_CLOEXEC, 0644);
+        close(directory);
+        if (descriptor < 0) { return -1; }
+
+        files[handle] = descriptor;
+        return static_cast<int32_t>(handle);
+    }
+
+    // Передача слов между файлом и памятью машины. Участок памяти, выходящий за её конец, продолжается с начала (как при
+    // модульной адресации) и передаётся двумя вызовами.
+    int32_t Executor::transfer_file(State& state, int32_t handle, uint32_t address, int32_t count, bool reading)
+    {
+        int descriptor = file_descriptor(handle);
+        if ((descriptor < 0) || (count < 0)) { return -1; }
+
+        #ifdef MEMORY_EXCEPTIONS
+        if (static_cast<size_t>(address) + count > state.memory_words) { throw OperationException::INVALIDMEM; }
+        #endif
+
+        const size_t space_bytes = state.memory_words * State::bytes_in_word;
+        const bool dense = (state.backend == State::Backend::DENSE);
+        size_t transferred = 0; // Передано байт.
+        size_t remaining = static_cast<size_t>(count) * State::bytes_in_word;
+        size_t position = (address & state.address_mask) * State::bytes_in_word;
+        while (remaining != 0)
+        {
+            size_t chunk = std::min(remaining, space_bytes - position);
+            uint8_t* data = nullptr;
+            if (dense) { data = state.memory.data() + position; }
+            else
+            {
+                // Разреженная память передаётся постранично (страницы выделяются и при записи в файл).
+                size_t offset = position % PagedMemory::page_bytes;
+                chunk = std::min(chunk, PagedMemory::page_bytes - offset);
+                data = state.paged.obtain(position / State::bytes_in_word) + offset;
+            }
+            ssize_t result = reading ? read(descriptor, data, chunk) : write(descriptor, data, chunk);
+            if (result < 0) { return transferred ? static_cast<int32_t>(transferred / State::bytes_in_word) : -1; }
+            if (result == 0) { break; }
+
+            if (reading && dense)
+            {
+                size_t first_page = position / (State::page_size * State::bytes_in_word);
+                size_t last_page = (position + result - 1) / (State::page_size * State::bytes_in_word);
+                std::fill(state.dirty_pages.begin() + first_page, state.dirty_pages.begin() + last_page + 1, 1);
+            }
+
+            transferred += result;
+            remaining -= result;
+            position = (position + result) % space_bytes;
+        }
+
+        // Неполное последнее слово при чтении дополняется нулями.
+        if (reading && (transferred % State::bytes_in_word))
+        {
+            size_t padding = State::bytes_in_word - transferred % State::bytes_in_word;
+            for (size_t i = 0; i < padding; ++i)
+            {
+                size_t byte = (position + i) % space_bytes;
+                if (dense) { state.memory[byte] = 0; }
+                else { state.paged.obtain(byte / State::bytes_in_word)[byte % PagedMemory::page_bytes] = 0; }
+            }
+            transferred += padding;
+        }
+
+        return static_cast<int32_t>(transferred / State::bytes_in_word);
+    }
+
+    int Executor::file_descriptor(int32_t handle) const
+    {
+        if ((handle < 0) || (static_cast<size_t>(handle) >= files_number)) { return -1; }
+        return files[handle];
+    }
+
+    // Выполнение дополнительного ядра. Ошибка машины завершает только это ядро.
+    Executor::ReturnCode Executor::run_core(State& state, Core& core, std::istream& input_stream, std::ostream& output_stream)
+    {
+        uint64_t budget = 0;
+        try
+        {
+            return execute<false, false, false, false, DenseAccess>(state, core.registers, core.flags, input_stream, output_stream, budget);
+        }
+        catch (Exception exception)
+        {
+            return ReturnCode::ERROR;
+        }
+        catch (std::exception& exception)
+        {
+            // Исключение хоста не должно выйти из потока ядра: это завершило бы весь процесс.
+            return ReturnCode::ERROR;
+        }
+    }
+
+    // Сообщение об исключении операции и преобразование его в исключение исполнителя.
+    void Executor::report(OperationException exception)
+    {
+        switch(exception)
+        {
+            case OperationException::OK: { break; }
+            case OperationException::INVALIDREG:
+            {
+                std::cerr << "[EXECUTION ERROR]: access to an invalid register." << std::endl;
+                throw Exception::INVALIDSTATE;
+                break;
+            }
+            case OperationException::INVALIDMEM:
+            {
+                std::cerr << "[EXECUTION ERROR]: access to an invalid address." << std::endl;
+                throw Exception::INVALIDSTATE;
+                break;
+            }
+            case OperationException::DIVBYZERO:
+            {
+                std::cerr << "[EXECUTION ERROR]: division by zero." << std::endl;
+                throw Exception::MACHINE;
+                break;
+            }
+            case OperationException::REGOVERFLOW:
+            {
+                std::cerr << "[EXECUTION ERROR]: register overflow." << std::endl;
+                throw Exception::MACHINE;
+                break;
+            }
+        }
+    }
+
+    // Чтение вещественного числа из пары регистров (младшее слово - в первом регистре пары).
+    inline double Executor::get_double(const int32_t* registers, uint8_t reg)
+    {
+        double value;
+        std::memcpy(&value, registers + reg, sizeof(value));
+        return value;
+    }
+
+    // Запись вещественного числа в пару регистров.
+    inline void Executor::set_double(int32_t* registers, uint8_t reg, double value)
+    {
+        std::memcpy(registers + reg, &value, sizeof(value));
+    }
+
 
-                // LOADR2 - загрузка значения из памяти по указанному во втором регистре адресу в пару регистров.
-                case LOADR2:
-                {
-                    // Результат выполнения команды приведёт к выходу за пределы существующих регистров.
-                    if (R1 + 1 >= State::registers_number) { throw OperationException::INVALIDREG; }
+    //////// LAZY FLAGS ////////
+    // Загрузка регистра флагов. Флаги переводятся в эквивалентную пару операндов сравнения:
+    // равенство - (0, 0), "меньше" - (0, 1), иначе - (1, 0).
+    inline void Executor::LazyFlags::load(uint8_t init_flags)
+    {
+        flags = init_flags;
+        compared = false;
 
-                    try
-                    {
-                        state.registers[R1] = state.get_word(state.registers[R2] + imm16);
-                        state.registers[R1 + 1] = state.get_word(state.registers[R2] + imm16 + 1);
-                    }
-                    catch (State::Exception exception) { throw OperationException::INVALIDMEM; }
-                    break;
-                }
+        left = ((init_flags & State::FlagsBits::EQUALITY) || (init_flags & State::FlagsBits::MAJORITY)) ? 0 : 1;
+        right = (!(init_flags & State::FlagsBits::EQUALITY) && (init_flags & State::FlagsBits::MAJORITY)) ? 1 : 0;
+    }
 
-                // STORER2 - выгрузка значения из пары регистров в память по указанному во втором регистре адресу.
-                case STORER2:
-                {
-                    // Результат выполнения команды приведёт к выходу за пределы существующих регистров.
-                    if (R1 + 1 >= State::registers_number) { throw OperationException::INVALIDREG; }
+    // Вычисление регистра флагов. Если сравнений не было, возвращается загруженное значение без изменений.
+    inline uint8_t Executor::LazyFlags::store() const
+    {
+        if (!compared) { return flags; }
 
-                    try
-                    {
-                        state.set_word(state.registers[R1], state.registers[R2] + imm16);
-                        state.set_word(state.registers[R1 + 1], state.registers[R2] + imm16 + 1);
-                    }
-                    catch (State::Exception exception) { throw OperationException::INVALIDMEM; }
-                    break;
-                }
+        uint8_t result = flags & ~(State::FlagsBits::EQUALITY | State::FlagsBits::MAJORITY);
+        result |= equal() << State::FlagsBits::EQUALITY_POS;
+        result |= less()  << State::FlagsBits::MAJORITY_POS;
+        return result;
+    }
 
-                default:
-                {
-                    return_code = ReturnCode::ERROR;
-                    break;
-                }
-            }
-        }
-        catch (OperationException exception)
-        {
-            switch(exception)
-            {
-                case OperationException::OK: { break; }
-                case OperationException::INVALIDREG:
-                {
-                    std::cerr << "[EXECUTION ERROR]: access to an invalid register." << std::endl;
-                    throw Exception::INVALIDSTATE;
-                    break;
-                }
-                case OperationException::INVALIDMEM:
-                {
-                    std::cerr << "[EXECUTION ERROR]: access to an invalid address." << std::endl;
-                    throw Exception::INVALIDSTATE;
-                    break;
-                }
-                case OperationException::DIVBYZERO:
-                {
-                    std::cerr << "[EXECUTION ERROR]: division by zero." << std::endl;
-                    throw Exception::MACHINE;
-                    break;
-                }
-                case OperationException::REGOVERFLOW:
-                {
-                    std::cerr << "[EXECUTION ERROR]: register overflow." << std::endl;
-                    throw Exception::MACHINE;
-                    break;
-                }
-            }
-        }
+    // Сравнение целых чисел.
+    inline void Executor::LazyFlags::compare(int32_t init_left, int32_t init_right)
+    {
+        left = init_left;
+        right = init_right;
+        compared = true;
+    }
 
-        ++(state.registers[State::CIR]);
-        return return_code;
+    // Сравнение вещественных чисел сводится к сравнению целых с тем же результатом (в том числе для NaN: ни равенства, ни "меньше").
+    inline void Executor::LazyFlags::compare(double init_left, double init_right)
+    {
+        bool is_less = init_left < init_right;
+        bool is_equal = init_left == init_right;
+        compare((is_less || is_equal) ? 0 : 1, is_less ? 1 : 0);
     }
 
+    inline bool Executor::LazyFlags::equal() const      { return left == right; }
+    inline bool Executor::LazyFlags::less() const       { return left < right; }
+    inline bool Executor::LazyFlags::less_equal() const { return left <= right; }
+
+
     // PROTECTED:
 
     // PRIVATE:
@@ -805,6 +2137,7 @@ namespace FUPM2EMU
             // Сравнение.
             {"cmp",     CMP,     RR},
             {"cmpi",    CMPI,    RI},
+            {"cmpd",    CMPD,    RR},
 
             // Переходы.
             {"jmp",     JMP,     Me},
@@ -836,6 +2169,9 @@ namespace FUPM2EMU
             // Дизассемблирование.
             code_op.insert({ std::get<1>(translation_table[index]), std::get<0>(translation_table[index]) });
             code_type.insert({ std::get<1>(translation_table[index]), std::get<2>(translation_table[index]) });
+
+            // Быстрый поиск при ассемблировании.
+            op_lookup.insert({ std::get<0>(translation_table[index]), { std::get<1>(translation_table[index]), std::get<2>(translation_table[index]) } });
         }
 
         // Таблица, связывающая имя регистра и его код.
@@ -859,371 +2195,837 @@ namespace FUPM2EMU
             {"r15", 15}
         };
 
-        // Заполнение отображений.
-        for (size_t index = 0; index < registers_table.size(); ++index)
-        {
-            // Ассемблирование.
-            reg_code.insert({ std::get<0>(registers_table[index]), std::get<1>(registers_table[index]) });
+        // Заполнение отображений.
+        for (size_t index = 0; index < registers_table.size(); ++index)
+        {
+            // Ассемблирование.
+            reg_code.insert({ std::get<0>(registers_table[index]), std::get<1>(registers_table[index]) });
+            reg_lookup.insert({ std::get<0>(registers_table[index]), std::get<1>(registers_table[index]) });
+
+            // Дизассемблирование.
+            code_reg.insert({ std::get<1>(registers_table[index]), std::get<0>(registers_table[index]) });
+        }
+    }
+    Translator::~Translator()
+    {
+        // ...
+    }
+
+    namespace
+    {
+        const uint32_t address_field = 0xFFFFF; // Поле адреса (непосредственного операнда) команды.
+
+        // Метка при последовательном ассемблировании. Пока метка не объявлена, команды, использующие её, образуют цепочку
+        // в самой памяти: поле адреса каждой такой команды хранит адрес предыдущей, address - адрес последней. Объявление
+        // проходит цепочку и подставляет адрес, поэтому память ассемблера зависит от числа меток, а не от числа ссылок на них.
+        struct Mark
+        {
+            size_t address = 0;    // Адрес объявления или последней команды цепочки.
+            size_t pending = 0;    // Число команд в цепочке.
+            bool declared = false; // Метка объявлена.
+        };
+
+        // Последовательное ассемблирование: команды пишутся прямо в память машины, адрес объявленной метки подставляется сразу.
+        struct StateOutput
+        {
+            State& state;
+            const size_t chain_limit; // Цепочки - только в командах по адресам, помещающимся в поле адреса.
+            size_t address;           // Адрес текущего записываемого слова.
+            std::unordered_map<std::string, Mark> marks;        // Метки по именам.
+            std::vector<std::pair<size_t, Mark*>> distant_uses; // Использования меток командами за пределами chain_limit.
+
+            explicit StateOutput(State& state) :
+                state(state), chain_limit(std::min<size_t>(state.memory_words, address_field + 1)), address(0) {}
+
+            // Объявление метки по текущему адресу разрешает все её прежние использования.
+            void declare(const std::string& name)
+            {
+                Mark& mark = marks[name];
+                if (!mark.declared)
+                {
+                    size_t use = mark.address;
+                    for (; mark.pending != 0; --mark.pending)
+                    {
+                        uint32_t word = state.get_word(use);
+                        state.set_word((word & ~address_field) | static_cast<uint32_t>(address), use);
+                        use = word & address_field;
+                    }
+                    mark.address = address;
+                    mark.declared = true;
+                }
+                state.symbols.insert({ static_cast<uint32_t>(address), name }); // Первая из меток одного адреса.
+            }
+
+            // Поле адреса команды, использующей метку: адрес объявленной метки или предыдущее звено цепочки использований.
+            uint32_t reference(const std::string& name)
+            {
+                Mark& mark = marks[name];
+                if (mark.declared) { return static_cast<uint32_t>(mark.address); }
+                if (address >= chain_limit)
+                {
+                    distant_uses.push_back({ address, &mark });
+                    return 0;
+                }
+
+                uint32_t link = (mark.pending != 0) ? static_cast<uint32_t>(mark.address) : 0;
+                mark.address = address;
+                ++mark.pending;
+                return link;
+            }
+
+            // Директива end (false - метка не объявлена).
+            bool entry(const std::string& name)
+            {
+                auto iterator = marks.find(name);
+                if ((iterator == marks.end()) || !iterator->second.declared) { return false; }
+                state.registers[State::CIR] = iterator->second.address;
+                return true;
+            }
+
+            void reserve() { ++address; }
+            void write(uint32_t command) { state.set_word(command, address++); }
+
+            // Разрешение дальних использований. Возвращает адрес первого использования необъявленной метки (max - таких нет).
+            size_t finish()
+            {
+                size_t first_undeclared = std::numeric_limits<size_t>::max();
+                for (const auto& use : distant_uses)
+                {
+                    if (use.second->declared) { state.set_word(state.get_word(use.first) | static_cast<uint32_t>(use.second->address), use.first); }
+                    else { first_undeclared = std::min(first_undeclared, use.first); }
+                }
+
+                // Цепочки необъявленных меток. Последнее звено цепочки - первое использование метки.
+                for (const auto& mark : marks)
+                {
+                    if (mark.second.declared || (mark.second.pending == 0)) { continue; }
+
+                    size_t use = mark.second.address;
+                    for (size_t index = 1; index < mark.second.pending; ++index) { use = state.get_word(use) & address_field; }
+                    first_undeclared = std::min(first_undeclared, use);
+                }
+                return first_undeclared;
+            }
+        };
+
+        // Часть исходного кода при параллельном ассемблировании. Адреса отсчитываются от начала части, а метка может быть
+        // объявлена в предыдущей части, поэтому все использования меток откладываются до слияния: они образуют цепочки
+        // в буфере части, как при последовательном ассемблировании.
+        struct ChunkOutput
+        {
+            // Метка части.
+            struct Symbol
+            {
+                std::string name;   // Имя.
+                size_t last = 0;    // Адрес последней команды цепочки использований.
+                size_t pending = 0; // Число команд в цепочке.
+            };
+
+            // Директива end.
+            struct Entry
+            {
+                uint32_t symbol;     // Номер метки.
+                size_t declarations; // Число объявлений части до директивы.
+                size_t address;      // Адрес директивы.
+            };
+
+            std::vector<uint32_t> words;                           // Слова части.
+            std::vector<std::pair<size_t, size_t>> reserved;       // Участки директив word [начало, конец): в память не пишутся.
+            std::unordered_map<std::string, uint32_t> numbers;     // Номера меток по именам.
+            std::vector<Symbol> symbols;                           // Метки по номерам.
+            std::vector<std::pair<size_t, uint32_t>> declarations; // Объявления (адрес, метка) в порядке исходного кода.
+            std::vector<std::pair<size_t, uint32_t>> distant_uses; // Использования (адрес, метка) за пределами поля адреса.
+            std::vector<Entry> entries;                            // Директивы end.
+            size_t address = 0;                                    // Адрес текущего записываемого слова.
+            size_t base = 0;                                       // Адрес начала части в памяти машины.
+
+            uint32_t number(const std::string& name)
+            {
+                auto iterator = numbers.find(name);
+                if (iterator != numbers.end()) { return iterator->second; }
+
+                uint32_t result = static_cast<uint32_t>(symbols.size());
+                numbers.insert({ name, result });
+                symbols.push_back(Symbol{ name, 0, 0 });
+                return result;
+            }
+
+            void declare(const std::string& name) { declarations.push_back({ address, number(name) }); }
+
+            uint32_t reference(const std::string& name)
+            {
+                uint32_t index = number(name);
+                if (address > address_field)
+                {
+                    distant_uses.push_back({ address, index });
+                    return 0;
+                }
+
+                Symbol& symbol = symbols[index];
+                uint32_t link = (symbol.pending != 0) ? static_cast<uint32_t>(symbol.last) : 0;
+                symbol.last = address;
+                ++symbol.pending;
+                return link;
+            }
+
+            // Директива end проверяется при слиянии, когда известны объявления предыдущих частей.
+            bool entry(const std::string& name)
+            {
+                entries.push_back(Entry{ number(name), declarations.size(), address });
+                return true;
+            }
+
+            void reserve()
+            {
+                if (!reserved.empty() && (reserved.back().second == address)) { ++reserved.back().second; }
+                else { reserved.push_back({ address, address + 1 }); }
+                words.push_back(0);
+                ++address;
+            }
+
+            void write(uint32_t command)
+            {
+                words.push_back(command);
+                ++address;
+            }
+        };
+
+        // Выполнение task(0), ..., task(count - 1) в отдельных потоках (task(0) - в вызывающем). Исключение задачи передаётся
+        // вызывающему после завершения всех потоков.
+        template <typename Task>
+        void run_parallel(size_t count, const Task& task)
+        {
+            std::vector<std::exception_ptr> failures(count);
+            auto guarded = [&](size_t index)
+            {
+                try { task(index); }
+                catch (...) { failures[index] = std::current_exception(); }
+            };
+
+            std::vector<std::thread> workers;
+            for (size_t index = 1; index < count; ++index) { workers.emplace_back(guarded, index); }
+            if (count != 0) { guarded(0); }
+            for (std::thread& worker : workers) { worker.join(); }
+
+            for (const std::exception_ptr& failure : failures)
+            {
+                if (failure) { std::rethrow_exception(failure); }
+            }
+        }
+    }
+
+    // Лексемы ассемблерного кода (слова, разделённые пробельными символами). Поток читается блоками, поэтому память не зависит
+    // от размера исходного кода; лексема, разрезанная границей блока, собирается в carry. Исходный код в памяти читается
+    // без копирования.
+    class Translator::TokenReader
+    {
+    public:
+        explicit TokenReader(std::istream& input_stream) :
+            input_stream(&input_stream), storage(block_size), data(storage.data()), begin(0), end(0) {}
+        TokenReader(const char* text, size_t size) :
+            input_stream(nullptr), data(text), begin(0), end(size) {}
+
+        // Следующая лексема (false - конец ввода). Представление действительно до следующего вызова.
+        bool next(std::string_view& token)
+        {
+            // Пропуск пробельных символов.
+            while (true)
+            {
+                while ((begin < end) && space(data[begin])) { ++begin; }
+                if (begin < end) { break; }
+                if (!fill()) { return false; }
+            }
+
+            carry.clear();
+            size_t first = begin;
+            while (true)
+            {
+                while ((begin < end) && !space(data[begin])) { ++begin; }
+                if (begin < end) { break; }
+
+                carry.append(data + first, begin - first);
+                bool more = fill();
+                first = begin;
+                if (!more) { break; }
+            }
+
+            if (carry.empty()) { token = std::string_view(data + first, begin - first); }
+            else
+            {
+                carry.append(data + first, begin - first);
+                token = carry;
+            }
+            return true;
+        }
+
+        // Пропуск ввода до конца строки (включая символ новой строки).
+        void skip_line()
+        {
+            while (true)
+            {
+                const char* found = static_cast<const char*>(std::memchr(data + begin, '\n', end - begin));
+                if (found != nullptr)
+                {
+                    begin = static_cast<size_t>(found - data) + 1;
+                    return;
+                }
+                if (!fill()) { return; }
+            }
+        }
+
+    protected:
+        static const size_t block_size = 1 << 16; // Размер блока ввода.
+
+        // Чтение следующего блока (false - конец ввода).
+        bool fill()
+        {
+            begin = end;
+            if (input_stream == nullptr) { return false; }
+
+            begin = 0;
+            end = static_cast<size_t>(std::max<std::streamsize>(input_stream->rdbuf()->sgetn(storage.data(), block_size), 0));
+            return end != 0;
+        }
+
+        // Пробельный символ (как у operator>>).
+        static bool space(char symbol)
+        {
+            return (symbol == ' ') || (symbol == '\n') || (symbol == '\t') || (symbol == '\r') || (symbol == '\v') || (symbol == '\f');
+        }
+
+        // Данные.
+        std::istream* input_stream; // Поток исходного кода (nullptr - исходный код в памяти).
+        std::vector<char> storage;  // Текущий блок потока.
+        const char* data;           // Текущий блок.
+        size_t begin;               // Начало непрочитанной части блока.
+        size_t end;                 // Конец блока.
+        std::string carry;          // Лексема, начатая в предыдущем блоке.
+    };
+
+    int Translator::assemble(std::istream& input_stream, FUPM2EMU::State& state) const
+    {
+        TokenReader reader(input_stream);
+        try { assemble_serial(reader, state); }
+        catch (AssemblingException exception)
+        {
+            report(exception);
+            throw Exception::ASSEMBLING;
+        }
+        return 0;
+    }
+
+    int Translator::assemble(std::istream& input_stream, FUPM2EMU::State& state, unsigned int threads) const
+    {
+        if (threads == 0) { threads = std::max(std::thread::hardware_concurrency(), 1u); }
+        if (threads == 1) { return assemble(input_stream, state); }
+
+        // Исходный код целиком.
+        std::string source;
+        {
+            std::vector<char> block(1 << 16);
+            std::streamsize count = 0;
+            while ((count = input_stream.rdbuf()->sgetn(block.data(), static_cast<std::streamsize>(block.size()))) > 0)
+            {
+                source.append(block.data(), static_cast<size_t>(count));
+            }
+        }
+
+        // Части примерно равного размера, границы - после символов новой строки.
+        std::vector<std::pair<size_t, size_t>> parts;
+        for (size_t begin = 0, part = 1; begin < source.size(); ++part)
+        {
+            size_t end = source.size();
+            if (part < threads)
+            {
+                end = source.find('\n', std::max(begin, source.size() / threads * part));
+                end = (end == std::string::npos) ? source.size() : end + 1;
+            }
+            parts.push_back({ begin, end });
+            begin = end;
+        }
+
+        std::vector<ChunkOutput> chunks(parts.size());
+        std::vector<AssemblingException> errors(parts.size(), AssemblingException(0, AssemblingException::Code::OK));
+        run_parallel(parts.size(), [&](size_t index)
+        {
+            TokenReader reader(source.data() + parts[index].first, parts[index].second - parts[index].first);
+            try { assemble_tokens(reader, chunks[index]); }
+            catch (AssemblingException exception) { errors[index] = exception; }
+        });
+
+        // Оператор, продолжающийся в следующей части (аргументы перенесены на другую строку), и образ больше памяти
+        // (адреса переходят через конец памяти) разбираются последовательно.
+        size_t total = 0;
+        bool serial = false;
+        for (size_t index = 0; index < chunks.size(); ++index)
+        {
+            total += chunks[index].address;
+            AssemblingException::Code code = errors[index].code;
+            if ((index + 1 < chunks.size()) && ((code == AssemblingException::Code::REG_EXPECTED) ||
+                (code == AssemblingException::Code::IMM_EXPECTED) || (code == AssemblingException::Code::ADDR_EXPECTED) ||
+                (code == AssemblingException::Code::MARK_EXPECTED)))
+            {
+                serial = true;
+            }
+        }
+        if (serial || (total > state.memory_words))
+        {
+            TokenReader reader(source.data(), source.size());
+            try { assemble_serial(reader, state); }
+            catch (AssemblingException exception)
+            {
+                report(exception);
+                throw Exception::ASSEMBLING;
+            }
+            return 0;
+        }
+
+        try
+        {
+            // Слияние меток в порядке исходного кода: объявленной считается первая, директива end видит только объявления до неё.
+            state.symbols.clear();
+            std::unordered_map<std::string_view, size_t> addresses; // Адреса меток (имена хранятся в частях).
+            size_t declarations = 0;
+            for (const ChunkOutput& chunk : chunks) { declarations += chunk.declarations.size(); }
+            addresses.reserve(declarations);
+
+            size_t base = 0;
+            for (size_t index = 0; index < chunks.size(); ++index)
+            {
+                ChunkOutput& chunk = chunks[index];
+                chunk.base = base;
+
+                size_t declared = 0;
+                auto declare = [&](size_t count)
+                {
+                    for (; declared < count; ++declared)
+                    {
+                        const std::string& name = chunk.symbols[chunk.declarations[declared].second].name;
+                        size_t address = base + chunk.declarations[declared].first;
+                        addresses.insert({ name, address });
+                        state.symbols.emplace_hint(state.symbols.end(), static_cast<uint32_t>(address), name); // Адреса возрастают.
+                    }
+                };
+
+                for (const auto& entry : chunk.entries)
+                {
+                    declare(entry.declarations);
+                    auto iterator = addresses.find(chunk.symbols[entry.symbol].name);
+                    if (iterator == addresses.end())
+                    {
+                        throw AssemblingException(base + entry.address, AssemblingException::Code::UNDECLARED_MARK);
+                    }
+                    state.registers[State::CIR] = iterator->second;
+                }
+                declare(chunk.declarations.size());
+
+                if (errors[index].code != AssemblingException::Code::OK)
+                {
+                    throw AssemblingException(base + errors[index].address, errors[index].code);
+                }
+                base += chunk.address;
+            }
+
+            // Подстановка адресов меток в части (параллельно) и перевод слов в порядок байт памяти машины.
+            std::vector<size_t> first_undeclared(chunks.size(), std::numeric_limits<size_t>::max());
+            run_parallel(chunks.size(), [&](size_t index)
+            {
+                ChunkOutput& chunk = chunks[index];
+                size_t& first = first_undeclared[index];
+                for (const auto& symbol : chunk.symbols)
+                {
+                    auto iterator = addresses.find(symbol.name);
+                    size_t use = symbol.last;
+                    for (size_t count = 1; count <= symbol.pending; ++count)
+                    {
+                        uint32_t word = chunk.words[use];
+                        if (iterator != addresses.end())
+                        {
+                            chunk.words[use] = (word & ~address_field) | static_cast<uint32_t>(iterator->second);
+                        }
+                        else if (count == symbol.pending) { first = std::min(first, chunk.base + use); }
+                        use = word & address_field;
+                    }
+                }
+                for (const auto& use : chunk.distant_uses)
+                {
+                    auto iterator = addresses.find(chunk.symbols[use.second].name);
+                    if (iterator != addresses.end()) { chunk.words[use.first] |= static_cast<uint32_t>(iterator->second); }
+                    else { first = std::min(first, chunk.base + use.first); }
+                }
+
+                for (uint32_t& word : chunk.words) { word = State::from_big_endian(word); }
+            });
+
+            size_t first = std::numeric_limits<size_t>::max();
+            for (size_t address : first_undeclared) { first = std::min(first, address); }
+            if (first != std::numeric_limits<size_t>::max()) { throw AssemblingException(first, AssemblingException::Code::UNDECLARED_MARK); }
+
+            // Копирование частей в память без участков директив word.
+            for (const ChunkOutput& chunk : chunks)
+            {
+                size_t from = 0;
+                for (const auto& range : chunk.reserved)
+                {
+                    state.store_words(chunk.words.data() + from, chunk.base + from, range.first - from);
+                    from = range.second;
+                }
+                state.store_words(chunk.words.data() + from, chunk.base + from, chunk.words.size() - from);
+            }
+        }
+        catch (AssemblingException exception)
+        {
+            report(exception);
+            throw Exception::ASSEMBLING;
+        }
+
+        state.registers[State::SR] = state.memory_words - 1;  // Размещение стека в конце памяти.
+        state.reset_heap(total);                               // Динамическая память - после образа программы.
+        return 0;
+    }
+
+    int Translator::disassemble(const State& state, std::ostream& output_stream) const
+    {
+        size_t address = 0; // Текущий адрес.
+        uint32_t word = 0;  // Считанное слово.
+
+        // Проход по всей памяти.
+        while (address < state.memory_words)
+        {
+            // Цикл вывода непустой части памяти.
+            while (address < state.memory_words)
+            {
+                // Чтение слова по текущему адресу.
+                word = state.get_word(address);
+
+                // Вывод команды или слова.
+                output_stream << disassemble(word) << std::endl;
+
+                ++address;
+                // Выход из цикла после первого пустого слова.
+                if (!word) { break; }
+            }
+
+            // Цикл пропуска пустой части памяти.
+            while (address < state.memory_words)
+            {
+                // Невыделенные страницы разреженной памяти пропускаются целиком.
+                if ((state.backend == State::Backend::SPARSE) && (state.paged.find(address) == nullptr))
+                {
+                    address = (address | (PagedMemory::page_words - 1)) + 1;
+                    continue;
+                }
+
+                // Чтение слова по текущему адресу.
+                word = state.get_word(address);
+
+                // Если слово вдруг оказалось непустым, выходим из цикла.
+                if (word) { break; }
+                ++address;
+            }
+        }
 
-            // Дизассемблирование.
-            code_reg.insert({ std::get<1>(registers_table[index]), std::get<0>(registers_table[index]) });
+        return 0;
+    }
+
+    std::string Translator::disassemble(uint32_t word) const
+    {
+        // Код будет короче, если вычислить все возможные операнды сразу.
+        OPERATION_CODE operation = OPERATION_CODE((word >> 24) & 0xFF);
+        uint8_t R1 = (word >> 20) & 0xF;
+        uint8_t R2 = (word >> 16) & 0xF;
+        int32_t imm16 = word & 0x0FFFF;
+        int32_t imm20 = word & 0xFFFFF;
+
+        // Два варианта: либо считана команда, либо нет.
+        auto iterator = code_op.find(operation);
+        if (iterator == code_op.end()) { return std::to_string(word); }
+
+        // Имя команды и аргументы.
+        std::string text = iterator->second;
+        switch (code_type.at(operation))
+        {
+            case RI:
+            {
+                text += " " + code_reg.at(R1) + " " + std::to_string(imm20);
+                break;
+            }
+            case RR:
+            {
+                text += " " + code_reg.at(R1) + " " + code_reg.at(R2) + " " + std::to_string(imm16);
+                break;
+            }
+            case RM:
+            {
+                text += " " + code_reg.at(R1) + " " + std::to_string(imm20);
+                break;
+            }
+            case Me:
+            {
+                text += " " + std::to_string(imm20);
+                break;
+            }
+            case Im:
+            {
+                text += " " + std::to_string(imm20);
+                break;
+            }
         }
+        return text;
     }
-    Translator::~Translator()
+
+    std::string Translator::operation_name(uint8_t code) const
     {
-        // ...
+        auto iterator = code_op.find(static_cast<OPERATION_CODE>(code));
+        if (iterator == code_op.end()) { return std::to_string(code); }
+        return iterator->second;
     }
 
-    int Translator::assemble(std::istream& input_stream, FUPM2EMU::State& state) const
+    // PROTECTED:
+
+    bool Translator::parse_unsigned(std::string_view token, uint32_t& value, size_t address, AssemblingException::Code code)
     {
-        size_t write_address = 0; // Адрес текущего записываемого слова в state.
-        std::string input;        // Строка для считывания слов из входного файла.
-        std::map<std::string, size_t> marks_addresses;          // Адреса объявленных меток (название - адрес).
-        std::vector<std::pair<size_t, std::string>> used_marks; // Адреса команд, использовавших метки, и имена этих меток.
+        uint64_t result = 0;
+        for (char symbol : token)
+        {
+            if ((symbol < '0') || (symbol > '9')) { return false; }
+            result = result * 10 + static_cast<uint64_t>(symbol - '0');
+            if (result > static_cast<uint64_t>(std::numeric_limits<int32_t>::max())) { throw AssemblingException(address, code); }
+        }
+        value = static_cast<uint32_t>(result);
+        return true;
+    }
 
-        enum class ParserState
+    int32_t Translator::parse_signed(std::string_view token, size_t address)
+    {
+        size_t index = 0;
+        bool negative = false;
+        if ((token[0] == '+') || (token[0] == '-'))
         {
-            IN_CODE    = 0,
-            IN_COMMENT = 1,
-        };
-        ParserState current_state = ParserState::IN_CODE;
+            negative = (token[0] == '-');
+            ++index;
+        }
+        if ((index == token.size()) || (token[index] < '0') || (token[index] > '9'))
+        {
+            throw AssemblingException(address, AssemblingException::Code::IMM_EXPECTED);
+        }
 
-        try
+        // Как у std::stoi: разбор до первой не цифры.
+        int64_t result = 0;
+        for (; (index < token.size()) && (token[index] >= '0') && (token[index] <= '9'); ++index)
         {
-            // Чтение идёт до конца файла.
-            while (!input_stream.eof())
+            result = result * 10 + (token[index] - '0');
+            if (result > static_cast<int64_t>(std::numeric_limits<int32_t>::max()) + 1)
             {
-                switch(current_state)
-                {
-                    // В коде.
-                    case ParserState::IN_CODE:
-                    {
-                        // Считываем строку-слово.
-                        if (!(input_stream >> input)) { break; } // Проверка на успешность чтения.
-                        if (!input.size()) { break; }            // Проверка строки на пустоту.
-
-                        #ifdef DEBUG_OUTPUT_ASSEMBLING
-                        std::cout << "Command/mark:" << input << std::endl;
-                        #endif
-
-                        // Начинается на ";" - входим в состояние "в комментарии" (до новой строки)
-                        if (input[0] == ';')
-                        {
-                            current_state = ParserState::IN_COMMENT;
-                            break;
-                        }
+                throw AssemblingException(address, AssemblingException::Code::BIG_IMM);
+            }
+        }
+        if (negative) { result = -result; }
+        if (result > std::numeric_limits<int32_t>::max()) { throw AssemblingException(address, AssemblingException::Code::BIG_IMM); }
+        return static_cast<int32_t>(result);
+    }
 
-                        // Если слово оканчивается на ':', оно является меткой.
-                        if (input[input.size() - 1] == ':')
-                        {
-                            input.pop_back(); // Удаляем последний символ - ':'.
-                            marks_addresses.insert({ input, write_address });
-                            break;
-                        }
+    template <typename Output>
+    void Translator::assemble_tokens(TokenReader& reader, Output& output) const
+    {
+        std::string_view token; // Текущая лексема.
+        std::string name;       // Лексема для поиска в таблицах (память выделяется один раз на самую длинную лексему).
 
-                        // Если встретилась директива "word", просто оставляем слово по текущему адресу свободным.
-                        if (input == "word")
-                        {
-                            ++write_address;
-                            break;
-                        }
+        // Лексема в name.
+        auto key = [&name](std::string_view text) -> const std::string& { return name.assign(text.data(), text.size()); };
 
-                        // Если встретилась директива "end", запоминаем метку старта программы. Так как эта директива обязана быть в конце программы,
-                        // к моменту её чтения метка уже точно должна существовать. Тогда можно сразу проинициализировать нужным значением регистр R15.
-                        if (input == "end")
-                        {
-                            if (!(input_stream >> input)) { throw AssemblingException(write_address, AssemblingException::Code::MARK_EXPECTED); } // Чтение имени метки.
-                            try { state.registers[State::CIR] = marks_addresses.at(input); }
-                            catch (const std::out_of_range&) { throw AssemblingException(write_address, AssemblingException::Code::UNDECLARED_MARK); }
-                            break;
-                        }
+        // Чтение обязательного аргумента.
+        auto expect = [&](AssemblingException::Code code)
+        {
+            if (!reader.next(token)) { throw AssemblingException(output.address, code); }
+        };
 
+        // Код регистра-аргумента.
+        auto register_code = [&]() -> uint32_t
+        {
+            auto iterator = reg_lookup.find(key(token));
+            if (iterator == reg_lookup.end()) { throw AssemblingException(output.address, AssemblingException::Code::REG_CODE); }
+            return static_cast<uint32_t>(iterator->second);
+        };
 
-                        // К этому моменту уже точно известно, что считанное слово должно быть именем операции. Тогда начинаем разбирать её и её аргументы.
-                        uint32_t command = 0; // Создаём переменную для записываемого слова команды.
+        // Число или метка в поле адреса команды.
+        auto address_operand = [&](uint32_t& command, AssemblingException::Code code)
+        {
+            uint32_t value = 0;
+            if (parse_unsigned(token, value, output.address, code)) { command |= value & address_field; }
+            else { command |= output.reference(key(token)); }
+        };
 
-                        // Парсим операцию.
-                        try {command |= op_code.at(input) << (bits_in_command - bits_in_op_code); }
-                        catch (const std::out_of_range&) { throw AssemblingException(write_address, AssemblingException::Code::OP_CODE); }
+        // Чтение идёт до конца файла.
+        while (reader.next(token))
+        {
+            #ifdef DEBUG_OUTPUT_ASSEMBLING
+            std::cout << "Command/mark:" << token << std::endl;
+            #endif
 
-                        // Парсим аргументы.
-                        switch(op_type.at(input))
-                        {
-                            // Регистр и непосредственный операнд.
-                            case RI:
-                            {
-                                // Регистр.
-                                if (!(input_stream >> input)) { throw AssemblingException(write_address, AssemblingException::Code::REG_EXPECTED); }
-                                try { command |= reg_code.at(input) << (bits_in_command - bits_in_op_code - bits_in_reg_code); }
-                                catch (const std::out_of_range&) { throw AssemblingException(write_address, AssemblingException::Code::REG_CODE); }
-
-                                // Непосредственный операнд.
-                                if (!(input_stream >> input)) { throw AssemblingException(write_address, AssemblingException::Code::IMM_EXPECTED); }
-
-                                // Проверка, число это, или метка.
-                                // Если число, сразу подставляем значение, если метка - запоминаем адрес команды для последующей подстановки адреса метки.
-                                if (input.find_first_not_of("0123456789") == std::string::npos)
-                                {
-                                    try { command |= (std::stoi(input) & 0xFFFFF); }
-                                    catch (const std::out_of_range&) { throw AssemblingException::Code::BIG_IMM; };
-                                }
-                                else { used_marks.push_back(std::pair<size_t, std::string>(write_address, input)); }
-                                break;
-                            }
-
-                            // Два регистра и короткий непосредственный операнд.
-                            case RR:
-                            {
-                                // Первый регистр.
-                                if (!(input_stream >> input)) { throw AssemblingException(write_address, AssemblingException::Code::REG_EXPECTED); }
-                                try { command |= reg_code.at(input) << (bits_in_command - bits_in_op_code - bits_in_reg_code); }
-                                catch (const std::out_of_range&) { throw AssemblingException(write_address, AssemblingException::Code::REG_CODE); }
-
-                                // Второй регистр.
-                                if (!(input_stream >> input)) { throw AssemblingException(write_address, AssemblingException::Code::REG_EXPECTED); }
-                                try { command |= reg_code.at(input) << (bits_in_command - bits_in_op_code - bits_in_reg_code - bits_in_reg_code); }
-                                catch (const std::out_of_range&) { throw AssemblingException(write_address, AssemblingException::Code::REG_CODE); }
-
-                                // Непосредственный операнд.
-                                if (!(input_stream >> input)) { throw AssemblingException(write_address, AssemblingException::Code::IMM_EXPECTED); }
-                                // Перевод ввода в число и запись в конец слова.
-                                try { command |= (std::stoi(input) & 0x0FFFF); } // 16 бит на короткий Imm.
-                                catch (const std::out_of_range&) { throw AssemblingException::Code::BIG_IMM; };
-                                break;
-                            }
-
-                            // Регистр и адрес.
-                            case RM:
-                            {
-                                // Регистр.
-                                if (!(input_stream >> input)) { throw AssemblingException(write_address, AssemblingException::Code::REG_EXPECTED); }
-                                try { command |= reg_code.at(input) << (bits_in_command - bits_in_op_code - bits_in_reg_code); }
-                                catch (const std::out_of_range&) { throw AssemblingException(write_address, AssemblingException::Code::REG_CODE); }
-
-                                // Непосредственный операнд - адрес.
-                                if (!(input_stream >> input)) { throw AssemblingException(write_address, AssemblingException::Code::ADDR_EXPECTED); }
-
-                                // Проверка, число это, или метка.
-                                // Если число, сразу подставляем адрес, если метка - запоминаем адрес команды для последующей подстановки адреса метки.
-                                if (input.find_first_not_of("0123456789") == std::string::npos)
-                                {
-                                    try { command |= (std::stoi(input) & 0xFFFFF); }
-                                    catch (const std::out_of_range&) { throw AssemblingException::Code::BIG_ADDR; };
-                                }
-                                else { used_marks.push_back(std::pair<size_t, std::string>(write_address, input)); }
-                                break;
-                            }
-
-                            // Адрес.
-                            case Me:
-                            {
-                                // Непосредственный операнд - адрес.
-                                if (!(input_stream >> input)) { throw AssemblingException(write_address, AssemblingException::Code::ADDR_EXPECTED); }
-
-                                // Проверка, число это, исли метка.
-                                // Если число, сразу подставляем адрес, если метка - запоминаем адрес команды для последующей подстановки адреса метки.
-                                if (input.find_first_not_of("0123456789") == std::string::npos)
-                                {
-                                    try { command |= (std::stoi(input) & 0xFFFFF); }
-                                    catch (const std::out_of_range&) { throw AssemblingException::Code::BIG_ADDR; };
-                                }
-                                else { used_marks.push_back(std::pair<size_t, std::string>(write_address, input)); }
-                                break;
-                            }
-
-                            // Непосредственный операнд.
-                            case Im:
-                            {
-                                // Непосредственный операнд - число.
-                                if (!(input_stream >> input)) { throw AssemblingException(write_address, AssemblingException::Code::IMM_EXPECTED); }
-
-                                // Проверка, число это, исли метка.
-                                // Если число, сразу подставляем значение, если метка - запоминаем адрес команды для последующей подстановки адреса метки.
-                                if (input.find_first_not_of("0123456789") == std::string::npos)
-                                {
-                                    try { command |= (std::stoi(input) & 0xFFFFF); }
-                                    catch (const std::out_of_range&) { throw AssemblingException::Code::BIG_IMM; };
-                                }
-                                else { used_marks.push_back(std::pair<size_t, std::string>(write_address, input)); }
-                                break;
-                            }
-                        }
+            // Начинается на ";" - комментарий до новой строки.
+            if (token[0] == ';')
+            {
+                reader.skip_line();
+                continue;
+            }
 
-                        // Запись слова.
-                        state.set_word(command, write_address);
-                        ++write_address;
-                        break;
-                    }
+            // Если слово оканчивается на ':', оно является меткой.
+            if (token.back() == ':')
+            {
+                output.declare(key(token.substr(0, token.size() - 1)));
+                continue;
+            }
 
-                    // В комментарии.
-                    case ParserState::IN_COMMENT:
-                    {
-                        input_stream.ignore (std::numeric_limits<std::streamsize>::max(), '\n'); // Пропускаем ввод до первого символа новой строки.
-                        current_state = ParserState::IN_CODE;
-                        break;
-                    }
-                }
+            // Если встретилась директива "word", просто оставляем слово по текущему адресу свободным.
+            if (token == "word")
+            {
+                output.reserve();
+                continue;
             }
 
-            // Теперь проходим по всем использованным меткам и подставляем адреса.
-            for (size_t index = 0; index < used_marks.size(); ++index)
+            // Если встретилась директива "end", запоминаем метку старта программы. Так как эта директива обязана быть в конце программы,
+            // к моменту её чтения метка уже точно должна существовать. Тогда можно сразу проинициализировать нужным значением регистр R15.
+            if (token == "end")
             {
-                // Читаем слово-команду, вставляем адрес и записываем.
-                uint32_t word = state.get_word(used_marks[index].first);
-                try { word |= marks_addresses.at(used_marks[index].second); }
-                catch (const std::out_of_range&) { throw AssemblingException(used_marks[index].first, AssemblingException::Code::UNDECLARED_MARK); }
-                state.set_word(word, used_marks[index].first);
+                expect(AssemblingException::Code::MARK_EXPECTED); // Чтение имени метки.
+                if (!output.entry(key(token))) { throw AssemblingException(output.address, AssemblingException::Code::UNDECLARED_MARK); }
+                continue;
             }
-        }
-        catch (AssemblingException exception)
-        {
-            std::cerr << "[TRANSLATOR ERROR]: error assembling command " << exception.address + 1 << "." << std::endl;
-            switch(exception.code)
+
+            // К этому моменту уже точно известно, что считанное слово должно быть именем операции. Тогда начинаем разбирать её и её аргументы.
+            auto operation = op_lookup.find(key(token));
+            if (operation == op_lookup.end()) { throw AssemblingException(output.address, AssemblingException::Code::OP_CODE); }
+            uint32_t command = static_cast<uint32_t>(operation->second.first) << (bits_in_command - bits_in_op_code);
+
+            // Парсим аргументы.
+            switch (operation->second.second)
             {
-                case AssemblingException::Code::OK: { break; }
-                case AssemblingException::Code::OP_CODE:
-                {
-                    std::cerr << "Unknown operation code." << std::endl;
-                    break;
-                }
-                case AssemblingException::Code::REG_CODE:
-                {
-                    std::cerr << "Unknown register name." << std::endl;
-                    break;
-                }
-                case AssemblingException::Code::REG_EXPECTED:
-                {
-                    std::cerr << "Register argument was expected but was not specified." << std::endl;
-                    break;
-                }
-                case AssemblingException::Code::IMM_EXPECTED:
+                // Регистр и непосредственный операнд (число или метка).
+                case RI:
                 {
-                    std::cerr << "Immediate argument was expected but was not specified." << std::endl;
+                    expect(AssemblingException::Code::REG_EXPECTED);
+                    command |= register_code() << (bits_in_command - bits_in_op_code - bits_in_reg_code);
+                    expect(AssemblingException::Code::IMM_EXPECTED);
+                    address_operand(command, AssemblingException::Code::BIG_IMM);
                     break;
                 }
-                case AssemblingException::Code::ADDR_EXPECTED:
-                {
-                    std::cerr << "address was expected but was not specified." << std::endl;
-                    break;
-                }
-                case AssemblingException::Code::MARK_EXPECTED:
+
+                // Два регистра и короткий непосредственный операнд (16 бит, со знаком).
+                case RR:
                 {
-                    std::cerr << "Mark argument was expected but was not specified." << std::endl;
+                    expect(AssemblingException::Code::REG_EXPECTED);
+                    command |= register_code() << (bits_in_command - bits_in_op_code - bits_in_reg_code);
+                    expect(AssemblingException::Code::REG_EXPECTED);
+                    command |= register_code() << (bits_in_command - bits_in_op_code - bits_in_reg_code - bits_in_reg_code);
+                    expect(AssemblingException::Code::IMM_EXPECTED);
+                    command |= static_cast<uint32_t>(parse_signed(token, output.address)) & 0x0FFFF;
                     break;
                 }
-                case AssemblingException::Code::UNDECLARED_MARK:
+
+                // Регистр и адрес (число или метка).
+                case RM:
                 {
-                    std::cerr << "Undeclared mark was used." << std::endl;
+                    expect(AssemblingException::Code::REG_EXPECTED);
+                    command |= register_code() << (bits_in_command - bits_in_op_code - bits_in_reg_code);
+                    expect(AssemblingException::Code::ADDR_EXPECTED);
+                    address_operand(command, AssemblingException::Code::BIG_ADDR);
                     break;
                 }
-                case AssemblingException::Code::BIG_IMM:
+
+                // Адрес (число или метка).
+                case Me:
                 {
-                    std::cerr << "Given immediate operand is too big." << std::endl;
+                    expect(AssemblingException::Code::ADDR_EXPECTED);
+                    address_operand(command, AssemblingException::Code::BIG_ADDR);
                     break;
                 }
-                case AssemblingException::Code::BIG_ADDR:
+
+                // Непосредственный операнд (число или метка).
+                case Im:
                 {
-                    std::cerr << "Given address is too big." << std::endl;
+                    expect(AssemblingException::Code::IMM_EXPECTED);
+                    address_operand(command, AssemblingException::Code::BIG_IMM);
                     break;
                 }
             }
 
-            throw Exception::ASSEMBLING;
+            // Запись слова.
+            output.write(command);
         }
-
-        state.registers[State::SR] = State::memory_size - 1; // Размещение стека в конце памяти.
-        return 0;
     }
 
-    int Translator::disassemble(const State& state, std::ostream& output_stream) const
+    void Translator::assemble_serial(TokenReader& reader, State& state) const
     {
-        size_t address = 0; // Текущий адрес.
-        uint32_t word = 0;  // Считанное слово.
-
-        // Проход по всей памяти.
-        while (address < State::memory_size)
-        {
-            // Цикл вывода непустой части памяти.
-            while (address < State::memory_size)
-            {
-                // Чтение слова по текущему адресу.
-                word = state.get_word(address);
+        state.symbols.clear();
 
-                // Код будет короче, если вычислить все возможные операнды сразу.
-                OPERATION_CODE operation = OPERATION_CODE((word >> 24) & 0xFF);
-                uint8_t R1 = (word >> 20) & 0xF;
-                uint8_t R2 = (word >> 16) & 0xF;
-                int32_t imm16 = word & 0x0FFFF;
-                int32_t imm20 = word & 0xFFFFF;
-
-                // Два варианта: либо считана команда, либо нет.
-                auto iterator = code_op.find(operation);
-                if (iterator != code_op.end())
-                {
-                    // Вывод имени команды.
-                    output_stream << iterator->second;
+        StateOutput output(state);
+        assemble_tokens(reader, output);
 
-                    // Вывод аргументов.
-                    switch (code_type.at(operation))
-                    {
-                        case RI:
-                        {
-                            output_stream << " " << code_reg.at(R1) << " " << imm20;
-                            break;
-                        }
-                        case RR:
-                        {
-                            output_stream << " " << code_reg.at(R1) << " " << code_reg.at(R2) << " " << imm16;
-                            break;
-                        }
-                        case RM:
-                        {
-                            output_stream << " " << code_reg.at(R1) << " " << imm20;
-                            break;
-                        }
-                        case Me:
-                        {
-                            output_stream << " " << imm20;
-                            break;
-                        }
-                        case Im:
-                        {
-                            output_stream << " " << imm20;
-                            break;
-                        }
-                    }
+        size_t first_undeclared = output.finish();
+        if (first_undeclared != std::numeric_limits<size_t>::max())
+        {
+            throw AssemblingException(first_undeclared, AssemblingException::Code::UNDECLARED_MARK);
+        }
 
-                    // Конец вывода.
-                    output_stream << std::endl;
-                }
-                else
-                {
-                    // Вывод слова.
-                    output_stream << word << std::endl;
-                }
+        state.registers[State::SR] = state.memory_words - 1;  // Размещение стека в конце памяти.
+        state.reset_heap(output.address);                      // Динамическая память - после образа программы.
+    }
 
-                ++address;
-                // Выход из цикла после первого пустого слова.
-                if (!word) { break; }
+    void Translator::report(const AssemblingException& exception)
+    {
+        std::cerr << "[TRANSLATOR ERROR]: error assembling command " << exception.address + 1 << "." << std::endl;
+        switch(exception.code)
+        {
+            case AssemblingException::Code::OK: { break; }
+            case AssemblingException::Code::OP_CODE:
+            {
+                std::cerr << "Unknown operation code." << std::endl;
+                break;
             }
-
-            // Цикл пропуска пустой части памяти.
-            while (address < State::memory_size)
+            case AssemblingException::Code::REG_CODE:
             {
-                // Чтение слова по текущему адресу.
-                word = state.get_word(address);
-
-                // Если слово вдруг оказалось непустым, выходим из цикла.
-                if (word) { break; }
-                ++address;
+                std::cerr << "Unknown register name." << std::endl;
+                break;
+            }
+            case AssemblingException::Code::REG_EXPECTED:
+            {
+                std::cerr << "Register argument was expected but was not specified." << std::endl;
+                break;
+            }
+            case AssemblingException::Code::IMM_EXPECTED:
+            {
+                std::cerr << "Immediate argument was expected but was not specified." << std::endl;
+                break;
+            }
+            case AssemblingException::Code::ADDR_EXPECTED:
+            {
+                std::cerr << "address was expected but was not specified." << std::endl;
+                break;
+            }
+            case AssemblingException::Code::MARK_EXPECTED:
+            {
+                std::cerr << "Mark argument was expected but was not specified." << std::endl;
+                break;
+            }
+            case AssemblingException::Code::UNDECLARED_MARK:
+            {
+                std::cerr << "Undeclared mark was used." << std::endl;
+                break;
+            }
+            case AssemblingException::Code::BIG_IMM:
+            {
+                std::cerr << "Given immediate operand is too big." << std::endl;
+                break;
+            }
+            case AssemblingException::Code::BIG_ADDR:
+            {
+                std::cerr << "Given address is too big." << std::endl;
+                break;
             }
         }
-
-        return 0;
     }
 
-    // PROTECTED:
-
     //////// ASSEMBLING EXCEPTION ////////
     Translator::AssemblingException::AssemblingException(size_t init_address, Translator::AssemblingException::Code init_code) // Инициализация экземпляра исключения.
     {
@@ -1241,11 +3043,27 @@ namespace FUPM2EMU
     {
         // ...
     }
+    Emulator::Emulator(State::Backend backend, uint8_t address_bits) : state(backend, address_bits)
+    {
+        // ...
+    }
     Emulator::~Emulator()
     {
         // ...
     }
 
+    void Emulator::reset()
+    {
+        executor.reset();
+        state.clear();
+    }
+
+    int Emulator::reload(std::istream& image_stream)
+    {
+        reset();
+        return state.load(image_stream);
+    }
+
     int Emulator::run(std::istream& input_stream, std::ostream& output_stream)
     {
         Executor::ReturnCode return_code = Executor::ReturnCode::OK; // Код возврата операции.
@@ -1255,29 +3073,17 @@ namespace FUPM2EMU
         {
             try
             {
-                return_code = executor.step(state, input_stream, output_stream);
-
                 #ifdef DEBUG_EXECUTION_STEPS
+                return_code = executor.step(state, input_stream, output_stream);
                 getchar();
+                #else
+                return_code = executor.run(state, input_stream, output_stream);
                 #endif
             }
             catch (Executor::Exception exception)
             {
-                switch (exception)
-                {
-                    case Executor::Exception::OK: { break; }
-                    case Executor::Exception::MACHINE:
-                    {
-                        std::cerr << "[EMULATOR ERROR]: emulated machine has thrown an exception." << std::endl;
-                        break;
-                    }
-                    case Executor::Exception::INVALIDSTATE:
-                    {
-                        std::cerr << "[EMULATOR ERROR]: machine state has become invalid." << std::endl;
-                        break;
-                    }
-                }
-                std::cerr << "FUPM2EMU has encountered a critical error. Shutting down." << std::endl;
+                output_stream.flush();
+                report(exception);
                 break;
             }
 
@@ -1285,10 +3091,83 @@ namespace FUPM2EMU
             std::cout << "return_code: " << static_cast<int>(return_code) << std::endl;
             #endif
         }
+
+        // Вывод машины может буферизоваться (асинхронный вывод), после останова он должен быть записан.
+        output_stream.flush();
+        return 0;
+    }
+
+    int Emulator::run(std::istream& input_stream, std::ostream& output_stream, std::ostream& checkpoint_stream, uint64_t interval)
+    {
+        Executor::ReturnCode return_code = Executor::ReturnCode::OK; // Код возврата операции.
+
+        // Нулевая контрольная точка - исходное состояние.
+        state.save_checkpoint(checkpoint_stream);
+
+        // Выполнение отрезками по interval команд.
+        while (return_code == Executor::ReturnCode::OK)
+        {
+            uint64_t budget = interval;
+            try
+            {
+                return_code = executor.run(state, input_stream, output_stream, budget);
+            }
+            catch (Executor::Exception exception)
+            {
+                // Состояние на момент ошибки тоже сохраняется.
+                state.save_checkpoint(checkpoint_stream);
+                report(exception);
+                break;
+            }
+
+            state.save_checkpoint(checkpoint_stream);
+        }
         return 0;
     }
 
+    Executor::ReturnCode Emulator::run(std::istream& input_stream, std::ostream& output_stream, uint64_t& budget)
+    {
+        Executor::ReturnCode return_code = Executor::ReturnCode::OK; // Код возврата операции.
+
+        while ((return_code == Executor::ReturnCode::OK) && (budget != 0))
+        {
+            try
+            {
+                return_code = executor.run(state, input_stream, output_stream, budget);
+            }
+            catch (Executor::Exception exception)
+            {
+                output_stream.flush();
+                report(exception);
+                return Executor::ReturnCode::ERROR;
+            }
+        }
+
+        // Выход по системному вызову EXIT считается штатным.
+        return return_code;
+    }
+
     // PROTECTED:
 
+    // Сообщение о критической ошибке исполнителя.
+    void Emulator::report(Executor::Exception exception)
+    {
+        switch (exception)
+        {
+            case Executor::Exception::OK: { break; }
+            case Executor::Exception::MACHINE:
+            {
+                std::cerr << "[EMULATOR ERROR]: emulated machine has thrown an exception." << std::endl;
+                break;
+            }
+            case Executor::Exception::INVALIDSTATE:
+            {
+                std::cerr << "[EMULATOR ERROR]: machine state has become invalid." << std::endl;
+                break;
+            }
+        }
+        std::cerr << "FUPM2EMU has encountered a critical error. Shutting down." << std::endl;
+    }
+
     // PRIVATE:
 }
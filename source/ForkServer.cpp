@@ -0,0 +1,133 @@
+#include <fstream>
+#include <sstream>
+
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "ForkServer.hpp"
+
+namespace FUPM2EMU
+{
+    ////////////////   ForkServer   ////////////////
+    // PUBLIC:
+    ForkServer::ForkServer(Emulator& emulator) : emulator(emulator)
+    {
+        // ...
+    }
+    ForkServer::~ForkServer()
+    {
+        // ...
+    }
+
+    int ForkServer::serve(const std::string& control_path, std::ostream& report_stream)
+    {
+        // Именованный канал переоткрывается после закрытия всех пишущих сторон, обычный файл читается один раз.
+        struct stat control_stat;
+        if (stat(control_path.c_str(), &control_stat) != 0)
+        {
+            std::cerr << "[FORK SERVER ERROR]: failed to open control file: " << control_path << std::endl;
+            throw Exception::CONTROL;
+        }
+        bool is_fifo = S_ISFIFO(control_stat.st_mode);
+
+        do
+        {
+            std::ifstream control_stream(control_path);
+            if (!control_stream.is_open())
+            {
+                std::cerr << "[FORK SERVER ERROR]: failed to open control file: " << control_path << std::endl;
+                throw Exception::CONTROL;
+            }
+
+            std::string line;
+            while (std::getline(control_stream, line))
+            {
+                std::istringstream request(line);
+                std::string input_path;
+                std::string output_path;
+                if (!(request >> input_path)) { continue; } // Пустая строка.
+                if (input_path == "quit") { return 0; }
+                if (!(request >> output_path))
+                {
+                    std::cerr << "[FORK SERVER ERROR]: output file was not specified for " << input_path << std::endl;
+                    continue;
+                }
+
+                uint64_t instructions = 0;
+                int status = run_child(input_path, output_path, instructions);
+                report_stream << input_path << ' ' << status << ' ' << instructions << std::endl;
+            }
+        }
+        while (is_fifo);
+
+        return 0;
+    }
+
+    // PROTECTED:
+
+    int ForkServer::run_child(const std::string& input_path, const std::string& output_path, uint64_t& instructions)
+    {
+        instructions = 0;
+
+        // Канал для передачи числа выполненных команд от дочернего процесса.
+        int count_pipe[2];
+        if (pipe(count_pipe) != 0) { return 1; }
+
+        // Буферы родителя не должны попасть в вывод дочернего процесса.
+        std::cout.flush();
+        std::cerr.flush();
+
+        pid_t pid = fork();
+        if (pid < 0)
+        {
+            close(count_pipe[0]);
+            close(count_pipe[1]);
+            return 1;
+        }
+
+        if (pid == 0)
+        {
+            // Дочерний процесс: состояние уже подготовлено, остаётся выполнить его со своими потоками.
+            close(count_pipe[0]);
+
+            int code = 1;
+            uint64_t budget = UINT64_MAX;
+            std::ifstream input_stream(input_path, std::ifstream::binary);
+            std::ofstream output_stream(output_path, std::ofstream::binary);
+            if (input_stream.is_open() && output_stream.is_open())
+            {
+                Executor::ReturnCode return_code = emulator.run(input_stream, output_stream, budget);
+                code = (return_code == Executor::ReturnCode::TERMINATE) ? 0 : 1;
+            }
+            else
+            {
+                std::cerr << "[FORK SERVER ERROR]: failed to open files: " << input_path << ", " << output_path << std::endl;
+            }
+            output_stream.close();
+            std::cerr.flush();
+
+            uint64_t executed = UINT64_MAX - budget;
+            ssize_t written = write(count_pipe[1], &executed, sizeof(executed));
+            (void)written;
+            close(count_pipe[1]);
+
+            // Деструкторы и буферы родителя в дочернем процессе не выполняются.
+            _exit(code);
+        }
+
+        // Родительский процесс: ожидание результата.
+        close(count_pipe[1]);
+        ssize_t received = read(count_pipe[0], &instructions, sizeof(instructions));
+        if (received != static_cast<ssize_t>(sizeof(instructions))) { instructions = 0; }
+        close(count_pipe[0]);
+
+        int wait_status = 0;
+        waitpid(pid, &wait_status, 0);
+        if (WIFEXITED(wait_status)) { return WEXITSTATUS(wait_status); }
+        if (WIFSIGNALED(wait_status)) { return 128 + WTERMSIG(wait_status); }
+        return 1;
+    }
+
+    // PRIVATE:
+}
@@ -0,0 +1,535 @@
+#include <cstring>
+#include <cstdlib>
+#include <thread>
+
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "GdbServer.hpp"
+
+namespace
+{
+    const char hex_digits[] = "0123456789abcdef";
+
+    // Шестнадцатеричная запись числа из digits цифр (старшие первыми).
+    std::string to_hex(uint32_t value, size_t digits)
+    {
+        std::string text(digits, '0');
+        for (size_t index = digits; index > 0; --index, value >>= 4) { text[index - 1] = hex_digits[value & 0xF]; }
+        return text;
+    }
+
+    // Значение шестнадцатеричной цифры (-1 - не цифра).
+    int hex_value(int symbol)
+    {
+        if ((symbol >= '0') && (symbol <= '9')) { return symbol - '0'; }
+        if ((symbol >= 'a') && (symbol <= 'f')) { return symbol - 'a' + 10; }
+        if ((symbol >= 'A') && (symbol <= 'F')) { return symbol - 'A' + 10; }
+        return -1;
+    }
+
+    // Разбор шестнадцатеричного числа с позиции position до первого нецифрового символа.
+    uint64_t parse_hex(const std::string& text, size_t& position)
+    {
+        uint64_t value = 0;
+        for (; (position < text.size()) && (hex_value(text[position]) >= 0); ++position) { value = (value << 4) | hex_value(text[position]); }
+        return value;
+    }
+
+    // Описание регистров для GDB (qXfer:features:read:target.xml).
+    std::string target_description()
+    {
+        std::string description = "<?xml version=\"1.0\"?>\n<!DOCTYPE target SYSTEM \"gdb-target.dtd\">\n"
+                                  "<target version=\"1.0\">\n  <feature name=\"org.fupm2emu.core\">\n";
+        for (int index = 0; index < FUPM2EMU::State::SR; ++index)
+        {
+            description += "    <reg name=\"r" + std::to_string(index) + "\" bitsize=\"32\" type=\"int32\"/>\n";
+        }
+        description += "    <reg name=\"sp\" bitsize=\"32\" type=\"data_ptr\"/>\n"
+                       "    <reg name=\"pc\" bitsize=\"32\" type=\"code_ptr\"/>\n"
+                       "    <reg name=\"flags\" bitsize=\"32\" type=\"int32\"/>\n"
+                       "  </feature>\n</target>\n";
+        return description;
+    }
+}
+
+namespace FUPM2EMU
+{
+    ////////////////   GdbServer    ////////////////
+    // PUBLIC:
+    GdbServer::GdbServer(Emulator& emulator) :
+        emulator(emulator), connection(-1), position(0), acknowledge(true), detached(false), killed(false)
+    {
+        // ...
+    }
+    GdbServer::~GdbServer()
+    {
+        if (connection >= 0) { close(connection); }
+    }
+
+    int GdbServer::serve(const std::string& address, std::istream& input_stream, std::ostream& output_stream)
+    {
+        connection = accept_client(address);
+        if (connection < 0)
+        {
+            std::cerr << "[GDB SERVER ERROR]: failed to accept a connection on " << address << std::endl;
+            throw Exception::SOCKET;
+        }
+
+        bool running = true;
+        {
+            Debugger debugger(emulator);
+            std::string packet;
+            while (!detached && receive(packet))
+            {
+                // Ответ на QStartNoAckMode ещё подтверждается клиентом.
+                if (packet == "QStartNoAckMode")
+                {
+                    if (!send("OK")) { break; }
+                    acknowledge = false;
+                    continue;
+                }
+
+                std::string reply = handle(packet, debugger, input_stream, output_stream);
+                if (killed || !send(reply)) { break; }
+            }
+            running = debugger.running();
+        }
+        close(connection);
+        connection = -1;
+        std::cerr << "[GDB SERVER]: Client disconnected." << std::endl;
+
+        // Без клиента программа продолжается обычным интерпретатором.
+        if (running && !killed) { return emulator.run(input_stream, output_stream); }
+        output_stream.flush();
+        return 0;
+    }
+
+    // PROTECTED:
+
+    int GdbServer::accept_client(const std::string& address)
+    {
+        bool is_port = !address.empty() && (address.find_first_not_of("0123456789") == std::string::npos);
+        int listener = -1;
+        if (is_port)
+        {
+            unsigned long port = std::strtoul(address.c_str(), nullptr, 10);
+            if (port > 65535) { return -1; }
+
+            listener = socket(AF_INET, SOCK_STREAM, 0);
+            if (listener < 0) { return -1; }
+            int reuse = 1;
+            setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+            struct sockaddr_in local;
+            std::memset(&local, 0, sizeof(local));
+            local.sin_family = AF_INET;
+            local.sin_port = htons(static_cast<uint16_t>(port));
+            local.sin_addr.s_addr = htonl(INADDR_LOOPBACK); // Только локальные подключения.
+            socklen_t length = sizeof(local);
+            if ((bind(listener, reinterpret_cast<struct sockaddr*>(&local), sizeof(local)) != 0) || (listen(listener, 1) != 0) ||
+                (getsockname(listener, reinterpret_cast<struct sockaddr*>(&local), &length) != 0))
+            {
+                close(listener);
+                return -1;
+            }
+            std::cerr << "[GDB SERVER]: Listening on 127.0.0.1:" << ntohs(local.sin_port) << std::endl;
+        }
+        else
+        {
+            struct sockaddr_un local;
+            std::memset(&local, 0, sizeof(local));
+            local.sun_family = AF_UNIX;
+            if (address.empty() || (address.size() >= sizeof(local.sun_path))) { return -1; }
+            std::strcpy(local.sun_path, address.c_str());
+
+            // Оставшийся от прошлого запуска сокет заменяется, другие файлы - нет.
+            struct stat existing;
+            if ((stat(address.c_str(), &existing) == 0) && S_ISSOCK(existing.st_mode)) { unlink(address.c_str()); }
+
+            listener = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (listener < 0) { return -1; }
+            if ((bind(listener, reinterpret_cast<struct sockaddr*>(&local), sizeof(local)) != 0) || (listen(listener, 1) != 0))
+            {
+                close(listener);
+                return -1;
+            }
+            std::cerr << "[GDB SERVER]: Listening on " << address << std::endl;
+        }
+
+        int client = -1;
+        do { client = accept(listener, nullptr, nullptr); } while ((client < 0) && (errno == EINTR));
+        close(listener);
+        if (!is_port) { unlink(address.c_str()); }
+        if (client < 0) { return -1; }
+
+        if (is_port)
+        {
+            int no_delay = 1; // Пакеты короткие, задержка Нейгла только мешает.
+            setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+        }
+        std::cerr << "[GDB SERVER]: Client connected." << std::endl;
+        return client;
+    }
+
+    int GdbServer::next_byte()
+    {
+        if (position == received.size())
+        {
+            received.clear();
+            position = 0;
+
+            char bytes[4096];
+            ssize_t count = 0;
+            do { count = recv(connection, bytes, sizeof(bytes), 0); } while ((count < 0) && (errno == EINTR));
+            if (count <= 0) { return -1; }
+            received.assign(bytes, static_cast<size_t>(count));
+        }
+        return static_cast<unsigned char>(received[position++]);
+    }
+
+    bool GdbServer::receive(std::string& packet)
+    {
+        while (true)
+        {
+            // До начала пакета пропускаются подтверждения и Ctrl-C, пришедший после остановки.
+            int symbol = next_byte();
+            if (symbol < 0) { return false; }
+            if (symbol != '$') { continue; }
+
+            packet.clear();
+            uint8_t sum = 0;
+            bool escaped = false;
+            while (((symbol = next_byte()) >= 0) && (symbol != '#'))
+            {
+                sum += static_cast<uint8_t>(symbol);
+                if (escaped) { packet.push_back(static_cast<char>(symbol ^ 0x20)); escaped = false; }
+                else if (symbol == '}') { escaped = true; }
+                else { packet.push_back(static_cast<char>(symbol)); }
+            }
+            int high = next_byte();
+            int low = next_byte();
+            if ((symbol < 0) || (low < 0)) { return false; }
+
+            if (acknowledge)
+            {
+                bool valid = (hex_value(high) >= 0) && (hex_value(low) >= 0) && (((hex_value(high) << 4) | hex_value(low)) == sum);
+                const char answer = valid ? '+' : '-';
+                if (::send(connection, &answer, 1, MSG_NOSIGNAL) != 1) { return false; }
+                if (!valid) { continue; }
+            }
+            return true;
+        }
+    }
+
+    bool GdbServer::send(const std::string& payload)
+    {
+        std::string frame = "$";
+        uint8_t sum = 0;
+        for (char symbol : payload)
+        {
+            if ((symbol == '$') || (symbol == '#') || (symbol == '}') || (symbol == '*'))
+            {
+                frame.push_back('}');
+                sum += '}';
+                symbol ^= 0x20;
+            }
+            frame.push_back(symbol);
+            sum += static_cast<uint8_t>(symbol);
+        }
+        frame += '#' + to_hex(sum, 2);
+
+        while (true)
+        {
+            for (size_t sent = 0; sent < frame.size();)
+            {
+                ssize_t count = ::send(connection, frame.data() + sent, frame.size() - sent, MSG_NOSIGNAL);
+                if ((count < 0) && (errno == EINTR)) { continue; }
+                if (count <= 0) { return false; }
+                sent += static_cast<size_t>(count);
+            }
+            if (!acknowledge) { return true; }
+
+            // Ожидание подтверждения: '-' - повтор пакета.
+            int symbol = 0;
+            do { symbol = next_byte(); } while ((symbol >= 0) && (symbol != '+') && (symbol != '-'));
+            if (symbol < 0) { return false; }
+            if (symbol == '+') { return true; }
+        }
+    }
+
+    std::string GdbServer::handle(const std::string& packet, Debugger& debugger, std::istream& input_stream, std::ostream& output_stream)
+    {
+        State& state = emulator.state;
+        if (packet.empty()) { return ""; }
+
+        size_t cursor = 1;
+        switch (packet[0])
+        {
+            // Причина остановки.
+            case '?': { return debugger.running() ? "S05" : "W00"; }
+
+            // Регистры.
+            case 'g':
+            {
+                std::string reply;
+                for (size_t index = 0; index < registers_number; ++index) { reply += to_hex(get_register(index), 8); }
+                return reply;
+            }
+            case 'G':
+            {
+                if (packet.size() < 1 + registers_number * 8) { return "E01"; }
+                for (size_t index = 0; index < registers_number; ++index)
+                {
+                    size_t start = 1 + index * 8;
+                    std::string digits = packet.substr(start, 8);
+                    size_t digits_position = 0;
+                    set_register(index, static_cast<uint32_t>(parse_hex(digits, digits_position)));
+                }
+                return "OK";
+            }
+            case 'p':
+            {
+                size_t index = parse_hex(packet, cursor);
+                if (index >= registers_number) { return "E01"; }
+                return to_hex(get_register(index), 8);
+            }
+            case 'P':
+            {
+                size_t index = parse_hex(packet, cursor);
+                if ((index >= registers_number) || (cursor >= packet.size()) || (packet[cursor] != '=')) { return "E01"; }
+                ++cursor;
+                set_register(index, static_cast<uint32_t>(parse_hex(packet, cursor)));
+                return "OK";
+            }
+
+            // Память: байт N - байт (N mod 4) слова N / 4, старший байт первым.
+            case 'm':
+            case 'M':
+            {
+                uint64_t address = parse_hex(packet, cursor);
+                if ((cursor >= packet.size()) || (packet[cursor] != ',')) { return "E01"; }
+                ++cursor;
+                uint64_t length = parse_hex(packet, cursor);
+                if (length > packet_size) { return "E01"; }
+
+                if (packet[0] == 'm')
+                {
+                    std::string reply;
+                    for (uint64_t byte = address; byte < address + length; ++byte)
+                    {
+                        uint32_t word = debugger.read(static_cast<uint32_t>(byte / State::bytes_in_word));
+                        reply += to_hex((word >> (8 * (State::bytes_in_word - 1 - byte % State::bytes_in_word))) & 0xFF, 2);
+                    }
+                    return reply;
+                }
+
+                if ((cursor >= packet.size()) || (packet[cursor] != ':') || (packet.size() - cursor - 1 < length * 2)) { return "E01"; }
+                ++cursor;
+                for (uint64_t byte = address; byte < address + length; ++byte, cursor += 2)
+                {
+                    uint32_t address_word = static_cast<uint32_t>(byte / State::bytes_in_word);
+                    uint32_t shift = 8 * (State::bytes_in_word - 1 - byte % State::bytes_in_word);
+                    uint32_t value = static_cast<uint32_t>((hex_value(packet[cursor]) << 4) | hex_value(packet[cursor + 1])) & 0xFF;
+                    uint32_t word = debugger.read(address_word);
+                    debugger.write(address_word, (word & ~(0xFFu << shift)) | (value << shift));
+                }
+                return "OK";
+            }
+
+            // Выполнение (необязательный аргумент - адрес продолжения).
+            case 'c':
+            case 's':
+            {
+                if (cursor < packet.size()) { set_register(State::CIR, static_cast<uint32_t>(parse_hex(packet, cursor))); }
+                return resume(debugger, input_stream, output_stream, (packet[0] == 's') ? 1 : 0);
+            }
+
+            // Точки останова (0, 1) и наблюдения за записью (2).
+            case 'Z':
+            case 'z':
+            {
+                char type = (packet.size() > 1) ? packet[1] : ' ';
+                cursor = 2;
+                if ((cursor >= packet.size()) || (packet[cursor] != ',')) { return "E01"; }
+                ++cursor;
+                uint64_t address = parse_hex(packet, cursor);
+                uint64_t kind = 1;
+                if ((cursor < packet.size()) && (packet[cursor] == ',')) { ++cursor; kind = parse_hex(packet, cursor); }
+                bool insert = (packet[0] == 'Z');
+
+                if ((type == '0') || (type == '1'))
+                {
+                    if (address % State::bytes_in_word != 0) { return "E22"; }
+                    uint32_t word = static_cast<uint32_t>(address / State::bytes_in_word);
+                    if (insert) { debugger.set_breakpoint(word); }
+                    else { debugger.remove_breakpoint(word); }
+                    return "OK";
+                }
+                if (type == '2')
+                {
+                    if (state.backend != State::Backend::DENSE) { return "E22"; }
+                    uint64_t first = address / State::bytes_in_word;
+                    uint64_t last = (address + (kind ? kind : 1) - 1) / State::bytes_in_word;
+                    for (uint64_t word = first; word <= last; ++word)
+                    {
+                        if (insert) { debugger.set_watchpoint(static_cast<uint32_t>(word)); }
+                        else { debugger.remove_watchpoint(static_cast<uint32_t>(word)); }
+                    }
+                    return "OK";
+                }
+                return ""; // Точки наблюдения за чтением не поддерживаются.
+            }
+
+            // Отсоединение и завершение.
+            case 'D':
+            {
+                detached = true;
+                return "OK";
+            }
+            case 'k':
+            {
+                killed = true;
+                return "";
+            }
+
+            // Единственный поток.
+            case 'H': { return "OK"; }
+            case 'T': { return "OK"; }
+
+            case 'q':
+            {
+                if (packet.compare(0, 11, "qSupported:") == 0 || (packet == "qSupported"))
+                {
+                    return "PacketSize=" + to_hex(packet_size, 4) + ";qXfer:features:read+;swbreak+;QStartNoAckMode+";
+                }
+                if (packet == "qAttached") { return "1"; }
+                if (packet == "qC") { return "QC1"; }
+                if (packet == "qfThreadInfo") { return "m1"; }
+                if (packet == "qsThreadInfo") { return "l"; }
+
+                const std::string features = "qXfer:features:read:target.xml:";
+                if (packet.compare(0, features.size(), features) == 0)
+                {
+                    cursor = features.size();
+                    size_t offset = parse_hex(packet, cursor);
+                    if ((cursor >= packet.size()) || (packet[cursor] != ',')) { return "E01"; }
+                    ++cursor;
+                    size_t length = parse_hex(packet, cursor);
+
+                    const std::string description = target_description();
+                    if (offset >= description.size()) { return "l"; }
+                    std::string part = description.substr(offset, length);
+                    return ((offset + part.size() >= description.size()) ? "l" : "m") + part;
+                }
+                return "";
+            }
+
+            case 'v':
+            {
+                if (packet.compare(0, 5, "vKill") == 0)
+                {
+                    killed = true;
+                    return "OK";
+                }
+                return ""; // vCont и прочие - c и s.
+            }
+
+            default: { return ""; }
+        }
+    }
+
+    std::string GdbServer::resume(Debugger& debugger, std::istream& input_stream, std::ostream& output_stream, uint64_t steps)
+    {
+        Debugger::Stop stop = Debugger::Stop::STEP;
+        int wakeup[2] = {-1, -1};
+        if ((steps != 0) || (pipe(wakeup) != 0)) { stop = debugger.resume(input_stream, output_stream, steps); }
+        else
+        {
+            // Пока машина работает, отдельный поток ждёт Ctrl-C (0x03). Прочие байты сохраняются для разбора после остановки.
+            if (received.find('\x03', position) != std::string::npos) { debugger.request_stop(); }
+            std::thread watcher([&]()
+            {
+                struct pollfd descriptors[2];
+                descriptors[0].fd = connection;
+                descriptors[0].events = POLLIN;
+                descriptors[1].fd = wakeup[0];
+                descriptors[1].events = POLLIN;
+                while (true)
+                {
+                    descriptors[0].revents = 0;
+                    descriptors[1].revents = 0;
+                    if (poll(descriptors, 2, -1) < 0)
+                    {
+                        if (errno == EINTR) { continue; }
+                        break;
+                    }
+                    if (descriptors[1].revents != 0) { break; }
+
+                    char bytes[256];
+                    ssize_t count = recv(connection, bytes, sizeof(bytes), 0);
+                    if ((count < 0) && (errno == EINTR)) { continue; }
+                    if (count <= 0)
+                    {
+                        // Разрыв соединения: машина останавливается, дальше она выполняется без отладчика.
+                        debugger.request_stop();
+                        break;
+                    }
+                    for (ssize_t index = 0; index < count; ++index)
+                    {
+                        if (bytes[index] == '\x03') { debugger.request_stop(); }
+                        else { received.push_back(bytes[index]); }
+                    }
+                }
+            });
+
+            stop = debugger.resume(input_stream, output_stream, 0);
+            const char signal_byte = 0;
+            while ((write(wakeup[1], &signal_byte, 1) < 0) && (errno == EINTR)) { }
+            watcher.join();
+            close(wakeup[0]);
+            close(wakeup[1]);
+        }
+        output_stream.flush();
+
+        switch (stop)
+        {
+            case Debugger::Stop::STEP:       { return "S05"; }
+            case Debugger::Stop::BREAKPOINT: { return "T05swbreak:;"; }
+            case Debugger::Stop::WATCHPOINT:
+            {
+                return "T05watch:" + to_hex(static_cast<uint32_t>(debugger.changes.front().address * State::bytes_in_word), 8) + ";";
+            }
+            case Debugger::Stop::INTERRUPT:  { return "S02"; }
+            case Debugger::Stop::HALT:       { return "W00"; }
+            case Debugger::Stop::ERROR:      { return "S04"; }
+        }
+        return "S05";
+    }
+
+    uint32_t GdbServer::get_register(size_t index) const
+    {
+        const State& state = emulator.state;
+        if ((index == State::SR) || (index == State::CIR))
+        {
+            return static_cast<uint32_t>(state.registers[index]) * State::bytes_in_word; // Байтовый адрес.
+        }
+        if (index < State::registers_number) { return static_cast<uint32_t>(state.registers[index]); }
+        return state.flags;
+    }
+
+    void GdbServer::set_register(size_t index, uint32_t value)
+    {
+        State& state = emulator.state;
+        if ((index == State::SR) || (index == State::CIR)) { state.registers[index] = static_cast<int32_t>(value / State::bytes_in_word); }
+        else if (index < State::registers_number) { state.registers[index] = static_cast<int32_t>(value); }
+        else { state.flags = static_cast<uint8_t>(value); }
+    }
+}
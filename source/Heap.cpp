@@ -0,0 +1,301 @@
+#include <algorithm>
+
+#include "Heap.hpp"
+
+namespace FUPM2EMU
+{
+    ////////////////      Heap      ////////////////
+    // PUBLIC:
+    Heap::Heap() : begin(0), end(0), top(0), blocks_used(0)
+    {
+        // ...
+    }
+    Heap::~Heap()
+    {
+        // ...
+    }
+
+    void Heap::reset(size_t init_begin, size_t init_end)
+    {
+        // Адрес 0 означает неудачу выделения и не может быть началом блока.
+        begin = (init_begin == 0) ? 1 : init_begin;
+        end = (init_end > begin) ? init_end : begin;
+        top = begin;
+
+        for (std::vector<uint32_t>& list : free_blocks) { list.clear(); }
+        std::fill(blocks.begin(), blocks.end(), Block{no_block, 0}); // Ёмкость таблицы сохраняется.
+        blocks_used = 0;
+        statistics = Statistics();
+    }
+
+    uint32_t Heap::allocate(size_t size)
+    {
+        uint8_t block_class = size_class(size);
+        if (block_class >= classes_number)
+        {
+            ++statistics.failures;
+            return 0;
+        }
+        size_t block_size = static_cast<size_t>(1) << block_class;
+
+        // Повторное использование освобождённого блока того же класса, иначе - отрезание от вершины.
+        uint32_t address = 0;
+        std::vector<uint32_t>& list = free_blocks[block_class];
+        if (!list.empty())
+        {
+            address = list.back();
+            list.pop_back();
+        }
+        else if (end - top >= block_size)
+        {
+            address = static_cast<uint32_t>(top);
+            top += block_size;
+        }
+        else
+        {
+            ++statistics.failures;
+            return 0;
+        }
+
+        insert_block(address, block_class);
+
+        ++statistics.allocations;
+        ++statistics.blocks;
+        statistics.used += block_size;
+        if (statistics.used > statistics.peak) { statistics.peak = statistics.used; }
+        return address;
+    }
+
+    bool Heap::release(uint32_t address)
+    {
+        size_t index = find_block(address);
+        if (index == blocks.size()) { return false; }
+
+        uint8_t block_class = blocks[index].block_class;
+        erase_block(index);
+
+        // Последний отрезанный блок возвращается вершине, остальные - в список класса.
+        size_t block_size = static_cast<size_t>(1) << block_class;
+        if (address + block_size == top) { top = address; }
+        else { free_blocks[block_class].push_back(address); }
+
+        ++statistics.releases;
+        --statistics.blocks;
+        statistics.used -= block_size;
+        return true;
+    }
+
+    size_t Heap::capacity(uint32_t address) const
+    {
+        size_t index = find_block(address);
+        if (index == blocks.size()) { return 0; }
+        return static_cast<size_t>(1) << blocks[index].block_class;
+    }
+
+    bool Heap::resize(uint32_t address, size_t size)
+    {
+        if (size > capacity(address)) { return false; }
+
+        ++statistics.in_place;
+        return true;
+    }
+
+    void Heap::print_statistics(std::ostream& output_stream) const
+    {
+        output_stream << "[HEAP]: area: " << begin << "-" << end << " (" << end - begin << " words)" << std::endl
+                      << "[HEAP]: allocations: " << statistics.allocations << ", releases: " << statistics.releases
+                      << ", reallocations: " << statistics.reallocations << " (in place: " << statistics.in_place << ")"
+                      << ", failures: " << statistics.failures << std::endl
+                      << "[HEAP]: live blocks: " << statistics.blocks << ", used: " << statistics.used << " words, peak: " << statistics.peak << " words"
+                      << ", carved: " << top - begin << " words" << std::endl;
+    }
+
+    void Heap::save(std::vector<uint32_t>& words) const
+    {
+        auto put_long = [&words](uint64_t value)
+        {
+            words.push_back(static_cast<uint32_t>(value >> 32));
+            words.push_back(static_cast<uint32_t>(value));
+        };
+
+        words.clear();
+        words.push_back(static_cast<uint32_t>(begin));
+        words.push_back(static_cast<uint32_t>(end));
+        words.push_back(static_cast<uint32_t>(top));
+        put_long(statistics.allocations);
+        put_long(statistics.releases);
+        put_long(statistics.reallocations);
+        put_long(statistics.in_place);
+        put_long(statistics.failures);
+        put_long(statistics.blocks);
+        put_long(statistics.used);
+        put_long(statistics.peak);
+
+        // Занятые блоки: число, затем пары (адрес, класс) по возрастанию адресов, чтобы запись не зависела от порядка в таблице.
+        std::vector<std::pair<uint32_t, uint32_t>> used_blocks;
+        for (const Block& block : blocks)
+        {
+            if (block.address != no_block) { used_blocks.emplace_back(block.address, block.block_class); }
+        }
+        std::sort(used_blocks.begin(), used_blocks.end());
+        words.push_back(static_cast<uint32_t>(used_blocks.size()));
+        for (const auto& block : used_blocks)
+        {
+            words.push_back(block.first);
+            words.push_back(block.second);
+        }
+
+        // Списки свободных блоков по классам (порядок сохраняется: он определяет адреса следующих выделений).
+        for (const std::vector<uint32_t>& list : free_blocks)
+        {
+            words.push_back(static_cast<uint32_t>(list.size()));
+            words.insert(words.end(), list.begin(), list.end());
+        }
+    }
+
+    bool Heap::load(const std::vector<uint32_t>& words)
+    {
+        size_t position = 0;
+        auto get = [&words, &position](uint32_t& value)
+        {
+            if (position >= words.size()) { return false; }
+            value = words[position++];
+            return true;
+        };
+        auto get_long = [&get](uint64_t& value)
+        {
+            uint32_t high = 0;
+            uint32_t low = 0;
+            if (!get(high) || !get(low)) { return false; }
+            value = (static_cast<uint64_t>(high) << 32) | low;
+            return true;
+        };
+
+        uint32_t new_begin = 0;
+        uint32_t new_end = 0;
+        uint32_t new_top = 0;
+        if (!get(new_begin) || !get(new_end) || !get(new_top)) { return false; }
+        if ((new_begin == 0) || (new_begin > new_top) || (new_top > new_end)) { return false; }
+
+        Statistics new_statistics;
+        uint64_t blocks_count = 0;
+        uint64_t used = 0;
+        uint64_t peak = 0;
+        if (!get_long(new_statistics.allocations) || !get_long(new_statistics.releases) || !get_long(new_statistics.reallocations) ||
+            !get_long(new_statistics.in_place) || !get_long(new_statistics.failures) || !get_long(blocks_count) ||
+            !get_long(used) || !get_long(peak))
+        {
+            return false;
+        }
+        new_statistics.blocks = static_cast<size_t>(blocks_count);
+        new_statistics.used = static_cast<size_t>(used);
+        new_statistics.peak = static_cast<size_t>(peak);
+
+        std::vector<std::pair<uint32_t, uint8_t>> new_blocks;
+        uint32_t used_count = 0;
+        if (!get(used_count) || (used_count > (words.size() - position) / 2)) { return false; }
+        for (uint32_t index = 0; index < used_count; ++index)
+        {
+            uint32_t address = 0;
+            uint32_t block_class = 0;
+            if (!get(address) || !get(block_class)) { return false; }
+            if ((block_class >= classes_number) || (address < new_begin) ||
+                ((static_cast<size_t>(1) << block_class) > static_cast<size_t>(new_top - address)) ||
+                (!new_blocks.empty() && (address <= new_blocks.back().first)))
+            {
+                return false;
+            }
+            new_blocks.emplace_back(address, static_cast<uint8_t>(block_class));
+        }
+
+        std::vector<uint32_t> new_free_blocks[classes_number];
+        for (std::vector<uint32_t>& list : new_free_blocks)
+        {
+            uint32_t list_size = 0;
+            if (!get(list_size) || (list_size > words.size() - position)) { return false; }
+            for (uint32_t index = 0; index < list_size; ++index)
+            {
+                uint32_t address = 0;
+                get(address);
+                if ((address < new_begin) || (address >= new_top)) { return false; }
+                list.push_back(address);
+            }
+        }
+        if (position != words.size()) { return false; }
+
+        begin = new_begin;
+        end = new_end;
+        top = new_top;
+        statistics = new_statistics;
+        std::fill(blocks.begin(), blocks.end(), Block{no_block, 0});
+        blocks_used = 0;
+        for (const auto& block : new_blocks) { insert_block(block.first, block.second); }
+        for (size_t block_class = 0; block_class < classes_number; ++block_class) { free_blocks[block_class].swap(new_free_blocks[block_class]); }
+        return true;
+    }
+
+    // PROTECTED:
+
+    size_t Heap::home(uint32_t address) const
+    {
+        // Мультипликативное хеширование: старшие биты произведения равномерно зависят от всех битов адреса.
+        return static_cast<size_t>((static_cast<uint64_t>(address) * 0x9E3779B97F4A7C15ull) >> 32) & (blocks.size() - 1);
+    }
+
+    size_t Heap::find_block(uint32_t address) const
+    {
+        if (blocks.empty()) { return blocks.size(); }
+        for (size_t index = home(address); blocks[index].address != no_block; index = (index + 1) & (blocks.size() - 1))
+        {
+            if (blocks[index].address == address) { return index; }
+        }
+        return blocks.size();
+    }
+
+    void Heap::insert_block(uint32_t address, uint8_t block_class)
+    {
+        // Заполнение таблицы не превышает половины: поиск короткий, а пустая ячейка всегда есть.
+        if (2 * (blocks_used + 1) > blocks.size())
+        {
+            std::vector<Block> old_blocks(std::max<size_t>(2 * blocks.size(), 64), Block{no_block, 0});
+            old_blocks.swap(blocks);
+            blocks_used = 0;
+            for (const Block& block : old_blocks)
+            {
+                if (block.address != no_block) { insert_block(block.address, block.block_class); }
+            }
+        }
+
+        size_t index = home(address);
+        while (blocks[index].address != no_block) { index = (index + 1) & (blocks.size() - 1); }
+        blocks[index] = Block{address, block_class};
+        ++blocks_used;
+    }
+
+    void Heap::erase_block(size_t index)
+    {
+        // Удаление со сдвигом назад: ячейки цепочки, начальная ячейка которых не лежит между дырой и ними, переносятся
+        // в дыру, поэтому пометки удалённых ячеек не нужны и поиск не удлиняется.
+        size_t mask = blocks.size() - 1;
+        size_t hole = index;
+        for (size_t next = (hole + 1) & mask; blocks[next].address != no_block; next = (next + 1) & mask)
+        {
+            if (((next - home(blocks[next].address)) & mask) >= ((next - hole) & mask))
+            {
+                blocks[hole] = blocks[next];
+                hole = next;
+            }
+        }
+        blocks[hole].address = no_block;
+        --blocks_used;
+    }
+
+    uint8_t Heap::size_class(size_t size)
+    {
+        uint8_t block_class = min_class;
+        while ((block_class < classes_number) && ((static_cast<size_t>(1) << block_class) < size)) { ++block_class; }
+        return block_class;
+    }
+
+    // PRIVATE:
+}
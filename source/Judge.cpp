@@ -0,0 +1,197 @@
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <filesystem>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cctype>
+
+#include "Judge.hpp"
+
+namespace FUPM2EMU
+{
+    ////////////////     Judge      ////////////////
+    // PUBLIC:
+    Judge::Judge()
+    {
+        // ...
+    }
+    Judge::~Judge()
+    {
+        // ...
+    }
+
+    int Judge::judge(const State& state, const std::string& directory, std::ostream& report_stream) const
+    {
+        std::vector<Case> cases = load_cases(directory);
+
+        // Рабочие потоки разбирают тесты по общему счётчику.
+        unsigned int workers_number = threads_number ? threads_number : std::max(1u, std::thread::hardware_concurrency());
+        workers_number = std::min<unsigned int>(workers_number, cases.size());
+
+        std::atomic<size_t> next_case(0);
+        auto worker = [&]()
+        {
+            // Полная копия состояния - один раз на поток, перед каждым тестом откатываются только изменённые страницы.
+            Emulator emulator;
+            emulator.state = state;
+            for (size_t index = next_case++; index < cases.size(); index = next_case++)
+            {
+                run_case(emulator, state, cases[index]);
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (unsigned int i = 1; i < workers_number; ++i) { workers.emplace_back(worker); }
+        worker();
+        for (std::thread& thread : workers) { thread.join(); }
+
+        // Сводная таблица.
+        size_t name_width = 4;
+        for (const Case& test_case : cases) { name_width = std::max(name_width, test_case.name.size()); }
+
+        int failed = 0;
+        report_stream << std::left << std::setw(name_width) << "Case" << "  " << std::setw(14) << "Verdict"
+                      << std::right << std::setw(12) << "Time (ms)" << std::setw(16) << "Instructions" << std::endl;
+        for (const Case& test_case : cases)
+        {
+            if (test_case.verdict != Verdict::OK) { ++failed; }
+            report_stream << std::left << std::setw(name_width) << test_case.name << "  " << std::setw(14) << verdict_name(test_case.verdict)
+                          << std::right << std::setw(12) << std::fixed << std::setprecision(2) << test_case.time << std::defaultfloat
+                          << std::setw(16) << test_case.instructions << std::endl;
+        }
+        report_stream << "Passed: " << cases.size() - failed << "/" << cases.size() << std::endl;
+
+        return failed;
+    }
+
+    // PROTECTED:
+
+    std::vector<Judge::Case> Judge::load_cases(const std::string& directory) const
+    {
+        namespace fs = std::filesystem;
+
+        auto read_file = [](const fs::path& path)
+        {
+            std::ifstream file_stream(path, std::ifstream::binary);
+            std::ostringstream contents;
+            contents << file_stream.rdbuf();
+            return contents.str();
+        };
+
+        std::vector<Case> cases;
+        std::error_code error;
+        for (const fs::directory_entry& entry : fs::directory_iterator(directory, error))
+        {
+            if (entry.path().extension() != ".in") { continue; }
+
+            fs::path expected_path = entry.path();
+            expected_path.replace_extension(".out");
+            if (!fs::exists(expected_path)) { continue; }
+
+            Case test_case;
+            test_case.name = entry.path().stem().string();
+            test_case.input = read_file(entry.path());
+            test_case.expected = read_file(expected_path);
+            cases.push_back(std::move(test_case));
+        }
+
+        if (error || cases.empty())
+        {
+            std::cerr << "[JUDGE ERROR]: no test cases (<name>.in and <name>.out) were found in " << directory << std::endl;
+            throw Exception::DIRECTORY;
+        }
+
+        std::sort(cases.begin(), cases.end(), [](const Case& a, const Case& b) { return a.name < b.name; });
+        return cases;
+    }
+
+    void Judge::run_case(Emulator& emulator, const State& state, Case& test_case) const
+    {
+        std::istringstream input_stream(test_case.input);
+        std::ostringstream output_stream;
+        uint64_t budget = instruction_limit;
+
+        emulator.executor.reset(); // Файлы прошлого теста закрываются.
+        emulator.state.revert(state);
+
+        // Ошибка машины - вердикт теста, а не завершение работы эмулятора: Emulator::run() здесь не используется.
+        Executor::ReturnCode return_code = Executor::ReturnCode::OK;
+        auto start = std::chrono::steady_clock::now();
+        try
+        {
+            while ((return_code == Executor::ReturnCode::OK) && (budget != 0))
+            {
+                return_code = emulator.executor.run(emulator.state, input_stream, output_stream, budget);
+            }
+        }
+        catch (Executor::Exception exception)
+        {
+            return_code = Executor::ReturnCode::ERROR;
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        test_case.time = std::chrono::duration<double, std::milli>(end - start).count();
+        test_case.instructions = instruction_limit - budget;
+
+        switch (return_code)
+        {
+            case Executor::ReturnCode::TERMINATE:
+            {
+                test_case.verdict = compare(output_stream.str(), test_case.expected) ? Verdict::OK : Verdict::WRONG_ANSWER;
+                break;
+            }
+            case Executor::ReturnCode::OK:
+            {
+                test_case.verdict = Verdict::LIMIT_EXCEEDED;
+                break;
+            }
+            default:
+            {
+                test_case.verdict = Verdict::RUNTIME_ERROR;
+                break;
+            }
+        }
+    }
+
+    bool Judge::compare(const std::string& output, const std::string& expected) const
+    {
+        if (!ignore_whitespace) { return output == expected; }
+
+        // Посимвольное сравнение с пропуском последовательностей пробельных символов: граница между словами должна совпадать.
+        auto is_space = [](char symbol) { return std::isspace(static_cast<unsigned char>(symbol)) != 0; };
+        size_t i = 0;
+        size_t j = 0;
+        bool started = false; // Пробельные символы в начале вывода не учитываются.
+        while (true)
+        {
+            bool space_i = false;
+            bool space_j = false;
+            while ((i < output.size()) && is_space(output[i])) { ++i; space_i = true; }
+            while ((j < expected.size()) && is_space(expected[j])) { ++j; space_j = true; }
+
+            if ((i == output.size()) || (j == expected.size())) { return (i == output.size()) && (j == expected.size()); }
+            if (started && (space_i != space_j)) { return false; }
+            if (output[i] != expected[j]) { return false; }
+            started = true;
+            ++i;
+            ++j;
+        }
+    }
+
+    const char* Judge::verdict_name(Verdict verdict)
+    {
+        switch (verdict)
+        {
+            case Verdict::OK:             { return "OK"; }
+            case Verdict::WRONG_ANSWER:   { return "Wrong answer"; }
+            case Verdict::RUNTIME_ERROR:  { return "Runtime error"; }
+            case Verdict::LIMIT_EXCEEDED: { return "Limit exceeded"; }
+        }
+        return "";
+    }
+
+    // PRIVATE:
+}
@@ -3,8 +3,23 @@
 #include <string>
 #include <fstream>
 #include <chrono>
+#include <memory>
+#include <cstdio>
+
+#include <unistd.h>
 
 #include "FUPM2EMU.hpp"
+#include "Compiler.hpp"
+#include "ForkServer.hpp"
+#include "Judge.hpp"
+#include "AsyncWriter.hpp"
+#include "PerfCounters.hpp"
+#include "SamplingProfiler.hpp"
+#include "CallProfiler.hpp"
+#include "CacheSimulator.hpp"
+#include "BranchProfiler.hpp"
+#include "Debugger.hpp"
+#include "GdbServer.hpp"
 
 // Глобальные константы для вывода информации.
 const std::string version   = "0.93";
@@ -15,8 +30,26 @@ Arguments:
   --help, -h                    Show help reference
   --load, -l         <file>     Get machine's state from the file and run it.
   --assemble, -a     <file>     Translate assembler code from the file and run the result
+  --assembler-threads, -u <n>   Assemble the source split into n parts in parallel threads (0 - one per hardware thread)
   --disassemble, -d             Disassemble current machine's state.
-  --benchmark, -b               Run the program with execution time beeing measured
+  --compile, -c      <file>     Translate current machine's state to a C++ source file and exit
+  --executable, -w   <file>     Write current machine's state as an executable file and exit
+  --checkpoint, -k   <file> <n> Run the program appending an incremental checkpoint to the file every n instructions
+  --restore, -r      <file> <i> Restore machine's state from the checkpoint number i in the file and run it
+  --fork-server, -f  <file>     Serve "<input> <output>" run requests from the control file (pipe) by forking
+  --judge, -j        <dir> <n>  Run the program on every <name>.in/<name>.out test case in the directory (at most n instructions each)
+  --debug, -i        <file>     Run the program under the debugger reading commands from the file (e.g. /dev/tty)
+  --gdb, -q          <address>  Wait for a GDB remote protocol client on the local TCP port or UNIX socket path and debug the program
+  --async-output, -o            Write machine's output to stdout from a separate thread
+  --sandbox, -s      <dir>      Allow file syscalls inside the directory
+  --benchmark, -b               Run the program with execution time and host performance counters beeing measured
+  --heap-stats, -m              Print dynamic memory allocation statistics after the run
+  --sparse, -p       <bits>     Use sparse paged memory with 2^bits words of address space (10..32)
+  --sample-profile, -x <file>   Sample the running instruction 1000 times per second and write folded stacks to the file
+  --call-profile, -g <file>     Track guest calls and write instruction counts per call path as folded stacks to the file
+  --branch-stats, -n <file>     Count taken/not taken conditional jumps per site, simulate branch predictors, write the ranking to the file
+  --cache-sim, -e    <file> <c> Simulate guest cache c = size:line:ways (bytes, LRU), write misses per instruction and accesses per page to the file
+  --stats, -t        <file>     Write retired instruction counts by class, branch counts and timings to the file (JSON)
 )";
 
 int main(int argc,  char *argv[])
@@ -28,6 +61,7 @@ int main(int argc,  char *argv[])
         UNKNOWNARGS, // Неизвестные аргументы.
         INCOMPARGS,  // Несовместимые аргументы.
         NOFILEPATH,  // Не указан путь.
+        NONUMBER,    // Не указано или неверно указано число.
     };
 
     // Режимы обработки файла инициализации.
@@ -36,11 +70,37 @@ int main(int argc,  char *argv[])
         DEFAULT,  // Без загрузки файлов.
         STATE,    // Загрузка состояния памяти.
         ASSEMBLE, // Загрузка и трансляция исходного кода.
+        RESTORE,  // Восстановление из файла контрольных точек.
     };
 
     // Измерение времени работы.
     bool benchmark = false;
 
+    // Асинхронный вывод.
+    bool async_output = false;
+
+    // Статистика динамической памяти.
+    bool heap_statistics = false;
+
+    // Каталог для файловых системных вызовов.
+    std::string sandbox_path;
+
+    // Профилирование по выборкам.
+    std::string sample_profile_path;
+    std::string statistics_path;
+    std::string call_profile_path;
+    std::string cache_report_path;
+    std::string branch_report_path;
+    size_t cache_size = 0, cache_line = 0, cache_ways = 0;
+    double assembling_milliseconds = 0;
+
+    // Разреженная память (0 - плотная).
+    unsigned long sparse_bits = 0;
+
+    // Число потоков ассемблера (1 - последовательное ассемблирование).
+    unsigned long assembler_threads = 1;
+    bool assembler_threads_set = false;
+
     // Инициализация из файла.
     std::string init_file_path;
     InitFileModes init_file_mode = InitFileModes::DEFAULT;
@@ -49,6 +109,26 @@ int main(int argc,  char *argv[])
     //std::string DisassemblyFilePath;
     bool disassemble = false;
 
+    // Компиляция в исходный код на C++.
+    std::string compile_file_path;
+
+    // Запись исполнимого файла.
+    std::string executable_file_path;
+
+    // Контрольные точки.
+    std::string checkpoint_file_path;
+    uint64_t checkpoint_interval = 0;
+    size_t restore_index = 0;
+
+    // Сервер запусков.
+    std::string control_file_path;
+    std::string debug_commands_path;
+    std::string gdb_address;
+
+    // Проверка на тестах.
+    std::string judge_directory;
+    uint64_t judge_limit = 0;
+
     try
     {
         std::string argument;
@@ -86,12 +166,215 @@ int main(int argc,  char *argv[])
                 ++i;
             }
 
+            // Параллельное ассемблирование.
+            else if ((argument == "--assembler-threads") || (argument == "-u"))
+            {
+                if (assembler_threads_set) { throw ArgsException::INCOMPARGS; }
+                if (i + 1 >= argc) { throw ArgsException::NONUMBER; }
+
+                try { assembler_threads = std::stoul(argv[i+1]); }
+                catch (std::exception&) { throw ArgsException::NONUMBER; }
+                if (assembler_threads > 1024) { throw ArgsException::NONUMBER; }
+                assembler_threads_set = true;
+                ++i;
+            }
+
             // Дизассемблирование состояния эмулятора.
             else if ((argument == "--disassemble") || (argument == "-d"))
             {
                 disassemble = true;
             }
 
+            // Трансляция состояния эмулятора в исходный код на C++.
+            else if ((argument == "--compile") || (argument == "-c"))
+            {
+                if (!compile_file_path.empty()) { throw ArgsException::INCOMPARGS; }
+                if (i + 1 >= argc) { throw ArgsException::NOFILEPATH; }
+
+                compile_file_path = argv[i+1];
+                ++i;
+            }
+
+            // Запись состояния эмулятора в исполнимый файл.
+            else if ((argument == "--executable") || (argument == "-w"))
+            {
+                if (!executable_file_path.empty()) { throw ArgsException::INCOMPARGS; }
+                if (i + 1 >= argc) { throw ArgsException::NOFILEPATH; }
+
+                executable_file_path = argv[i+1];
+                ++i;
+            }
+
+            // Запись контрольных точек во время работы.
+            else if ((argument == "--checkpoint") || (argument == "-k"))
+            {
+                if (!checkpoint_file_path.empty()) { throw ArgsException::INCOMPARGS; }
+                if (i + 1 >= argc) { throw ArgsException::NOFILEPATH; }
+                if (i + 2 >= argc) { throw ArgsException::NONUMBER; }
+
+                checkpoint_file_path = argv[i+1];
+                try { checkpoint_interval = std::stoull(argv[i+2]); }
+                catch (std::exception&) { throw ArgsException::NONUMBER; }
+                if (checkpoint_interval == 0) { throw ArgsException::NONUMBER; }
+                i += 2;
+            }
+
+            // Восстановление состояния эмулятора из контрольной точки.
+            else if ((argument == "--restore") || (argument == "-r"))
+            {
+                if (init_file_mode != InitFileModes::DEFAULT) { throw ArgsException::INCOMPARGS; }
+                if (i + 1 >= argc) { throw ArgsException::NOFILEPATH; }
+                if (i + 2 >= argc) { throw ArgsException::NONUMBER; }
+
+                init_file_mode = InitFileModes::RESTORE;
+                init_file_path = argv[i+1];
+                try { restore_index = std::stoull(argv[i+2]); }
+                catch (std::exception&) { throw ArgsException::NONUMBER; }
+                i += 2;
+            }
+
+            // Обработка запросов на запуск из управляющего канала.
+            else if ((argument == "--fork-server") || (argument == "-f"))
+            {
+                if (!control_file_path.empty()) { throw ArgsException::INCOMPARGS; }
+                if (i + 1 >= argc) { throw ArgsException::NOFILEPATH; }
+
+                control_file_path = argv[i+1];
+                ++i;
+            }
+
+            // Проверка программы на каталоге тестов.
+            else if ((argument == "--judge") || (argument == "-j"))
+            {
+                if (!judge_directory.empty()) { throw ArgsException::INCOMPARGS; }
+                if (i + 1 >= argc) { throw ArgsException::NOFILEPATH; }
+                if (i + 2 >= argc) { throw ArgsException::NONUMBER; }
+
+                judge_directory = argv[i+1];
+                try { judge_limit = std::stoull(argv[i+2]); }
+                catch (std::exception&) { throw ArgsException::NONUMBER; }
+                if (judge_limit == 0) { throw ArgsException::NONUMBER; }
+                i += 2;
+            }
+
+            // Отладчик.
+            else if ((argument == "--debug") || (argument == "-i"))
+            {
+                if (!debug_commands_path.empty()) { throw ArgsException::INCOMPARGS; }
+                if (i + 1 >= argc) { throw ArgsException::NOFILEPATH; }
+
+                debug_commands_path = argv[i+1];
+                ++i;
+            }
+
+            // Сервер удалённой отладки GDB.
+            else if ((argument == "--gdb") || (argument == "-q"))
+            {
+                if (!gdb_address.empty()) { throw ArgsException::INCOMPARGS; }
+                if (i + 1 >= argc) { throw ArgsException::NOFILEPATH; }
+
+                gdb_address = argv[i+1];
+                ++i;
+            }
+
+            // Вывод машины через отдельный поток записи.
+            else if ((argument == "--async-output") || (argument == "-o"))
+            {
+                async_output = true;
+            }
+
+            // Разрешение файловых системных вызовов внутри каталога.
+            else if ((argument == "--sandbox") || (argument == "-s"))
+            {
+                if (!sandbox_path.empty()) { throw ArgsException::INCOMPARGS; }
+                if (i + 1 >= argc) { throw ArgsException::NOFILEPATH; }
+
+                sandbox_path = argv[i+1];
+                ++i;
+            }
+
+            // Вывод статистики динамической памяти.
+            else if ((argument == "--heap-stats") || (argument == "-m"))
+            {
+                heap_statistics = true;
+            }
+
+            // Профилирование по выборкам.
+            else if ((argument == "--sample-profile") || (argument == "-x"))
+            {
+                if (!sample_profile_path.empty()) { throw ArgsException::INCOMPARGS; }
+                if (i + 1 >= argc) { throw ArgsException::NOFILEPATH; }
+
+                sample_profile_path = argv[i+1];
+                ++i;
+            }
+
+            // Профилирование графа вызовов.
+            else if ((argument == "--call-profile") || (argument == "-g"))
+            {
+                if (!call_profile_path.empty()) { throw ArgsException::INCOMPARGS; }
+                if (i + 1 >= argc) { throw ArgsException::NOFILEPATH; }
+
+                call_profile_path = argv[i+1];
+                ++i;
+            }
+
+            // Статистика условных переходов.
+            else if ((argument == "--branch-stats") || (argument == "-n"))
+            {
+                if (!branch_report_path.empty()) { throw ArgsException::INCOMPARGS; }
+                if (i + 1 >= argc) { throw ArgsException::NOFILEPATH; }
+
+                branch_report_path = argv[i+1];
+                ++i;
+            }
+
+            // Модель кэша.
+            else if ((argument == "--cache-sim") || (argument == "-e"))
+            {
+                if (!cache_report_path.empty()) { throw ArgsException::INCOMPARGS; }
+                if (i + 1 >= argc) { throw ArgsException::NOFILEPATH; }
+                if (i + 2 >= argc) { throw ArgsException::NONUMBER; }
+
+                cache_report_path = argv[i+1];
+                // Размер, строка и ассоциативность через двоеточие: "32768:64:8".
+                std::string configuration = argv[i+2];
+                size_t first = configuration.find(':');
+                size_t second = (first == std::string::npos) ? first : configuration.find(':', first + 1);
+                if (second == std::string::npos) { throw ArgsException::NONUMBER; }
+                try
+                {
+                    cache_size = std::stoull(configuration.substr(0, first));
+                    cache_line = std::stoull(configuration.substr(first + 1, second - first - 1));
+                    cache_ways = std::stoull(configuration.substr(second + 1));
+                }
+                catch (std::exception&) { throw ArgsException::NONUMBER; }
+                if (!FUPM2EMU::CacheSimulator::valid(cache_size, cache_line, cache_ways)) { throw ArgsException::NONUMBER; }
+                i += 2;
+            }
+
+            // Статистика команд в формате JSON.
+            else if ((argument == "--stats") || (argument == "-t"))
+            {
+                if (!statistics_path.empty()) { throw ArgsException::INCOMPARGS; }
+                if (i + 1 >= argc) { throw ArgsException::NOFILEPATH; }
+
+                statistics_path = argv[i+1];
+                ++i;
+            }
+
+            // Разреженная память с заданной разрядностью адресов.
+            else if ((argument == "--sparse") || (argument == "-p"))
+            {
+                if (sparse_bits != 0) { throw ArgsException::INCOMPARGS; }
+                if (i + 1 >= argc) { throw ArgsException::NONUMBER; }
+
+                try { sparse_bits = std::stoul(argv[i+1]); }
+                catch (std::exception&) { throw ArgsException::NONUMBER; }
+                if ((sparse_bits < 10) || (sparse_bits > 32)) { throw ArgsException::NONUMBER; }
+                ++i;
+            }
+
             // Измерение времени компиляции (если была) и работы эмулируемой программы.
             else if ((argument == "--benchmark") || (argument == "-b"))
             {
@@ -104,6 +387,28 @@ int main(int argc,  char *argv[])
                 throw ArgsException::UNKNOWNARGS;
             }
         }
+
+        // Контрольные точки, откат состояния (проверка на тестах) и компиляция требуют плотной памяти.
+        if ((sparse_bits != 0) && (!checkpoint_file_path.empty() || (init_file_mode == InitFileModes::RESTORE) ||
+                                   !judge_directory.empty() || !compile_file_path.empty()))
+        {
+            throw ArgsException::INCOMPARGS;
+        }
+        // Отладчик и сервер GDB управляют выполнением сами.
+        if ((!debug_commands_path.empty() || !gdb_address.empty()) &&
+            (!checkpoint_file_path.empty() || !control_file_path.empty() || !judge_directory.empty()))
+        {
+            throw ArgsException::INCOMPARGS;
+        }
+        if (!debug_commands_path.empty() && !gdb_address.empty())
+        {
+            throw ArgsException::INCOMPARGS;
+        }
+        // Модель кэша выполняется отдельным вариантом цикла интерпретатора, без профилировщиков.
+        if (!cache_report_path.empty() && (!sample_profile_path.empty() || !call_profile_path.empty() || !branch_report_path.empty()))
+        {
+            throw ArgsException::INCOMPARGS;
+        }
     }
     catch (ArgsException exception)
     {
@@ -123,6 +428,12 @@ int main(int argc,  char *argv[])
             case ArgsException::NOFILEPATH:
             {
                 std::cerr << "Error: file path has not been passed." << std::endl;
+                break;
+            }
+            case ArgsException::NONUMBER:
+            {
+                std::cerr << "Error: a positive number has not been passed." << std::endl;
+                break;
             }
         }
 
@@ -130,7 +441,9 @@ int main(int argc,  char *argv[])
     }
 
     // Экземпляр эмулятора.
-    FUPM2EMU::Emulator FUPM2;
+    FUPM2EMU::Emulator FUPM2 = (sparse_bits != 0) ?
+        FUPM2EMU::Emulator(FUPM2EMU::State::Backend::SPARSE, static_cast<uint8_t>(sparse_bits)) : FUPM2EMU::Emulator();
+    FUPM2.executor.sandbox = sandbox_path;
 
     if (!init_file_path.empty())
     {
@@ -144,10 +457,11 @@ int main(int argc,  char *argv[])
             {
                 // Загрузка файла состояния, передача потока файла эмулятору.
                 std::fstream file_stream;
-                file_stream.open(init_file_path, std::fstream::in);
+                file_stream.open(init_file_path, std::fstream::in | std::fstream::binary);
                 if (file_stream.is_open())
                 {
-                    FUPM2.state.load(file_stream);
+                    try { FUPM2.state.load(file_stream); }
+                    catch (FUPM2EMU::State::Exception exception) { return 0; }
                     file_stream.close();
                 }
                 else
@@ -163,19 +477,24 @@ int main(int argc,  char *argv[])
                 file_stream.open(init_file_path, std::fstream::in);
                 if (file_stream.is_open())
                 {
+                    // Время ассемблирования измеряется всегда (для --stats), счётчики хоста - только при --benchmark.
+                    std::clock_t start_assembling = std::clock();
                     if (benchmark)
                     {
-                        std::clock_t start_assembling = std::clock();
-                        FUPM2.translator.assemble(file_stream, FUPM2.state);
-                        std::clock_t end_assembling = std::clock();
+                        FUPM2EMU::PerfCounters counters;
+                        counters.start();
+                        FUPM2.translator.assemble(file_stream, FUPM2.state, static_cast<unsigned int>(assembler_threads));
+                        counters.stop();
+                        assembling_milliseconds = 1000.0 * (std::clock() - start_assembling) / CLOCKS_PER_SEC;
                         std::cout << std::fixed << std::setprecision(2)
-                                  << "[BENCHMARK]: Assembling CPU time used: "
-                                  << 1000.0 * (end_assembling - start_assembling) / CLOCKS_PER_SEC << "ms" << std::endl
+                                  << "[BENCHMARK]: Assembling CPU time used: " << assembling_milliseconds << "ms" << std::endl
                                   << std::defaultfloat;
+                        counters.print(std::cout, 0);
                     }
                     else
                     {
-                        FUPM2.translator.assemble(file_stream, FUPM2.state);
+                        FUPM2.translator.assemble(file_stream, FUPM2.state, static_cast<unsigned int>(assembler_threads));
+                        assembling_milliseconds = 1000.0 * (std::clock() - start_assembling) / CLOCKS_PER_SEC;
                     }
                     file_stream.close();
                 }
@@ -185,6 +504,23 @@ int main(int argc,  char *argv[])
                 }
                 break;
             }
+            case InitFileModes::RESTORE:
+            {
+                // Применение цепочки записей файла контрольных точек.
+                std::fstream file_stream;
+                file_stream.open(init_file_path, std::fstream::in | std::fstream::binary);
+                if (file_stream.is_open())
+                {
+                    try { FUPM2.state.restore_checkpoint(file_stream, restore_index); }
+                    catch (FUPM2EMU::State::Exception exception) { return 0; }
+                    file_stream.close();
+                }
+                else
+                {
+                    std::cerr << "Error: failed to open file: " << init_file_path << std::endl;
+                }
+                break;
+            }
         }
     }
 
@@ -203,20 +539,270 @@ int main(int argc,  char *argv[])
         }
     }
 
+    // Запись исполнимого файла. Программа не исполняется.
+    if (!executable_file_path.empty())
+    {
+        std::fstream file_stream;
+        file_stream.open(executable_file_path, std::fstream::out | std::fstream::binary);
+        if (!file_stream.is_open() || (FUPM2.state.save_executable(file_stream) != 0))
+        {
+            std::cerr << "Error: failed to write file: " << executable_file_path << std::endl;
+        }
+        return 0;
+    }
+
+    // Компиляция. Программа не исполняется: результат предназначен для компилятора C++.
+    if (!compile_file_path.empty())
+    {
+        std::fstream file_stream;
+        file_stream.open(compile_file_path, std::fstream::out);
+        if (file_stream.is_open())
+        {
+            FUPM2EMU::Compiler compiler;
+            try { compiler.compile(FUPM2.state, file_stream); }
+            catch (FUPM2EMU::Compiler::Exception exception)
+            {
+                // Неполный результат не оставляется.
+                file_stream.close();
+                std::remove(compile_file_path.c_str());
+                return 1;
+            }
+        }
+        else
+        {
+            std::cerr << "Error: failed to write file: " << compile_file_path << std::endl;
+        }
+        return 0;
+    }
+
+    // Сервер запусков. Каждый запрос выполняется в отдельном процессе с копией подготовленного состояния.
+    if (!control_file_path.empty())
+    {
+        FUPM2EMU::ForkServer server(FUPM2);
+        try { server.serve(control_file_path, std::cout); }
+        catch (FUPM2EMU::ForkServer::Exception exception) { }
+        return 0;
+    }
+
+    // Проверка на тестах. Вывод тестов сравнивается в памяти, на экран выводится сводная таблица.
+    if (!judge_directory.empty())
+    {
+        FUPM2EMU::Judge judge;
+        judge.instruction_limit = judge_limit;
+        try { judge.judge(FUPM2.state, judge_directory, std::cout); }
+        catch (FUPM2EMU::Judge::Exception exception) { }
+        return 0;
+    }
+
+    // Отладчик. Команды читаются из файла, ввод-вывод машины остаётся стандартным.
+    if (!debug_commands_path.empty())
+    {
+        std::ifstream command_stream(debug_commands_path);
+        if (!command_stream.is_open())
+        {
+            std::cerr << "Error: failed to open file: " << debug_commands_path << std::endl;
+            return 0;
+        }
+        FUPM2EMU::Debugger debugger(FUPM2);
+        debugger.interact(command_stream, std::cerr, std::cin, std::cout);
+        return 0;
+    }
+
+    // Сервер GDB. После отсоединения клиента программа выполняется дальше без отладчика.
+    if (!gdb_address.empty())
+    {
+        FUPM2EMU::GdbServer server(FUPM2);
+        try { server.serve(gdb_address, std::cin, std::cout); }
+        catch (FUPM2EMU::GdbServer::Exception exception) { }
+        return 0;
+    }
+
+    // Файл контрольных точек.
+    std::fstream checkpoint_stream;
+    if (!checkpoint_file_path.empty())
+    {
+        checkpoint_stream.open(checkpoint_file_path, std::fstream::out | std::fstream::binary);
+        if (!checkpoint_stream.is_open())
+        {
+            std::cerr << "Error: failed to write file: " << checkpoint_file_path << std::endl;
+            return 0;
+        }
+    }
+
     // Запуск эмуляции.
+    auto run = [&]()
+    {
+        auto run_with = [&](std::ostream& output_stream)
+        {
+            if (checkpoint_stream.is_open()) { FUPM2.run(std::cin, output_stream, checkpoint_stream, checkpoint_interval); }
+            else { FUPM2.run(std::cin, output_stream); }
+        };
+
+        if (async_output)
+        {
+            // Всё выведенное ранее должно предшествовать выводу машины.
+            std::cout.flush();
+            FUPM2EMU::AsyncWriter writer(STDOUT_FILENO);
+            std::ostream output_stream(&writer);
+            run_with(output_stream);
+        }
+        else { run_with(std::cout); }
+    };
+
+    // Профилировщик по выборкам работает только во время выполнения.
+    std::unique_ptr<FUPM2EMU::SamplingProfiler> profiler;
+    if (!sample_profile_path.empty())
+    {
+        profiler.reset(new FUPM2EMU::SamplingProfiler(FUPM2.executor));
+        if (!profiler->start()) { std::cerr << "Error: failed to start the sampling profiler." << std::endl; }
+    }
+
+    // Профилировщик графа вызовов начинает с текущей команды.
+    std::unique_ptr<FUPM2EMU::CallProfiler> call_profiler;
+    if (!call_profile_path.empty())
+    {
+        call_profiler.reset(new FUPM2EMU::CallProfiler(FUPM2.executor, FUPM2.state));
+        call_profiler->start();
+    }
+
+    // Статистика переходов начинает с пустых таблиц предсказателей.
+    std::unique_ptr<FUPM2EMU::BranchProfiler> branch_profiler;
+    if (!branch_report_path.empty())
+    {
+        branch_profiler.reset(new FUPM2EMU::BranchProfiler(FUPM2.executor));
+        branch_profiler->start();
+    }
+
+    // Модель кэша начинает с пустого кэша.
+    std::unique_ptr<FUPM2EMU::CacheSimulator> cache_simulator;
+    if (!cache_report_path.empty())
+    {
+        cache_simulator.reset(new FUPM2EMU::CacheSimulator(FUPM2.executor, FUPM2.state, cache_size, cache_line, cache_ways));
+        cache_simulator->start();
+    }
+
+    // Время выполнения измеряется всегда (для --stats), счётчики хоста - только при --benchmark.
+    double execution_milliseconds = 0;
+    std::clock_t start_execution = std::clock();
     if (benchmark)
     {
-        std::clock_t start_execution = std::clock();
-        FUPM2.run(std::cin, std::cout);
-        std::clock_t end_execution = std::clock();
+        FUPM2EMU::PerfCounters counters;
+        counters.start();
+        run();
+        counters.stop();
+        execution_milliseconds = 1000.0 * (std::clock() - start_execution) / CLOCKS_PER_SEC;
         std::cout << std::fixed << std::setprecision(2)
-                  << "[BENCHMARK]: Execution CPU time used: "
-                  << 1000.0 * (end_execution - start_execution) / CLOCKS_PER_SEC << "ms" << std::endl
-                  << std::defaultfloat;
+                  << "[BENCHMARK]: Execution CPU time used: " << execution_milliseconds << "ms" << std::endl;
+        uint64_t retired = FUPM2.executor.statistics.retired();
+        std::cout << "[BENCHMARK]: Guest instructions retired: " << retired;
+        if (execution_milliseconds > 0) { std::cout << " (" << retired / (execution_milliseconds * 1000.0) << " MIPS)"; }
+        std::cout << std::endl << std::defaultfloat;
+        counters.print(std::cout, retired);
     }
     else
     {
-        FUPM2.run(std::cin, std::cout);
+        run();
+        execution_milliseconds = 1000.0 * (std::clock() - start_execution) / CLOCKS_PER_SEC;
+    }
+
+    if (profiler)
+    {
+        profiler->stop();
+        std::fstream file_stream;
+        file_stream.open(sample_profile_path, std::fstream::out);
+        if (file_stream.is_open())
+        {
+            profiler->write_folded(FUPM2.state, FUPM2.translator, file_stream);
+            std::cout << "[PROFILE]: " << profiler->samples_number() << " samples (" << profiler->dropped_number() << " dropped)" << std::endl;
+        }
+        else
+        {
+            std::cerr << "Error: failed to write file: " << sample_profile_path << std::endl;
+        }
+    }
+
+    if (call_profiler)
+    {
+        call_profiler->stop();
+        std::fstream file_stream;
+        file_stream.open(call_profile_path, std::fstream::out);
+        if (file_stream.is_open())
+        {
+            call_profiler->write_folded(FUPM2.state, file_stream);
+            call_profiler->print_summary(FUPM2.state, std::cout);
+        }
+        else
+        {
+            std::cerr << "Error: failed to write file: " << call_profile_path << std::endl;
+        }
+    }
+
+    if (branch_profiler)
+    {
+        branch_profiler->stop();
+        std::fstream file_stream;
+        file_stream.open(branch_report_path, std::fstream::out);
+        if (file_stream.is_open())
+        {
+            branch_profiler->write_report(FUPM2.state, file_stream);
+            branch_profiler->print_summary(FUPM2.state, std::cout);
+        }
+        else
+        {
+            std::cerr << "Error: failed to write file: " << branch_report_path << std::endl;
+        }
+    }
+
+    if (cache_simulator)
+    {
+        cache_simulator->stop();
+        std::fstream file_stream;
+        file_stream.open(cache_report_path, std::fstream::out);
+        if (file_stream.is_open())
+        {
+            cache_simulator->write_report(FUPM2.state, file_stream);
+            cache_simulator->print_summary(std::cout);
+        }
+        else
+        {
+            std::cerr << "Error: failed to write file: " << cache_report_path << std::endl;
+        }
+    }
+
+    if (heap_statistics) { FUPM2.state.heap.print_statistics(std::cout); }
+
+    // Статистика команд в формате JSON.
+    if (!statistics_path.empty())
+    {
+        std::fstream file_stream;
+        file_stream.open(statistics_path, std::fstream::out);
+        if (file_stream.is_open())
+        {
+            const FUPM2EMU::Executor::Statistics& statistics = FUPM2.executor.statistics;
+            static const char* class_names[FUPM2EMU::Executor::Statistics::CLASSES_NUMBER] =
+            {
+                "alu", "double", "jump", "conditional", "memory", "stack", "system"
+            };
+
+            uint64_t retired = statistics.retired();
+            file_stream << "{" << std::endl << "  \"retired\": " << retired << "," << std::endl << "  \"classes\": {";
+            for (size_t index = 0; index < FUPM2EMU::Executor::Statistics::CLASSES_NUMBER; ++index)
+            {
+                file_stream << (index ? ", " : " ") << "\"" << class_names[index] << "\": " << statistics.classes[index];
+            }
+            file_stream << " }," << std::endl
+                        << "  \"branches\": { \"taken\": " << statistics.branches_taken()
+                        << ", \"not_taken\": " << statistics.branches_not_taken() << " }," << std::endl
+                        << std::fixed << std::setprecision(3)
+                        << "  \"assembly_ms\": " << assembling_milliseconds << "," << std::endl
+                        << "  \"execution_ms\": " << execution_milliseconds << "," << std::endl
+                        << "  \"mips\": " << ((execution_milliseconds > 0) ? retired / (execution_milliseconds * 1000.0) : 0.0) << std::endl
+                        << "}" << std::endl;
+        }
+        else
+        {
+            std::cerr << "Error: failed to write file: " << statistics_path << std::endl;
+        }
     }
     return 0;
 }
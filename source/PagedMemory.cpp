@@ -0,0 +1,101 @@
+#include <cstring>
+
+#include "PagedMemory.hpp"
+
+namespace FUPM2EMU
+{
+    ////////////////  PagedMemory   ////////////////
+    // PUBLIC:
+    PagedMemory::PagedMemory() : cached_index(0), cached_page(nullptr)
+    {
+        // ...
+    }
+    PagedMemory::PagedMemory(uint8_t address_bits) : cached_index(0), cached_page(nullptr)
+    {
+        // Первая ступень покрывает всё адресное пространство, но хранит только указатели.
+        size_t pages = (address_bits > page_bits) ? (static_cast<size_t>(1) << (address_bits - page_bits)) : 1;
+        directory.resize((pages + table_size - 1) / table_size);
+    }
+    PagedMemory::PagedMemory(const PagedMemory& other) : cached_index(0), cached_page(nullptr)
+    {
+        *this = other;
+    }
+    PagedMemory& PagedMemory::operator=(const PagedMemory& other)
+    {
+        if (this == &other) { return *this; }
+
+        // Копируются только выделенные страницы.
+        directory.clear();
+        directory.resize(other.directory.size());
+        for (size_t table = 0; table < other.directory.size(); ++table)
+        {
+            if (!other.directory[table]) { continue; }
+
+            directory[table].reset(new Table());
+            for (size_t page = 0; page < table_size; ++page)
+            {
+                if (!other.directory[table]->pages[page]) { continue; }
+                directory[table]->pages[page].reset(new Page(*other.directory[table]->pages[page]));
+            }
+        }
+
+        cached_page = nullptr;
+        return *this;
+    }
+    PagedMemory::~PagedMemory()
+    {
+        // ...
+    }
+
+    void PagedMemory::clear()
+    {
+        for (std::unique_ptr<Table>& table : directory)
+        {
+            if (!table) { continue; }
+            for (std::unique_ptr<Page>& page : table->pages)
+            {
+                if (page) { std::memset(page->bytes, 0, page_bytes); }
+            }
+        }
+    }
+
+    size_t PagedMemory::pages_allocated() const
+    {
+        size_t count = 0;
+        for (const std::unique_ptr<Table>& table : directory)
+        {
+            if (!table) { continue; }
+            for (const std::unique_ptr<Page>& page : table->pages) { count += page ? 1 : 0; }
+        }
+        return count;
+    }
+
+    // PROTECTED:
+
+    uint8_t* PagedMemory::lookup(size_t page_index, bool allocate) const
+    {
+        size_t table_index = page_index >> table_bits;
+        if (table_index >= directory.size()) { return nullptr; }
+
+        // Выделение таблицы и страницы (нулевой) при записи. Память логически не меняется, поэтому метод константный.
+        std::unique_ptr<Table>& table = const_cast<std::unique_ptr<Table>&>(directory[table_index]);
+        if (!table)
+        {
+            if (!allocate) { return nullptr; }
+            table.reset(new Table());
+        }
+
+        std::unique_ptr<Page>& page = table->pages[page_index & (table_size - 1)];
+        if (!page)
+        {
+            if (!allocate) { return nullptr; }
+            page.reset(new Page()); // Страница заполнена нулями.
+        }
+
+        cached_index = page_index;
+        cached_page = page->bytes;
+        return cached_page;
+    }
+
+    // PRIVATE:
+}
@@ -0,0 +1,171 @@
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <iomanip>
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "PerfCounters.hpp"
+
+namespace FUPM2EMU
+{
+    ////////////////  PerfCounters  ////////////////
+    // PUBLIC:
+    PerfCounters::PerfCounters()
+    {
+        std::fill(descriptors, descriptors + counters_number, -1);
+        std::fill(values, values + counters_number, 0);
+
+        #ifdef __linux__
+        // Тип и конфигурация событий в порядке Counter.
+        static const struct { uint32_t type; uint64_t config; } events[counters_number] =
+        {
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+            { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+            { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK },
+            { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+        };
+
+        for (size_t counter = 0; counter < counters_number; ++counter)
+        {
+            perf_event_attr attributes;
+            std::memset(&attributes, 0, sizeof(attributes));
+            attributes.size = sizeof(attributes);
+            attributes.type = events[counter].type;
+            attributes.config = events[counter].config;
+            attributes.disabled = 1;
+            attributes.inherit = 1;        // Потоки дополнительных ядер создаются после открытия.
+            attributes.exclude_kernel = 1; // Доступно при perf_event_paranoid <= 2.
+            attributes.exclude_hv = 1;
+            attributes.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+            descriptors[counter] = static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+            if ((descriptors[counter] < 0) && (events[counter].type != PERF_TYPE_SOFTWARE) && open_error.empty())
+            {
+                open_error = std::strerror(errno);
+            }
+        }
+        #else
+        open_error = "perf_event_open is not supported on this platform";
+        #endif
+    }
+    PerfCounters::~PerfCounters()
+    {
+        #ifdef __linux__
+        for (int descriptor : descriptors)
+        {
+            if (descriptor >= 0) { close(descriptor); }
+        }
+        #endif
+    }
+
+    bool PerfCounters::hardware_available() const
+    {
+        for (size_t counter = 0; counter < static_cast<size_t>(Counter::TASK_CLOCK); ++counter)
+        {
+            if (descriptors[counter] >= 0) { return true; }
+        }
+        return false;
+    }
+
+    const std::string& PerfCounters::error() const
+    {
+        return open_error;
+    }
+
+    void PerfCounters::start()
+    {
+        #ifdef __linux__
+        for (int descriptor : descriptors)
+        {
+            if (descriptor < 0) { continue; }
+            ioctl(descriptor, PERF_EVENT_IOC_RESET, 0);
+            ioctl(descriptor, PERF_EVENT_IOC_ENABLE, 0);
+        }
+        #endif
+    }
+
+    void PerfCounters::stop()
+    {
+        #ifdef __linux__
+        for (int descriptor : descriptors)
+        {
+            if (descriptor >= 0) { ioctl(descriptor, PERF_EVENT_IOC_DISABLE, 0); }
+        }
+
+        for (size_t counter = 0; counter < counters_number; ++counter)
+        {
+            values[counter] = 0;
+            if (descriptors[counter] < 0) { continue; }
+
+            // Значение, время включения и время работы счётчика.
+            uint64_t data[3] = { 0, 0, 0 };
+            if (read(descriptors[counter], data, sizeof(data)) != static_cast<ssize_t>(sizeof(data))) { continue; }
+            values[counter] = ((data[2] != 0) && (data[2] < data[1])) ?
+                static_cast<uint64_t>(static_cast<double>(data[0]) * data[1] / data[2]) : data[0];
+        }
+        #endif
+    }
+
+    bool PerfCounters::value(Counter counter, uint64_t& result) const
+    {
+        size_t index = static_cast<size_t>(counter);
+        if (descriptors[index] < 0) { return false; }
+
+        result = values[index];
+        return true;
+    }
+
+    void PerfCounters::print(std::ostream& output_stream, uint64_t guest_instructions) const
+    {
+        static const char* names[counters_number] =
+        {
+            "Host cycles", "Host instructions", "Branch misses", "L1D read misses", "LLC misses", "Task clock", "Page faults"
+        };
+
+        if (!hardware_available())
+        {
+            output_stream << "[BENCHMARK]: Hardware counters are unavailable: " << open_error << "." << std::endl;
+        }
+
+        output_stream << std::fixed << std::setprecision(2);
+        for (size_t counter = 0; counter < counters_number; ++counter)
+        {
+            uint64_t count = 0;
+            if (!value(static_cast<Counter>(counter), count)) { continue; }
+
+            output_stream << "[BENCHMARK]: " << names[counter] << ": ";
+            if (static_cast<Counter>(counter) == Counter::TASK_CLOCK)
+            {
+                output_stream << count / 1e6 << "ms" << std::endl;
+                continue;
+            }
+
+            output_stream << count;
+            if (guest_instructions != 0)
+            {
+                output_stream << " (" << static_cast<double>(count) / guest_instructions << " per guest instruction";
+                uint64_t cycles = 0;
+                if ((static_cast<Counter>(counter) == Counter::INSTRUCTIONS) && value(Counter::CYCLES, cycles) && (cycles != 0))
+                {
+                    output_stream << ", IPC " << static_cast<double>(count) / cycles;
+                }
+                output_stream << ")";
+            }
+            output_stream << std::endl;
+        }
+        output_stream << std::defaultfloat;
+    }
+
+    // PROTECTED:
+
+    // PRIVATE:
+}
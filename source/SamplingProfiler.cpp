@@ -0,0 +1,142 @@
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+#include <signal.h>
+#include <time.h>
+
+#include "SamplingProfiler.hpp"
+
+namespace FUPM2EMU
+{
+    //////////////// SamplingProfiler ////////////////
+    SamplingProfiler* volatile SamplingProfiler::active = nullptr;
+
+    // PUBLIC:
+    SamplingProfiler::SamplingProfiler(Executor& executor, unsigned int frequency) :
+        executor(executor), frequency(frequency ? frequency : 1), table(new Entry[table_size]()), timer_created(false), samples(0), dropped(0)
+    {
+        // ...
+    }
+    SamplingProfiler::~SamplingProfiler()
+    {
+        stop();
+        delete[] table;
+    }
+
+    bool SamplingProfiler::start()
+    {
+        if (active != nullptr) { return false; }
+        active = this;
+        executor.sampling = true;
+
+        struct sigaction action;
+        std::memset(&action, 0, sizeof(action));
+        action.sa_handler = &SamplingProfiler::handle;
+        action.sa_flags = SA_RESTART; // Прерванные выборкой read()/write() системных вызовов машины продолжаются.
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGPROF, &action, nullptr);
+
+        // Таймер реального времени: таймеры процессорного времени (ITIMER_PROF, CLOCK_PROCESS_CPUTIME_ID) проверяются ядром
+        // только на тике (обычно 250 Гц) и не дают заданной частоты.
+        struct sigevent event;
+        std::memset(&event, 0, sizeof(event));
+        event.sigev_notify = SIGEV_SIGNAL;
+        event.sigev_signo = SIGPROF;
+        if (timer_create(CLOCK_MONOTONIC, &event, &timer) != 0)
+        {
+            executor.sampling = false;
+            active = nullptr;
+            return false;
+        }
+        timer_created = true;
+
+        struct itimerspec period;
+        uint64_t interval = (frequency >= 1000000000) ? 1 : 1000000000 / frequency; // Период в наносекундах.
+        period.it_interval.tv_sec = static_cast<time_t>(interval / 1000000000);
+        period.it_interval.tv_nsec = static_cast<long>(interval % 1000000000);
+        period.it_value = period.it_interval;
+        if (timer_settime(timer, 0, &period, nullptr) != 0)
+        {
+            stop();
+            return false;
+        }
+        return true;
+    }
+
+    void SamplingProfiler::stop()
+    {
+        if (active != this) { return; }
+
+        if (timer_created)
+        {
+            timer_delete(timer);
+            timer_created = false;
+        }
+        signal(SIGPROF, SIG_IGN); // Сигнал, уже поставленный в очередь, не должен застать обработчик без таблицы.
+
+        executor.sampling = false;
+        active = nullptr;
+    }
+
+    uint64_t SamplingProfiler::samples_number() const
+    {
+        return samples;
+    }
+
+    uint64_t SamplingProfiler::dropped_number() const
+    {
+        return dropped;
+    }
+
+    void SamplingProfiler::write_folded(const State& state, const Translator& translator, std::ostream& output_stream) const
+    {
+        std::vector<Entry> entries;
+        for (size_t index = 0; index < table_size; ++index)
+        {
+            if (table[index].key != 0) { entries.push_back(table[index]); }
+        }
+        // Строки упорядочиваются по адресу.
+        std::sort(entries.begin(), entries.end(), [](const Entry& left, const Entry& right) { return left.key < right.key; });
+
+        for (const Entry& entry : entries)
+        {
+            uint32_t address = static_cast<uint32_t>(entry.key - 1);
+            uint8_t operation = static_cast<uint8_t>(state.get_word(address & state.address_mask) >> 24);
+            output_stream << state.symbolize(address, false) << ";" << translator.operation_name(operation) << "@" << address
+                          << " " << entry.count << std::endl;
+        }
+    }
+
+    // PROTECTED:
+
+    void SamplingProfiler::handle(int)
+    {
+        SamplingProfiler* profiler = active;
+        if (profiler == nullptr) { return; }
+
+        uint64_t key = static_cast<uint64_t>(profiler->executor.sample) + 1;
+        profiler->samples = profiler->samples + 1;
+
+        // Открытая адресация с линейным поиском. Обработчик не прерывается сам собой (SIGPROF заблокирован на время обработки).
+        size_t index = static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 48) & (table_size - 1);
+        for (size_t probe = 0; probe < max_probes; ++probe)
+        {
+            Entry& entry = profiler->table[(index + probe) & (table_size - 1)];
+            if (entry.key == key)
+            {
+                ++entry.count;
+                return;
+            }
+            if (entry.key == 0)
+            {
+                entry.key = key;
+                entry.count = 1;
+                return;
+            }
+        }
+        profiler->dropped = profiler->dropped + 1;
+    }
+
+    // PRIVATE:
+}